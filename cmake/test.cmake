@@ -1,5 +1,5 @@
 enable_testing() 
 
-foreach(prog "test_graph" "test_solver" "test_node2vec")
+foreach(prog "test_graph" "test_solver" "test_node2vec" "test_graph64" "test_solver64")
     add_test("${prog}" "./bin/${prog}")
 endforeach(prog)
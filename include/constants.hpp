@@ -9,9 +9,23 @@
     #define max_group_num 8
     #define min_partition_bits 0
     #define SimilarDegreeDirectSamplerMaxHintNum 2
+    #define CountingSortMaxBucket 32
+    #define NeighborIndexMinDegree 64
+    #define NeighborScanMaxDegree 8
+    #define Node2vecPrefetchDistance 4
+    #define SecondOrderAliasMaxDegree 16
 #else
     #define max_partition_num 2048
     #define max_group_num 128
     #define min_partition_bits 4
     #define SimilarDegreeDirectSamplerMaxHintNum 8
+    #define CountingSortMaxBucket 65536
+    // node2vec looks up the neighbors of the vertices of at least this degree in their own hash sets or bitmaps
+    #define NeighborIndexMinDegree 1024
+    // and scans the neighbors of the vertices of at most this degree
+    #define NeighborScanMaxDegree 32
+    // node2vec samples this many walkers ahead to prefetch their neighbor queries
+    #define Node2vecPrefetchDistance 16
+    // node2vec may precompute the second-order alias tables of the partitions whose degrees are at most this
+    #define SecondOrderAliasMaxDegree 32
 #endif
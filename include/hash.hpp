@@ -1,7 +1,16 @@
 #pragma once
 
+#include <immintrin.h>
+
 #include "memory.hpp"
 
+// https://xorshift.di.unimi.it/splitmix64.c
+inline uint64_t splitmix64_hash(uint64_t x) {
+    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return x ^ (x >> 31);
+}
+
 /**
  * BloomFilter is used to speedup neighborhood query in node2vec
  */
@@ -14,12 +23,8 @@ class BloomFilter
     size_t sz;
 
     // https://qastack.cn/programming/664014/what-integer-hash-function-are-good-that-accepts-an-integer-hash-key
-    // https://xorshift.di.unimi.it/splitmix64.c
     uint64_t get_hash(uint64_t x) {
-		x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
-		x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
-		x = x ^ (x >> 31);
-        return x & hash_bitmask;
+        return splitmix64_hash(x) & hash_bitmask;
     }
 
     // https://en.wikipedia.org/wiki/Fletcher%27s_checksum
@@ -40,11 +45,15 @@ class BloomFilter
         return res;
     }
 
-    uint64_t get_value(uint32_t v1, uint32_t v2) {
+    uint64_t get_value(vertex_id_t v1, vertex_id_t v2) {
         if (v1 > v2) {
             std::swap(v1, v2);
         }
-        return ((uint64_t) v1 << 32) | v2;
+        if (sizeof(vertex_id_t) <= sizeof(uint32_t)) {
+            return ((uint64_t) v1 << 32) | v2;
+        }
+        // 64-bit IDs are mixed, and the collisions only add false positives
+        return (uint64_t) v1 * UINT64_C(0x9e3779b97f4a7c15) ^ (uint64_t) v2;
     }
 
 public:
@@ -83,12 +92,12 @@ public:
 #endif
     }
 
-    void insert(uint32_t v1, uint32_t v2) {
+    void insert(vertex_id_t v1, vertex_id_t v2) {
         uint64_t value = get_value(v1, v2);
         __sync_fetch_and_or(&table[get_hash(value)], get_bloom(value));
     }
 
-    bool exist(uint32_t v1, uint32_t v2) {
+    bool exist(vertex_id_t v1, vertex_id_t v2) {
         uint64_t value = get_value(v1, v2);
         uint64_t bloom = get_bloom(value);
 #ifdef PROFILE_BF
@@ -101,6 +110,10 @@ public:
         return bloom == (table[get_hash(value)] & bloom);
     }
 
+    void prefetch(vertex_id_t v1, vertex_id_t v2) {
+        _mm_prefetch(&table[get_hash(get_value(v1, v2))], _MM_HINT_T0);
+    }
+
     size_t size() {
         return sz;
     }
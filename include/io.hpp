@@ -1,8 +1,24 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <string>
 #include <sstream>
 #include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+
+#include <omp.h>
 
 #include "type.hpp"
 #include "log.hpp"
@@ -30,6 +46,74 @@ struct Edge {
     }
 };
 
+/**
+ * The raw edge type of weighted graphs, which is also the layout of weighted
+ * binary graphs.
+ */
+struct WeightedEdge {
+    vertex_id_t src;
+    vertex_id_t dst;
+    real_t weight;
+    WeightedEdge() {}
+    WeightedEdge(vertex_id_t _src, vertex_id_t _dst, real_t _weight) : src(_src), dst(_dst), weight(_weight) {}
+} __attribute__((packed));
+
+/**
+ * The raw edge type of temporal graphs, which is also the layout of temporal
+ * binary graphs.
+ */
+struct TemporalEdge {
+    vertex_id_t src;
+    vertex_id_t dst;
+    edge_time_t time;
+    TemporalEdge() {}
+    TemporalEdge(vertex_id_t _src, vertex_id_t _dst, edge_time_t _time) : src(_src), dst(_dst), time(_time) {}
+};
+
+/**
+ * Functors that take the edges from the parsers, which call func(src, dst) on
+ * unweighted edges, func(src, dst, weight) on weighted edges and
+ * func(src, dst, time) on temporal edges.
+ * EdgeDiscarder drops the edges, when the parsers only count them.
+ */
+struct EdgeDiscarder {
+    void operator() (vertex_id_t src, vertex_id_t dst) const {}
+    void operator() (vertex_id_t src, vertex_id_t dst, real_t weight) const {}
+    void operator() (vertex_id_t src, vertex_id_t dst, edge_time_t time) const {}
+};
+
+// Write the edges to consecutive addresses
+template<typename E>
+struct EdgeWriter {
+    E* p;
+    EdgeWriter(E* _p) : p(_p) {}
+    void operator() (vertex_id_t src, vertex_id_t dst) {
+        *p++ = E(src, dst);
+    }
+    void operator() (vertex_id_t src, vertex_id_t dst, real_t weight) {
+        *p++ = E(src, dst, weight);
+    }
+    void operator() (vertex_id_t src, vertex_id_t dst, edge_time_t time) {
+        *p++ = E(src, dst, time);
+    }
+};
+
+// Append the edges to a vector
+template<typename E>
+struct EdgeAppender {
+    std::vector<E>* edges;
+    EdgeAppender(std::vector<E>* _edges) : edges(_edges) {}
+    void operator() (vertex_id_t src, vertex_id_t dst) {
+        edges->push_back(E(src, dst));
+    }
+    void operator() (vertex_id_t src, vertex_id_t dst, real_t weight) {
+        edges->push_back(E(src, dst, weight));
+    }
+    void operator() (vertex_id_t src, vertex_id_t dst, edge_time_t time) {
+        edges->push_back(E(src, dst, time));
+    }
+};
+
 std::string get_info_graph_path(std::string fname)
 {
     std::string info_path = std::string(fname) + ".info.txt";
@@ -73,20 +157,479 @@ void write_binary_graph(const char* fname, std::vector<T> &edges, std::stringstr
     write_binary_graph(fname, edges);
 }
 
-void read_text_graph(const char* fname, std::vector<Edge> &edges) {
+/**
+ * A read-only memory mapping of a whole file.
+ */
+class MappedFile {
+    int fd;
+public:
+    const char* data;
+    size_t size;
+
+    MappedFile(const char* fname) {
+        fd = open(fname, O_RDONLY);
+        CHECK(fd >= 0) << "Cannot open " << fname;
+        struct stat st;
+        CHECK(fstat(fd, &st) == 0);
+        size = st.st_size;
+        data = nullptr;
+        if (size != 0) {
+            void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            CHECK(p != MAP_FAILED) << "Cannot mmap " << fname;
+            madvise(p, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(p);
+        }
+    }
+
+    ~MappedFile() {
+        if (data != nullptr) {
+            munmap(const_cast<char*>(data), size);
+        }
+        close(fd);
+    }
+};
+
+struct TextChunk {
+    const char* begin;
+    const char* end;
+};
+
+/**
+ * Split [begin, end) into at most chunk_num chunks of similar size.
+ * Each chunk, except the last one, ends right after a newline.
+ */
+void split_text_chunks(const char* begin, const char* end, size_t chunk_num, std::vector<TextChunk> &chunks) {
+    chunks.clear();
+    size_t chunk_size = ((end - begin) + chunk_num - 1) / chunk_num;
+    const char* p = begin;
+    while (p < end) {
+        const char* q = (size_t)(end - p) > chunk_size ? p + chunk_size : end;
+        if (q < end) {
+            const char* nl = static_cast<const char*>(memchr(q, '\n', end - q));
+            q = (nl == nullptr ? end : nl + 1);
+        }
+        TextChunk chunk;
+        chunk.begin = p;
+        chunk.end = q;
+        chunks.push_back(chunk);
+        p = q;
+    }
+}
+
+inline bool is_text_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == ',';
+}
+
+inline bool is_text_digit(char c) {
+    return (unsigned char)(c - '0') < 10;
+}
+
+/**
+ * Parse an unsigned integer from p, return the position after it,
+ * or nullptr if no digit is found.
+ */
+template<typename T>
+inline const char* parse_text_uint(const char* p, const char* end, T &val) {
+    while (p < end && is_text_blank(*p)) {
+        p++;
+    }
+    if (p == end || !is_text_digit(*p)) {
+        return nullptr;
+    }
+    T v = 0;
+    while (p < end && is_text_digit(*p)) {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+    val = v;
+    return p;
+}
+
+/**
+ * Like parse_text_uint, but set overflow if the integer does not fit in T
+ * instead of wrapping, which costs a comparison per digit.
+ */
+template<typename T>
+inline const char* parse_text_uint_checked(const char* p, const char* end, T &val, bool &overflow) {
+    while (p < end && is_text_blank(*p)) {
+        p++;
+    }
+    if (p == end || !is_text_digit(*p)) {
+        return nullptr;
+    }
+    const T max_val = std::numeric_limits<T>::max();
+    T v = 0;
+    overflow = false;
+    while (p < end && is_text_digit(*p)) {
+        T digit = *p - '0';
+        overflow |= v > (max_val - digit) / 10;
+        v = v * 10 + digit;
+        p++;
+    }
+    val = v;
+    return p;
+}
+
+/**
+ * Call func(src, dst) on each edge of a newline-aligned text chunk. Lines
+ * starting with '#' and lines without two integers are skipped.
+ */
+template<typename F>
+edge_id_t foreach_text_edge(const char* p, const char* end, F func) {
+    edge_id_t e_num = 0;
+    while (p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char* line_end = (nl == nullptr ? end : nl);
+        vertex_id_t a, b;
+        const char* q = nullptr;
+        if (*p != '#' && (q = parse_text_uint(p, line_end, a)) != nullptr && (q = parse_text_uint(q, line_end, b)) != nullptr) {
+            func(a, b);
+            e_num++;
+        }
+        p = line_end + 1;
+    }
+    return e_num;
+}
+
+/**
+ * Parse a non-negative real number like "0.5", "3" or "1e-3" from p, return
+ * the position after it, or nullptr if no number is found.
+ */
+inline const char* parse_text_real(const char* p, const char* end, real_t &val) {
+    while (p < end && is_text_blank(*p)) {
+        p++;
+    }
+    char text[64];
+    size_t len = 0;
+    while (p + len < end && len + 1 < sizeof(text) && (is_text_digit(p[len]) || p[len] == '.' || p[len] == 'e' || p[len] == 'E' || p[len] == '+' || p[len] == '-')) {
+        text[len] = p[len];
+        len++;
+    }
+    text[len] = 0;
+    char* text_end;
+    double v = strtod(text, &text_end);
+    if (len == 0 || text_end == text) {
+        return nullptr;
+    }
+    val = v;
+    return p + (text_end - text);
+}
+
+/**
+ * Call func(src, dst, weight) on each edge of a newline-aligned text chunk,
+ * whose lines are "src dst weight". Lines starting with '#' and lines without
+ * two integers are skipped.
+ */
+template<typename F>
+edge_id_t foreach_text_weighted_edge(const char* p, const char* end, F func) {
+    edge_id_t e_num = 0;
+    while (p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char* line_end = (nl == nullptr ? end : nl);
+        vertex_id_t a, b;
+        real_t w;
+        const char* q = nullptr;
+        if (*p != '#' && (q = parse_text_uint(p, line_end, a)) != nullptr && (q = parse_text_uint(q, line_end, b)) != nullptr) {
+            CHECK(parse_text_real(q, line_end, w) != nullptr) << "Expect the weight of edge " << a << " " << b << " on the same line";
+            CHECK(w >= 0 && w < std::numeric_limits<real_t>::infinity()) << "Invalid weight of edge " << a << " " << b << ": " << w;
+            func(a, b, w);
+            e_num++;
+        }
+        p = line_end + 1;
+    }
+    return e_num;
+}
+
+/**
+ * Call func(src, dst, time) on each edge of a newline-aligned text chunk,
+ * whose lines are "src dst time" with integer times. Lines starting with '#'
+ * and lines without two integers are skipped.
+ */
+template<typename F>
+edge_id_t foreach_text_temporal_edge(const char* p, const char* end, F func) {
+    edge_id_t e_num = 0;
+    while (p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char* line_end = (nl == nullptr ? end : nl);
+        vertex_id_t a, b;
+        edge_time_t t;
+        bool overflow;
+        const char* q = nullptr;
+        if (*p != '#' && (q = parse_text_uint(p, line_end, a)) != nullptr && (q = parse_text_uint(q, line_end, b)) != nullptr) {
+            CHECK(parse_text_uint_checked(q, line_end, t, overflow) != nullptr) << "Expect the time of edge " << a << " " << b << " on the same line";
+            // e.g. milliseconds since epoch with 32-bit times, which would break the time order
+            CHECK(!overflow) << "The time of edge " << a << " " << b << " is larger than " << (uint64_t) std::numeric_limits<edge_time_t>::max();
+            func(a, b, t);
+            e_num++;
+        }
+        p = line_end + 1;
+    }
+    return e_num;
+}
+
+/**
+ * The parser of text edge lists, like SNAP graphs.
+ * A parser provides skip_header(), which returns where the edges begin in a
+ * file, and foreach_edge(), which calls func(src, dst) on each edge of a
+ * newline-aligned chunk and returns the edge number.
+ */
+struct EdgeListParser {
+    const char* skip_header(const char* begin, const char* end) const {
+        return begin;
+    }
+
+    template<typename F>
+    edge_id_t foreach_edge(const char* p, const char* end, F func) const {
+        return foreach_text_edge(p, end, func);
+    }
+};
+
+// The parser of weighted text edge lists, with lines of "src dst weight"
+struct WeightedEdgeListParser {
+    const char* skip_header(const char* begin, const char* end) const {
+        return begin;
+    }
+
+    template<typename F>
+    edge_id_t foreach_edge(const char* p, const char* end, F func) const {
+        return foreach_text_weighted_edge(p, end, func);
+    }
+};
+
+// The parser of temporal text edge lists, with lines of "src dst time"
+struct TemporalEdgeListParser {
+    const char* skip_header(const char* begin, const char* end) const {
+        return begin;
+    }
+
+    template<typename F>
+    edge_id_t foreach_edge(const char* p, const char* end, F func) const {
+        return foreach_text_temporal_edge(p, end, func);
+    }
+};
+
+/**
+ * Expand a graph path into its shard files. The path could be a file,
+ * a directory whose files, except hidden and ".info.txt" ones, are the shards,
+ * or a glob pattern of the shards.
+ */
+void get_graph_shard_paths(const char* path, std::vector<std::string> &shards) {
+    shards.clear();
+    auto is_shard = [] (const std::string &name) {
+        const std::string info_suffix = ".info.txt";
+        bool is_info = name.size() >= info_suffix.size() && name.compare(name.size() - info_suffix.size(), info_suffix.size(), info_suffix) == 0;
+        return !is_info;
+    };
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path);
+        CHECK(dir != NULL) << "Cannot open " << path;
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            std::string shard = std::string(path) + "/" + name;
+            struct stat shard_st;
+            if (name[0] != '.' && is_shard(name) && stat(shard.c_str(), &shard_st) == 0 && S_ISREG(shard_st.st_mode)) {
+                shards.push_back(shard);
+            }
+        }
+        closedir(dir);
+        std::sort(shards.begin(), shards.end());
+    } else if (strpbrk(path, "*?[") != nullptr) {
+        glob_t g;
+        if (glob(path, 0, NULL, &g) == 0) {
+            for (size_t p_i = 0; p_i < g.gl_pathc; p_i++) {
+                if (is_shard(g.gl_pathv[p_i])) {
+                    shards.push_back(g.gl_pathv[p_i]);
+                }
+            }
+        }
+        globfree(&g);
+    } else {
+        shards.push_back(path);
+    }
+    CHECK(!shards.empty()) << "No graph file matches " << path;
+}
+
+/**
+ * Map the shards into memory and split them into newline-aligned chunks,
+ * more chunks than threads for load balance.
+ */
+template<typename P>
+void map_text_shards(const std::vector<std::string> &paths, const P &parser, std::vector<std::unique_ptr<MappedFile> > &files, std::vector<TextChunk> &chunks) {
+    files.clear();
+    chunks.clear();
+    for (auto &path : paths) {
+        files.emplace_back(new MappedFile(path.c_str()));
+        const char* end = files.back()->data + files.back()->size;
+        std::vector<TextChunk> file_chunks;
+        split_text_chunks(parser.skip_header(files.back()->data, end), end, (size_t) omp_get_max_threads() * 8, file_chunks);
+        chunks.insert(chunks.end(), file_chunks.begin(), file_chunks.end());
+    }
+}
+
+/**
+ * Read the text shards with all the OpenMP threads, in the order of the shards
+ * and the lines. The first pass counts edges of each chunk, so that the second
+ * pass could parse each chunk straight into its own range of the presized
+ * edge array.
+ */
+template<typename P, typename E>
+void read_text_shards(const std::vector<std::string> &paths, const P &parser, std::vector<E> &edges) {
+    std::vector<std::unique_ptr<MappedFile> > files;
+    std::vector<TextChunk> chunks;
+    map_text_shards(paths, parser, files, chunks);
+
+    std::vector<edge_id_t> chunk_edge_begin(chunks.size() + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t c_i = 0; c_i < chunks.size(); c_i++) {
+        chunk_edge_begin[c_i + 1] = parser.foreach_edge(chunks[c_i].begin, chunks[c_i].end, EdgeDiscarder());
+    }
+    for (size_t c_i = 0; c_i < chunks.size(); c_i++) {
+        chunk_edge_begin[c_i + 1] += chunk_edge_begin[c_i];
+    }
+
     edges.clear();
-    vertex_id_t a, b;
-    char temp_str[200];
-    FILE *f = fopen(fname, "r");
-    CHECK(f != NULL);
-    while (fgets(temp_str, 200, f)) {
-        if (temp_str[0] == '#') {
-            continue;
+    edges.resize(chunk_edge_begin[chunks.size()]);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t c_i = 0; c_i < chunks.size(); c_i++) {
+        parser.foreach_edge(chunks[c_i].begin, chunks[c_i].end, EdgeWriter<E>(edges.data() + chunk_edge_begin[c_i]));
+    }
+}
+
+void read_text_graph(const std::vector<std::string> &paths, std::vector<Edge> &edges) {
+    read_text_shards(paths, EdgeListParser(), edges);
+}
+
+void read_text_graph(const char* fname, std::vector<Edge> &edges) {
+    read_text_graph(std::vector<std::string>(1, fname), edges);
+}
+
+void read_text_graph(const std::vector<std::string> &paths, std::vector<WeightedEdge> &edges) {
+    read_text_shards(paths, WeightedEdgeListParser(), edges);
+}
+
+void read_text_graph(const std::vector<std::string> &paths, std::vector<TemporalEdge> &edges) {
+    read_text_shards(paths, TemporalEdgeListParser(), edges);
+}
+
+/**
+ * Read the binary shards with all the OpenMP threads. The shards are cut into
+ * pieces, which are copied into their own ranges of the presized array.
+ */
+template<typename T>
+void read_binary_graph(const std::vector<std::string> &paths, std::vector<T> &edges) {
+    const size_t piece_size = (64ul << 20) / sizeof(T) * sizeof(T);
+    std::vector<std::unique_ptr<MappedFile> > files;
+    // File, offset in the file, and offset in the array, of each piece
+    std::vector<std::pair<size_t, size_t> > pieces;
+    std::vector<size_t> piece_dst;
+    size_t total_size = 0;
+    for (auto &path : paths) {
+        files.emplace_back(new MappedFile(path.c_str()));
+        size_t size = files.back()->size / sizeof(T) * sizeof(T);
+        for (size_t offset = 0; offset < size; offset += piece_size) {
+            pieces.push_back(std::make_pair(files.size() - 1, offset));
+            piece_dst.push_back(total_size + offset);
         }
-        sscanf(temp_str, "%u %u", &a, &b);
-        edges.push_back(Edge(a, b));
+        total_size += size;
     }
-    fclose(f);
+    edges.resize(total_size / sizeof(T));
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t p_i = 0; p_i < pieces.size(); p_i++) {
+        auto &f = *files[pieces[p_i].first];
+        size_t size = std::min(piece_size, f.size / sizeof(T) * sizeof(T) - pieces[p_i].second);
+        memcpy(reinterpret_cast<char*>(edges.data()) + piece_dst[p_i], f.data + pieces[p_i].second, size);
+    }
+}
+
+// "00" to "99", for converting two digits at a time
+static const char text_digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// The number of decimal digits of val
+template<typename T>
+inline int text_uint_size(T val) {
+    int len = 1;
+    while (val >= 100) {
+        val /= 100;
+        len += 2;
+    }
+    return val >= 10 ? len + 1 : len;
+}
+
+/**
+ * Write a decimal unsigned integer to p, and return the position after it.
+ * Digits are produced in pairs from the end with a lookup table.
+ */
+template<typename T>
+inline char* format_text_uint(char* p, T val) {
+    int len = text_uint_size(val);
+    char* q = p + len;
+    while (val >= 100) {
+        unsigned pair = (val % 100) * 2;
+        val /= 100;
+        *--q = text_digit_pairs[pair + 1];
+        *--q = text_digit_pairs[pair];
+    }
+    if (val >= 10) {
+        *--q = text_digit_pairs[val * 2 + 1];
+        *--q = text_digit_pairs[val * 2];
+    } else {
+        *--q = '0' + val;
+    }
+    return p + len;
+}
+
+void pwrite_all(int fd, const char* data, size_t size, size_t offset) {
+    while (size != 0) {
+        ssize_t ret = pwrite(fd, data, size, offset);
+        CHECK(ret > 0) << "Fail to write: " << strerror(errno);
+        data += ret;
+        size -= ret;
+        offset += ret;
+    }
+}
+
+/**
+ * Call func(src, dst) on each edge of the graph shards with all the OpenMP
+ * threads, in no particular order. The shards are mapped into memory instead
+ * of being read into an edge array, so that the pages could be dropped by the
+ * kernel, and a graph larger than the free memory could be scanned.
+ */
+template<typename F>
+edge_id_t foreach_graph_edge(const std::vector<std::string> &paths, GraphFormat graph_format, F func) {
+    edge_id_t e_num = 0;
+    if (graph_format == BinaryGraphFormat) {
+        for (auto &path : paths) {
+            MappedFile f(path.c_str());
+            const Edge* edges = reinterpret_cast<const Edge*>(f.data);
+            edge_id_t file_e_num = f.size / sizeof(Edge);
+            #pragma omp parallel for
+            for (edge_id_t e_i = 0; e_i < file_e_num; e_i++) {
+                func(edges[e_i].src, edges[e_i].dst);
+            }
+            e_num += file_e_num;
+        }
+    } else {
+        EdgeListParser parser;
+        std::vector<std::unique_ptr<MappedFile> > files;
+        std::vector<TextChunk> chunks;
+        map_text_shards(paths, parser, files, chunks);
+        #pragma omp parallel for schedule(dynamic, 1) reduction (+: e_num)
+        for (size_t c_i = 0; c_i < chunks.size(); c_i++) {
+            e_num += parser.foreach_edge(chunks[c_i].begin, chunks[c_i].end, func);
+        }
+    }
+    return e_num;
+}
+
+template<typename F>
+edge_id_t foreach_graph_edge(const char* fname, GraphFormat graph_format, F func) {
+    return foreach_graph_edge(std::vector<std::string>(1, fname), graph_format, func);
 }
 
 void write_text_graph(const char* fname, std::vector<Edge> &edges, std::stringstream &ss) {
@@ -94,7 +637,7 @@ void write_text_graph(const char* fname, std::vector<Edge> &edges, std::stringst
     CHECK(out_f != NULL);
     fprintf(out_f, "%s", ss.str().c_str());
     for (auto &e : edges) {
-        fprintf(out_f, "%u %u\n", e.src, e.dst);
+        fprintf(out_f, "%llu %llu\n", (unsigned long long) e.src, (unsigned long long) e.dst);
     }
     fclose(out_f);
 }
@@ -103,3 +646,21 @@ void write_text_graph(const char* fname, std::vector<Edge> &edges) {
     std::stringstream ss;
     write_text_graph(fname, edges, ss);
 }
+
+void write_text_graph(const char* fname, std::vector<WeightedEdge> &edges) {
+    FILE *out_f = fopen(fname, "w");
+    CHECK(out_f != NULL);
+    for (auto &e : edges) {
+        fprintf(out_f, "%llu %llu %.9g\n", (unsigned long long) e.src, (unsigned long long) e.dst, (double) e.weight);
+    }
+    fclose(out_f);
+}
+
+void write_text_graph(const char* fname, std::vector<TemporalEdge> &edges) {
+    FILE *out_f = fopen(fname, "w");
+    CHECK(out_f != NULL);
+    for (auto &e : edges) {
+        fprintf(out_f, "%llu %llu %llu\n", (unsigned long long) e.src, (unsigned long long) e.dst, (unsigned long long) e.time);
+    }
+    fclose(out_f);
+}
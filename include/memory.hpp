@@ -3,6 +3,9 @@
 #include <stdlib.h>
 
 #include <mutex>
+#include <algorithm>
+
+#include <omp.h>
 
 #include "numa_helper.hpp"
 #include "constants.hpp"
@@ -12,6 +15,8 @@
 #define MemoryInterleaved -2
 // Memory alignment is set to cache line size
 #define MemoryDataAlignment CacheLineSize
+// Smaller memory is not touched in parallel when allocated
+#define MemoryTouchMinSize (1ul << 20)
 
 /**
  * A counter that counting how many memory are needed.
@@ -74,6 +79,10 @@ public:
  *   The memory address must be the begining of a page.
  * - A non-negative integer: Allocate memory to the specified NUMA node.
  *   The memory address must be the begining of a page.
+ * With a huge page mode, the memory is mapped by map_pages and bound to the
+ * NUMA option in the same way.
+ * The memory is zero-initialized. Except for MemoryIgnoreNuma without huge pages,
+ * it's mapped by the kernel and zeroed lazily, when each page is first touched.
  * The memory is either aligned or non-aligned:
  * - Non-aligned allocation: The memory size may not be a multipe of MemoryDataAlignment.
  * - Aligned allocation: The memory size is rounded to a multipe of MemoryDataAlignment.
@@ -89,17 +98,27 @@ class Memory {
     size_t data_size;
     // NUMA option
     int numa;
+    // The memory is mapped with map_pages unless it's HugePageOff
+    HugePageMode hugepage_mode;
     // The counter serves like an iterator for return memory address
     // of multiple memory segments.
     MemoryCounter mcounter;
 
-    Memory(MemoryCounter *pre_counter, int _numa = MemoryIgnoreNuma) {
+    Memory(MemoryCounter *pre_counter, int _numa = MemoryIgnoreNuma, HugePageMode _hugepage_mode = HugePageOff) {
         // Ensure alignement
         CHECK(pre_counter->is_aligned());
         data_size = pre_counter->get_data_size();
         numa = _numa;
+        hugepage_mode = _hugepage_mode;
         if (data_size != 0) {
-            if (numa == MemoryIgnoreNuma) {
+            if (hugepage_mode != HugePageOff) {
+                data = map_pages(data_size, hugepage_mode);
+                if (numa == MemoryInterleaved) {
+                    numa_interleave_memory(data, get_map_size(data_size, hugepage_mode), numa_all_nodes_ptr);
+                } else if (numa != MemoryIgnoreNuma) {
+                    numa_tonode_memory(data, get_map_size(data_size, hugepage_mode), numa);
+                }
+            } else if (numa == MemoryIgnoreNuma) {
                 data = aligned_alloc(MemoryDataAlignment, data_size);
             } else if (numa == MemoryInterleaved) {
                 data = numa_alloc_interleaved(data_size);
@@ -107,7 +126,10 @@ class Memory {
                 data = numa_alloc_onnode(data_size, numa);
             }
             CHECK(data != NULL);
-            memset(data, 0, data_size);
+            // The mapped memory is zeroed by the kernel when it's first touched
+            if (hugepage_mode == HugePageOff && numa == MemoryIgnoreNuma) {
+                memset(data, 0, data_size);
+            }
         } else {
             data = NULL;
         }
@@ -118,7 +140,9 @@ public:
         if (data != NULL) {
             // Ensure alignement
             CHECK(mcounter.get_data_size() == data_size);
-            if (numa == MemoryIgnoreNuma) {
+            if (hugepage_mode != HugePageOff) {
+                unmap_pages(data, data_size, hugepage_mode);
+            } else if (numa == MemoryIgnoreNuma) {
                 free(data);
             } else {
                 numa_free(data, data_size);
@@ -177,6 +201,37 @@ class MemoryPool {
     std::mutex lock;
     MultiThreadConfig mtcfg;
 
+    /**
+     * Touch the pages of large memory in parallel with the threads on its NUMA
+     * node, or with all the threads if it's not bound to a node, so that the
+     * memory is faulted in with all the cores instead of at its first use.
+     * Memory allocated in parallel regions is left to be touched by its user.
+     */
+    void touch_memory(Memory* memory) {
+        if (memory->data == NULL || memory->data_size < MemoryTouchMinSize || omp_in_parallel()
+            || (memory->hugepage_mode == HugePageOff && memory->numa == MemoryIgnoreNuma)) {
+            return;
+        }
+        char* data = static_cast<char*>(memory->data);
+        int numa = memory->numa;
+        #pragma omp parallel
+        {
+            int thread_id = omp_get_thread_num();
+            int worker_num = mtcfg.thread_num;
+            int worker_id = thread_id;
+            if (numa >= 0) {
+                worker_num = mtcfg.socket_thread_num();
+                worker_id = (thread_id < mtcfg.thread_num && mtcfg.get_socket_mapping(mtcfg.socket_id(thread_id)) == numa) ? mtcfg.socket_offset(thread_id) : worker_num;
+            }
+            if (worker_id < worker_num) {
+                size_t range = (memory->data_size + worker_num - 1) / worker_num;
+                size_t begin = std::min(memory->data_size, range * worker_id);
+                size_t end = std::min(memory->data_size, begin + range);
+                touch_pages(data + begin, data + end);
+            }
+        }
+    }
+
     int get_rectified_numa(int numa) {
         if (!mtcfg.with_numa()) {
             // If the configuration states that NUMA is not supported
@@ -207,7 +262,8 @@ public:
     Memory* get_memory(MemoryCounter *mcounter, int numa = MemoryIgnoreNuma) {
         numa = get_rectified_numa(numa);
 
-        Memory *memory = new Memory(mcounter, numa);
+        Memory *memory = new Memory(mcounter, numa, mtcfg.hugepage_mode);
+        touch_memory(memory);
         std::lock_guard<std::mutex> guard(lock);
         pool.push_back(memory);
         return memory;
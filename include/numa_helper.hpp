@@ -21,6 +21,7 @@
 #include "type.hpp"
 #include "compile_helper.hpp"
 #include "sysinfo.hpp"
+#include "constants.hpp"
 
 /**
  * Return at which NUMA node this memory is.
@@ -170,3 +171,110 @@ template<typename T>
 T * numa_dealloc_interleaved_array(T * array, size_t num) {
     numa_free(array, sizeof(T) * num);
 }
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+/**
+ * The page size of the memory in the huge page mode.
+ * Memory smaller than a huge page is mapped with smaller pages, so that
+ * small allocations don't take a whole huge page each: with HugePage1G,
+ * memory smaller than 1 GiB is mapped with 2 MiB pages, and memory smaller
+ * than 2 MiB with 4 KiB pages in all the modes.
+ */
+size_t get_page_size(size_t size, HugePageMode mode) {
+    if (mode == HugePage1G && size >= (1ull << 30)) {
+        return 1ull << 30;
+    }
+    if (mode != HugePageOff && size >= (1ull << 21)) {
+        return 1ull << 21;
+    }
+    return PageSize;
+}
+
+// The mapped size of the memory, which is rounded up to its page size
+size_t get_map_size(size_t size, HugePageMode mode) {
+    size_t page_size = get_page_size(size, mode);
+    return (size + page_size - 1) / page_size * page_size;
+}
+
+/**
+ * Map anonymous memory with the huge page mode:
+ * - HugePageOff: 4 KiB pages.
+ * - HugePageTHP: memory aligned to 2 MiB and advised to be backed by
+ *   transparent huge pages.
+ * - HugePage2M, HugePage1G: the huge pages reserved in hugetlbfs.
+ *   If there are not enough reserved pages, fall back to HugePageTHP.
+ * The memory is not touched yet, so it could be bound to NUMA nodes before
+ * being faulted in. It should be freed with unmap_pages.
+ */
+char* map_pages(size_t size, HugePageMode mode) {
+    size_t page_size = get_page_size(size, mode);
+    size_t map_size = get_map_size(size, mode);
+    if (page_size == PageSize) {
+        void* p = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        CHECK(p != MAP_FAILED) << "Cannot map " << map_size << " bytes";
+        return (char*) p;
+    }
+    if (mode == HugePage2M || mode == HugePage1G) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (page_size == (1ull << 30) ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+        void* p = mmap(NULL, map_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p != MAP_FAILED) {
+            return (char*) p;
+        }
+        LOG(WARNING) << "Not enough reserved huge pages for " << map_size << " bytes, use transparent huge pages instead";
+    }
+    // Over-map by a huge page and trim both ends to align the memory
+    const size_t thp_size = 1ull << 21;
+    void* p = mmap(NULL, map_size + thp_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(p != MAP_FAILED) << "Cannot map " << map_size << " bytes";
+    char* begin = (char*) p;
+    char* aligned = (char*) (((uintptr_t) begin + thp_size - 1) / thp_size * thp_size);
+    if (aligned != begin) {
+        munmap(begin, aligned - begin);
+    }
+    size_t tail_size = begin + thp_size - aligned;
+    if (tail_size != 0) {
+        munmap(aligned + map_size, tail_size);
+    }
+    madvise(aligned, map_size, MADV_HUGEPAGE);
+    return aligned;
+}
+
+void unmap_pages(void* p, size_t size, HugePageMode mode) {
+    CHECK(0 == munmap(p, get_map_size(size, mode)));
+}
+
+/**
+ * Bind the bytes [begin, end) of the memory mapped by map_pages to the NUMA node.
+ * The bound range is aligned to the page size, so each huge page is bound to the
+ * node of the range holding its first byte.
+ */
+void numa_tonode_pages(char* array, size_t size, HugePageMode mode, size_t begin, size_t end, int node) {
+    size_t page_size = get_page_size(size, mode);
+    size_t map_size = get_map_size(size, mode);
+    begin = std::min(map_size, (begin + page_size - 1) / page_size * page_size);
+    end = end == size ? map_size : std::min(map_size, (end + page_size - 1) / page_size * page_size);
+    if (end > begin) {
+        numa_tonode_memory(array + begin, end - begin, node);
+    }
+}
+
+/**
+ * Fault in the pages overlapping [begin, end) by writing a zero to each of them,
+ * so they are placed by the NUMA policy of the memory, or by the first-touch
+ * policy on the node of the calling thread.
+ * The memory must still be zero, e.g. freshly mapped.
+ */
+void touch_pages(char* begin, char* end) {
+    for (char* p = begin; p < end; p = (char*) (((uintptr_t) p / PageSize + 1) * PageSize)) {
+        *(volatile char*) p = 0;
+    }
+}
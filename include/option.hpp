@@ -3,6 +3,7 @@
 #include <numa.h>
 
 #include <iostream>
+#include <sstream>
 #include <thread>
 #include <memory>
 
@@ -136,6 +137,7 @@ private:
     args::ValueFlag<int> socket_num_flag;
     args::ValueFlag<std::string> socket_mapping_flag;
     args::ValueFlag<uint64_t> mem_quota_flag;
+    args::ValueFlag<std::string> hugepages_flag;
 public:
     MultiThreadConfig mtcfg;
     uint64_t mem_quota;
@@ -143,7 +145,8 @@ public:
         thread_num_flag(parser, "threads", "[optional] number of threads this program will use", {'t'}),
         socket_num_flag(parser, "sockets", "[optional] number of sockets", {'s'}),
         socket_mapping_flag(parser, "socket-mapping", "[optional] example: --socket-mapping=0,1,2,3", {"socket-mapping"}),
-        mem_quota_flag(parser, "mem", "[optional] Maximum memory this program will use (in GiB)", {"mem"})
+        mem_quota_flag(parser, "mem", "[optional] Maximum memory this program will use (in GiB)", {"mem"}),
+        hugepages_flag(parser, "hugepages", "[optional] pages backing the graph and walkers: off | thp | 2m | 1g", {"hugepages"})
     {}
     virtual void parse() {
         if (socket_num_flag) {
@@ -199,6 +202,21 @@ public:
 
         mtcfg.l2_cache_size = get_l2_cache_size();
         LOG(WARNING) << block_mid_str() << "L2 cache size: " << size_string(mtcfg.l2_cache_size);
+
+        std::string hugepages_str = hugepages_flag ? args::get(hugepages_flag) : std::string("off");
+        if (hugepages_str == "off") {
+            mtcfg.hugepage_mode = HugePageOff;
+        } else if (hugepages_str == "thp") {
+            mtcfg.hugepage_mode = HugePageTHP;
+        } else if (hugepages_str == "2m") {
+            mtcfg.hugepage_mode = HugePage2M;
+        } else if (hugepages_str == "1g") {
+            mtcfg.hugepage_mode = HugePage1G;
+        } else {
+            std::cerr << "[error] Unknown huge page mode: " << hugepages_str << std::endl;
+            exit(1);
+        }
+        LOG(WARNING) << block_mid_str() << "Huge pages: " << hugepages_str;
     }
 };
 
@@ -206,11 +224,29 @@ class GraphOptionHelper : public FormatOptionHelper
 {
 private:
     args::ValueFlag<std::string> graph_path_flag;
+    args::Flag snapshot_flag;
+    args::Flag streaming_flag;
+    args::Flag directed_flag;
+    args::Flag clean_edges_flag;
+    args::Flag weighted_flag;
+    args::Flag temporal_flag;
 public:
     std::string graph_path;
+    bool use_snapshot;
+    bool streaming;
+    bool as_undirected;
+    bool clean_edges;
+    bool weighted;
+    bool temporal;
     GraphOptionHelper(args::ArgumentParser &parser):
         FormatOptionHelper(parser),
-        graph_path_flag(parser, "graph", "graph path", {'g'})
+        graph_path_flag(parser, "graph", "graph path, or a directory or glob of graph shards", {'g'}),
+        snapshot_flag(parser, "snapshot", "reuse or create the preprocessed graph snapshot", {"snapshot"}),
+        streaming_flag(parser, "streaming", "build the graph in two passes over the file without holding the edge list", {"streaming"}),
+        directed_flag(parser, "directed", "[optional] walk along the edges as given, without adding the reverse edges", {"directed"}),
+        clean_edges_flag(parser, "clean-edges", "[optional] remove self-loops and duplicate edges while loading", {"clean-edges"}),
+        weighted_flag(parser, "weighted", "[optional] sample the edges by their weights, given as the third column of text graphs or by binary graphs of weighted edges", {"weighted"}),
+        temporal_flag(parser, "temporal", "[optional] walk along edges of non-decreasing times, given as the third column of text graphs or by binary graphs of temporal edges", {"temporal"})
     {
     }
     virtual void parse() override {
@@ -218,8 +254,20 @@ public:
 
         CHECK(graph_path_flag);
         graph_path = args::get(graph_path_flag);
+        use_snapshot = snapshot_flag ? true : false;
+        streaming = streaming_flag ? true : false;
+        as_undirected = directed_flag ? false : true;
+        clean_edges = clean_edges_flag ? true : false;
+        weighted = weighted_flag ? true : false;
+        temporal = temporal_flag ? true : false;
 
         LOG(WARNING) << block_mid_str() << "Graph path: " << graph_path;
+        LOG(WARNING) << block_mid_str() << "Graph snapshot: " << (use_snapshot ? "true" : "false");
+        LOG(WARNING) << block_mid_str() << "Streaming construction: " << (streaming ? "true" : "false");
+        LOG(WARNING) << block_mid_str() << "Directed: " << (as_undirected ? "false" : "true");
+        LOG(WARNING) << block_mid_str() << "Clean edges: " << (clean_edges ? "true" : "false");
+        LOG(WARNING) << block_mid_str() << "Weighted: " << (weighted ? "true" : "false");
+        LOG(WARNING) << block_mid_str() << "Temporal: " << (temporal ? "true" : "false");
     }
 };
 
@@ -229,14 +277,20 @@ private:
     args::ValueFlag<int> epoch_num_flag;
     args::ValueFlag<uint64_t> walker_num_flag;
     args::ValueFlag<int> walk_len_flag;
+    args::ValueFlag<std::string> dead_end_flag;
+    args::ValueFlag<real_t> termination_flag;
 public:
     int epoch_num;
     uint64_t walker_num;
     int walk_len;
+    DeadEndMode dead_end_mode;
+    real_t termination_prob;
     WalkOptionHelper(args::ArgumentParser &parser):
         epoch_num_flag(parser, "epoch", "walk epoch number", {'e'}),
         walker_num_flag(parser, "walker", "walker number", {'w'}),
-        walk_len_flag(parser, "length", "walk length", {'l'})
+        walk_len_flag(parser, "length", "walk length", {'l'}),
+        dead_end_flag(parser, "dead-end", "[optional] what walkers do at vertices without out-edges: stop | restart | self-loop", {"dead-end"}),
+        termination_flag(parser, "termination", "[optional] probability that a walk ends before each step, e.g. 0.15 for random walks with restart, where the walk length is the max length", {"termination"})
     {
     }
     virtual void parse() {
@@ -258,6 +312,23 @@ public:
         CHECK(walk_len_flag);
         walk_len = args::get(walk_len_flag);
         LOG(WARNING) << block_mid_str() << "Walk length: " << walk_len;
+
+        std::string dead_end_str = dead_end_flag ? args::get(dead_end_flag) : std::string("stop");
+        if (dead_end_str == "stop") {
+            dead_end_mode = DeadEndStop;
+        } else if (dead_end_str == "restart") {
+            dead_end_mode = DeadEndRestart;
+        } else if (dead_end_str == "self-loop") {
+            dead_end_mode = DeadEndSelfLoop;
+        } else {
+            std::cerr << "[error] Unknown dead-end mode: " << dead_end_str << std::endl;
+            exit(1);
+        }
+        LOG(WARNING) << block_mid_str() << "Dead-end mode: " << dead_end_str;
+
+        termination_prob = termination_flag ? args::get(termination_flag) : 0;
+        CHECK(termination_prob >= 0 && termination_prob < 1) << "The termination probability must be in [0, 1)";
+        LOG(WARNING) << block_mid_str() << "Termination probability: " << termination_prob;
     }
 
     uint64_t get_walker_num(vertex_id_t vertex_num) {
@@ -276,6 +347,47 @@ public:
     }
 };
 
+class WalkOutputOptionHelper
+{
+private:
+    args::ValueFlag<std::string> output_path_flag;
+    args::ValueFlag<std::string> output_format_flag;
+    args::Flag direct_io_flag;
+public:
+    // Empty if the walks are not written
+    std::string output_path;
+    WalkOutputFormat output_format;
+    bool direct_io;
+    WalkOutputOptionHelper(args::ArgumentParser &parser):
+        output_path_flag(parser, "output", "[optional] path prefix of the walk output shards", {'o'}),
+        output_format_flag(parser, "out-format", "[optional] walk output format: binary | text | corpus | archive", {"out-format"}),
+        direct_io_flag(parser, "direct-io", "[optional] write the walk output with O_DIRECT", {"direct-io"})
+    {
+    }
+    virtual void parse() {
+        output_path = output_path_flag ? args::get(output_path_flag) : std::string();
+        std::string output_format_str = output_format_flag ? args::get(output_format_flag) : std::string("binary");
+        if (output_format_str == "binary") {
+            output_format = BinaryWalkOutputFormat;
+        } else if (output_format_str == "text") {
+            output_format = TextWalkOutputFormat;
+        } else if (output_format_str == "corpus") {
+            output_format = CorpusWalkOutputFormat;
+        } else if (output_format_str == "archive") {
+            output_format = ArchiveWalkOutputFormat;
+        } else {
+            std::cerr << "[error] Unknown walk output format: " << output_format_str << std::endl;
+            exit(1);
+        }
+        direct_io = direct_io_flag ? true : false;
+        if (!output_path.empty()) {
+            LOG(WARNING) << block_mid_str() << "Walk output: " << output_path;
+            LOG(WARNING) << block_mid_str() << "Walk output format: " << output_format_str;
+            LOG(WARNING) << block_mid_str() << "Direct I/O: " << (direct_io ? "true" : "false");
+        }
+    }
+};
+
 class InOutOptionParser: public OptionParser, public InOutOptionHelper
 {
 public:
@@ -331,20 +443,22 @@ public:
     }
 };
 
-class WalkOptionParser: public OptionParser, public NumaOptionHelper, public GraphOptionHelper, public WalkOptionHelper
+class WalkOptionParser: public OptionParser, public NumaOptionHelper, public GraphOptionHelper, public WalkOptionHelper, public WalkOutputOptionHelper
 {
 public:
     WalkOptionParser():
         OptionParser(),
         NumaOptionHelper(parser),
         GraphOptionHelper(parser),
-        WalkOptionHelper(parser)
+        WalkOptionHelper(parser),
+        WalkOutputOptionHelper(parser)
     {}
     virtual void parse(int argc, char** argv) override {
        OptionParser::parse(argc, argv);
        NumaOptionHelper::parse();
        GraphOptionHelper::parse();
        WalkOptionHelper::parse();
+       WalkOutputOptionHelper::parse();
     }
 };
 
@@ -353,12 +467,15 @@ class Node2vecOptionHelper
 private:
     args::ValueFlag<real_t> p_flag;
     args::ValueFlag<real_t> q_flag;
+    args::ValueFlag<uint64_t> alias_mem_flag;
 public:
     real_t p;
     real_t q;
+    uint64_t alias_mem;
     Node2vecOptionHelper(args::ArgumentParser &parser):
         p_flag(parser, "p", "node2vec parameter p", {'p'}),
-        q_flag(parser, "q", "node2vec parameter q", {'q'})
+        q_flag(parser, "q", "node2vec parameter q", {'q'}),
+        alias_mem_flag(parser, "alias-mem", "[optional] Maximum memory of the second-order alias tables for low-degree partitions (in MiB), 0 by default", {"alias-mem"})
     {
     }
     virtual void parse() {
@@ -369,6 +486,9 @@ public:
         CHECK(q_flag);
         q = args::get(q_flag);
         LOG(WARNING) << block_mid_str() << "q: " << q;
+
+        alias_mem = alias_mem_flag ? args::get(alias_mem_flag) << 20u : 0;
+        LOG(WARNING) << block_mid_str() << "Second-order alias table memory: " << size_string(alias_mem);
     }
 };
 
@@ -384,3 +504,49 @@ public:
        Node2vecOptionHelper::parse();
     }
 };
+
+class MetapathOptionHelper
+{
+private:
+    args::ValueFlag<std::string> vertex_type_flag;
+    args::ValueFlag<std::string> metapath_flag;
+public:
+    std::string vertex_type_path;
+    std::vector<vertex_type_t> metapath;
+    MetapathOptionHelper(args::ArgumentParser &parser):
+        vertex_type_flag(parser, "vertex-types", "path of the vertex types, with lines of \"vertex type\"", {"vertex-types"}),
+        metapath_flag(parser, "metapath", "vertex types the walks follow repeatedly, example: --metapath=0,1,2,1", {"metapath"})
+    {
+    }
+    virtual void parse() {
+        CHECK(vertex_type_flag);
+        vertex_type_path = args::get(vertex_type_flag);
+        LOG(WARNING) << block_mid_str() << "Vertex types: " << vertex_type_path;
+
+        CHECK(metapath_flag);
+        std::string metapath_str = args::get(metapath_flag);
+        std::stringstream ss(metapath_str);
+        std::string type_str;
+        metapath.clear();
+        while (std::getline(ss, type_str, ',')) {
+            int type = std::stoi(type_str);
+            CHECK(type >= 0 && type < MaxVertexType) << "Invalid vertex type in the metapath: " << type_str;
+            metapath.push_back(type);
+        }
+        CHECK(metapath.size() != 0);
+        LOG(WARNING) << block_mid_str() << "Metapath: " << metapath_str;
+    }
+};
+
+class MetapathOptionParser: public WalkOptionParser, public MetapathOptionHelper
+{
+public:
+    MetapathOptionParser():
+        WalkOptionParser(),
+        MetapathOptionHelper(parser)
+    {}
+    virtual void parse(int argc, char** argv) override {
+       WalkOptionParser::parse(argc, argv);
+       MetapathOptionHelper::parse();
+    }
+};
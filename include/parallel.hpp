@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <omp.h>
+
+/**
+ * Parallel building blocks for graph preprocessing.
+ */
+
+/**
+ * Exclusive prefix sum with all the OpenMP threads.
+ * out has num + 1 elements, with out[0] = 0 and out[num] being the total sum.
+ * Each thread sums up its own contiguous range first, then the range offsets
+ * are accumulated serially, and at last each thread fills its range.
+ */
+template<typename T, typename U>
+void parallel_prefix_sum(const T* in, U* out, size_t num) {
+    int thread_num = omp_get_max_threads();
+    size_t range = (num + thread_num - 1) / thread_num;
+    std::vector<U> range_sum(thread_num + 1, 0);
+    #pragma omp parallel num_threads(thread_num)
+    {
+        int t = omp_get_thread_num();
+        size_t begin = std::min(num, range * t);
+        size_t end = std::min(num, begin + range);
+        U sum = 0;
+        for (size_t i = begin; i < end; i++) {
+            sum += in[i];
+        }
+        range_sum[t + 1] = sum;
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int t_i = 0; t_i < thread_num; t_i++) {
+                range_sum[t_i + 1] += range_sum[t_i];
+            }
+        }
+        sum = range_sum[t];
+        for (size_t i = begin; i < end; i++) {
+            out[i] = sum;
+            sum += in[i];
+        }
+    }
+    out[num] = range_sum[thread_num];
+}
+
+/**
+ * A bitmap that could be set concurrently.
+ */
+class ConcurrentBitmap {
+public:
+    std::vector<uint64_t> words;
+
+    void resize(size_t bit_num) {
+        words.resize((bit_num + 63) / 64);
+        #pragma omp parallel for
+        for (size_t w_i = 0; w_i < words.size(); w_i++) {
+            words[w_i] = 0;
+        }
+    }
+
+    bool get(size_t bit) const {
+        return (words[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    void set(size_t bit) {
+        uint64_t mask = 1ull << (bit & 63);
+        if (!(words[bit >> 6] & mask)) {
+            __sync_fetch_and_or(&words[bit >> 6], mask);
+        }
+    }
+
+    /**
+     * word_ranks[w] is the number of set bits before word w,
+     * and word_ranks[words.size()] is the number of all set bits.
+     */
+    void get_word_ranks(std::vector<size_t> &word_ranks) const {
+        std::vector<size_t> word_counts(words.size());
+        #pragma omp parallel for
+        for (size_t w_i = 0; w_i < words.size(); w_i++) {
+            word_counts[w_i] = __builtin_popcountll(words[w_i]);
+        }
+        word_ranks.resize(words.size() + 1);
+        parallel_prefix_sum(word_counts.data(), word_ranks.data(), words.size());
+    }
+
+    // The number of set bits before the given bit
+    size_t rank(const std::vector<size_t> &word_ranks, size_t bit) const {
+        uint64_t lower = words[bit >> 6] & ((1ull << (bit & 63)) - 1);
+        return word_ranks[bit >> 6] + __builtin_popcountll(lower);
+    }
+};
@@ -21,11 +21,15 @@ public:
     /**
      * Generate random integer from [0, upper_bound)
      */
-    virtual uint32_t gen(uint32_t upper_bound) = 0;
+    virtual vertex_id_t gen(vertex_id_t upper_bound) = 0;
     /**
      * Generate random float from [0, upper_bound)
      */
     virtual float gen_float(float upper_bound) = 0;
+    /**
+     * Generate random integer from [0, 2^32)
+     */
+    virtual uint32_t gen_uint32() = 0;
     /**
      * Print the name of this generator
      */
@@ -56,7 +60,7 @@ public:
     std::string name() {
         return std::string("std::mt19937");
     }
-    uint32_t gen(uint32_t upper_bound)
+    vertex_id_t gen(vertex_id_t upper_bound)
     {
         std::uniform_int_distribution<vertex_id_t> dis(0, upper_bound - 1);
         return dis(*mt);
@@ -71,6 +75,10 @@ public:
         std::uniform_real_distribution<float> dis(0.0, upper_bound);
         return dis(*mt);
     }
+    uint32_t gen_uint32()
+    {
+        return (*mt)();
+    }
 };
 
 /**
@@ -93,7 +101,7 @@ public:
     std::string name() {
         return std::string("rand_r");
     }
-    uint32_t gen(uint32_t upper_bound)
+    vertex_id_t gen(vertex_id_t upper_bound)
     {
         return rand_r(&seed) % upper_bound;
     }
@@ -101,6 +109,12 @@ public:
     {
         return (float) rand_r(&seed) / (float) RAND_MAX * upper_bound;
     }
+    uint32_t gen_uint32()
+    {
+        // rand_r gives at most 31 bits
+        uint32_t high = rand_r(&seed) & 0xFFFF;
+        return (high << 16) | (rand_r(&seed) & 0xFFFF);
+    }
 };
 
 /**
@@ -123,10 +137,10 @@ public:
     std::string name() {
         return std::string("multiplication");
     }
-    uint32_t gen(uint32_t upper_bound)
+    vertex_id_t gen(vertex_id_t upper_bound)
     {
-        // the mod of uint64_t is too slow
-        uint32_t ret = (uint32_t) seed % upper_bound;
+        // the mod of uint64_t is too slow, unless vertex_id_t is 64-bit
+        vertex_id_t ret = (vertex_id_t) seed % upper_bound;
         seed = seed * (unsigned long long)25214903917 + 11;
         return ret;
     }
@@ -136,6 +150,13 @@ public:
         seed = seed * (unsigned long long)25214903917 + 11;
         return (float) temp / (float) 65535 * upper_bound;
     }
+    uint32_t gen_uint32()
+    {
+        // the high bits of the linear congruential generator are more random
+        uint32_t ret = seed >> 16;
+        seed = seed * (unsigned long long)25214903917 + 11;
+        return ret;
+    }
 };
 
 /**
@@ -158,9 +179,9 @@ public:
     std::string name() {
         return std::string("xorshift*");
     }
-    uint32_t gen(uint32_t upper_bound)
+    vertex_id_t gen(vertex_id_t upper_bound)
     {
-        uint32_t ret = seed * UINT64_C(0x2545F4914F6CDD1D);
+        vertex_id_t ret = seed * UINT64_C(0x2545F4914F6CDD1D);
         seed ^= seed >> 12;
         seed ^= seed << 25;
         seed ^= seed >> 27;
@@ -174,6 +195,14 @@ public:
         seed ^= seed >> 27;
         return (float) ret / (float) 65535 * upper_bound;
     }
+    uint32_t gen_uint32()
+    {
+        uint32_t ret = (seed * UINT64_C(0x2545F4914F6CDD1D)) >> 32;
+        seed ^= seed >> 12;
+        seed ^= seed << 25;
+        seed ^= seed >> 27;
+        return ret;
+    }
 };
 
 // Set the default random number generator
@@ -45,6 +45,26 @@ uint64_t get_sys_mem() {
     return 0; // Nothing found
 }
 
+/**
+ * Get how much memory of this process is backed by huge pages, either
+ * transparent or from hugetlbfs, or 0 if it's unknown.
+ */
+uint64_t get_huge_page_mem() {
+    std::string token;
+    std::ifstream file("/proc/self/smaps_rollup");
+    uint64_t total = 0;
+    while(file >> token) {
+        if(token == "AnonHugePages:" || token == "Shared_Hugetlb:" || token == "Private_Hugetlb:") {
+            uint64_t mem;
+            if(file >> mem) {
+                total += mem * 1024u;
+            }
+        }
+        file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return total;
+}
+
 /**
  * Get system NUMA socket amount.
  */
@@ -2,18 +2,63 @@
 
 #include <stdint.h>
 
+/**
+ * The IDs are 32-bit in default. Building with FMOB_ID64 makes them 64-bit for
+ * graphs with more than 4B vertices, which doubles the size of edges and
+ * walks, so binary graphs, walk outputs and snapshots are not shared between
+ * the two builds.
+ */
+#ifdef FMOB_ID64
+typedef uint64_t vertex_id_t;
+typedef uint64_t walker_id_t;
+#else
 typedef uint32_t vertex_id_t;
-typedef uint64_t edge_id_t;
 typedef uint32_t walker_id_t;
+#endif
+typedef uint64_t edge_id_t;
 typedef float real_t;
 typedef uint16_t partition_id_t;
-typedef uint32_t walker_state_t;
+// The previous vertex for node2vec, the metapath position for metapath walks,
+// or the current time for temporal walks
+typedef vertex_id_t walker_state_t;
+// The edge timestamps of temporal graphs, which travel in walker_state_t
+typedef walker_state_t edge_time_t;
+typedef uint8_t vertex_type_t;
+
+// Never a valid vertex ID
+#define MaxVertexId ((vertex_id_t) -1)
+// Pads the paths after the walkers stop
+#define WalkEndVertex MaxVertexId
+// Never a valid vertex type
+#define MaxVertexType ((vertex_type_t) -1)
 
 enum GraphFormat {
 	BinaryGraphFormat,
 	TextGraphFormat
 };
 
+enum WalkOutputFormat {
+	BinaryWalkOutputFormat,
+	TextWalkOutputFormat,
+	CorpusWalkOutputFormat,
+	ArchiveWalkOutputFormat
+};
+
+// What a walker does at a vertex without out-edges
+enum DeadEndMode {
+	DeadEndStop,
+	DeadEndRestart,
+	DeadEndSelfLoop
+};
+
+// The pages backing the large arrays
+enum HugePageMode {
+	HugePageOff,
+	HugePageTHP,
+	HugePage2M,
+	HugePage1G
+};
+
 enum TaskStatus {
     TWORKING,
     TCOMPLETE
@@ -27,6 +72,7 @@ enum TaskStatus {
  *   want to use only the third NUMA node, then we can set the socket_num
  *   as 1 and the socket_mapping as 0->2.
  * - The L2 cache size.
+ * - The huge page mode of the memory allocated with this configuration.
  */
 struct MultiThreadConfig {
 private:
@@ -35,6 +81,7 @@ public:
     int thread_num;
     int socket_num;
     uint64_t l2_cache_size;
+    HugePageMode hugepage_mode = HugePageOff;
 
     bool with_numa() {
         // return socket_num > 1;
@@ -73,5 +120,7 @@ enum SamplerClass {
     ClassSamplerHintNum,
     ClassUniformDegreeDirectSampler,
     ClassSimilarDegreeDirectSampler,
+    ClassAliasSampler,
+    ClassWeightedBufferSampler,
     ClassBaseSampler,
 };
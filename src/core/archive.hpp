@@ -0,0 +1,245 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <omp.h>
+
+#include "type.hpp"
+#include "log.hpp"
+#include "io.hpp"
+
+/**
+ * The FlashMob walk archive stores paths compactly with a block index.
+ *
+ * The walkers of each epoch are sorted by their start vertices and cut into
+ * blocks of at most WalkArchiveBlockWalkerNum walkers. In a block, each walker
+ * stores the delta of its start vertex to the previous walker's start vertex,
+ * then the zigzag-encoded delta of each step to the previous step, all as
+ * varints. The deltas are taken in the relabeled ID space, where the
+ * neighbors of a vertex tend to have nearby IDs.
+ *
+ * Layout:
+ *   WalkArchiveHeader
+ *   blocks
+ *   WalkArchiveBlockIndex [blocks], ordered by epoch, then by start vertex
+ *   vertex_id_t [vertices] id2name, optional
+ *   WalkArchiveFooter
+ *
+ * Walkers are numbered by their order in the archive.
+ */
+#define WalkArchiveMagic 0x4b4c4157424f4d46ull // "FMOBWALK"
+#define WalkArchiveVersion 1
+#define WalkArchiveBlockWalkerNum 4096
+// Max encoded size of a vertex or a step, whose zigzag delta has one more bit than the IDs
+#define MaxVarintSize ((sizeof(vertex_id_t) * 8 + 1 + 6) / 7)
+
+struct WalkArchiveHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t vertex_id_size;
+    uint32_t walk_len;
+    uint32_t reserved;
+};
+
+struct WalkArchiveBlockIndex {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t first_walker;
+    uint64_t first_start_vertex;
+    uint64_t last_start_vertex;
+    uint32_t walker_num;
+    uint32_t epoch;
+};
+
+struct WalkArchiveFooter {
+    uint64_t index_offset;
+    uint64_t block_num;
+    // 0 if there is no id2name section
+    uint64_t id2name_offset;
+    uint64_t v_num;
+    uint64_t walker_num;
+    uint64_t epoch_num;
+    uint64_t magic;
+};
+
+inline uint64_t zigzag_encode(uint64_t delta) {
+    return (delta << 1) ^ (uint64_t)((int64_t) delta >> 63);
+}
+
+inline uint64_t zigzag_decode(uint64_t val) {
+    return (val >> 1) ^ (~(val & 1) + 1);
+}
+
+inline uint8_t* encode_varint(uint8_t* p, uint64_t val) {
+    while (val >= 0x80) {
+        *p++ = (uint8_t) (val | 0x80);
+        val >>= 7;
+    }
+    *p++ = (uint8_t) val;
+    return p;
+}
+
+inline const uint8_t* decode_varint(const uint8_t* p, uint64_t &val) {
+    uint64_t v = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        v |= (uint64_t) (*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    val = v | ((uint64_t) *p++ << shift);
+    return p;
+}
+
+/**
+ * Encode the paths of walkers order[0..walker_num) into data, where the
+ * walkers are sorted by start vertex. Return the encoded size.
+ * data must have at least walker_num * walk_len * MaxVarintSize bytes.
+ */
+size_t encode_walk_block(const vertex_id_t* paths, const walker_id_t* order, size_t walker_num, int walk_len, uint8_t* data) {
+    uint8_t* p = data;
+    uint64_t prev_start = walker_num == 0 ? 0 : paths[(uint64_t) order[0] * walk_len];
+    for (size_t w_i = 0; w_i < walker_num; w_i++) {
+        const vertex_id_t* path = paths + (uint64_t) order[w_i] * walk_len;
+        p = encode_varint(p, path[0] - prev_start);
+        prev_start = path[0];
+        for (int l_i = 1; l_i < walk_len; l_i++) {
+            p = encode_varint(p, zigzag_encode((uint64_t) path[l_i] - (uint64_t) path[l_i - 1]));
+        }
+    }
+    return p - data;
+}
+
+void decode_walk_block(const uint8_t* data, const WalkArchiveBlockIndex &block, int walk_len, vertex_id_t* paths) {
+    const uint8_t* p = data;
+    uint64_t prev_start = block.first_start_vertex;
+    for (uint32_t w_i = 0; w_i < block.walker_num; w_i++) {
+        vertex_id_t* path = paths + (uint64_t) w_i * walk_len;
+        uint64_t val;
+        p = decode_varint(p, val);
+        prev_start += val;
+        path[0] = prev_start;
+        uint64_t prev = prev_start;
+        for (int l_i = 1; l_i < walk_len; l_i++) {
+            p = decode_varint(p, val);
+            prev += zigzag_decode(val);
+            path[l_i] = prev;
+        }
+    }
+    CHECK(p == data + block.size) << "Broken walk archive block";
+}
+
+/**
+ * Random access to a walk archive, which is mapped into memory.
+ */
+class WalkArchiveReader {
+    MappedFile f;
+public:
+    WalkArchiveHeader header;
+    WalkArchiveFooter footer;
+    const WalkArchiveBlockIndex* index;
+    // nullptr if the archive does not have the id2name section
+    const vertex_id_t* id2name;
+
+    WalkArchiveReader(const char* path) : f(path) {
+        CHECK(f.size >= sizeof(WalkArchiveHeader) + sizeof(WalkArchiveFooter)) << "Broken walk archive: " << path;
+        memcpy(&header, f.data, sizeof(header));
+        memcpy(&footer, f.data + f.size - sizeof(footer), sizeof(footer));
+        CHECK(header.magic == WalkArchiveMagic && footer.magic == WalkArchiveMagic) << "Not a walk archive: " << path;
+        CHECK(header.version == WalkArchiveVersion) << "Unsupported walk archive version: " << header.version;
+        CHECK(header.vertex_id_size == sizeof(vertex_id_t)) << "The walk archive is made with " << header.vertex_id_size << "-byte vertex IDs";
+        index = reinterpret_cast<const WalkArchiveBlockIndex*>(f.data + footer.index_offset);
+        id2name = footer.id2name_offset == 0 ? nullptr : reinterpret_cast<const vertex_id_t*>(f.data + footer.id2name_offset);
+    }
+
+    int get_walk_len() {
+        return header.walk_len;
+    }
+
+    uint64_t get_walker_num() {
+        return footer.walker_num;
+    }
+
+    // Find the vertex ID of an original vertex ID of the input graph, by a scan over id2name
+    bool find_vertex(vertex_id_t name, vertex_id_t &vertex) {
+        if (id2name == nullptr) {
+            vertex = name;
+            return name < footer.v_num;
+        }
+        for (vertex_id_t v_i = 0; v_i < footer.v_num; v_i++) {
+            if (id2name[v_i] == name) {
+                vertex = v_i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void read_block(uint64_t block, vertex_id_t* paths) {
+        decode_walk_block(reinterpret_cast<const uint8_t*>(f.data + index[block].offset), index[block], header.walk_len, paths);
+    }
+
+    // The block containing the walker
+    uint64_t find_walker_block(uint64_t walker) {
+        CHECK(walker < footer.walker_num);
+        auto iter = std::upper_bound(index, index + footer.block_num, walker, [](uint64_t w, const WalkArchiveBlockIndex &b) {
+            return w < b.first_walker;
+        });
+        return iter - index - 1;
+    }
+
+    void read_walker(uint64_t walker, vertex_id_t* path) {
+        uint64_t block = find_walker_block(walker);
+        std::vector<vertex_id_t> paths((uint64_t) index[block].walker_num * header.walk_len);
+        read_block(block, paths.data());
+        uint64_t offset = (walker - index[block].first_walker) * header.walk_len;
+        std::copy(paths.begin() + offset, paths.begin() + offset + header.walk_len, path);
+    }
+
+    // The blocks that may contain walkers starting from the vertex, at most a few per epoch
+    void find_start_vertex_blocks(vertex_id_t vertex, std::vector<uint64_t> &blocks) {
+        blocks.clear();
+        uint64_t epoch_begin = 0;
+        while (epoch_begin < footer.block_num) {
+            uint64_t epoch_end = epoch_begin;
+            while (epoch_end < footer.block_num && index[epoch_end].epoch == index[epoch_begin].epoch) {
+                epoch_end++;
+            }
+            auto iter = std::lower_bound(index + epoch_begin, index + epoch_end, (uint64_t) vertex, [](const WalkArchiveBlockIndex &b, uint64_t v) {
+                return b.last_start_vertex < v;
+            });
+            for (; iter < index + epoch_end && iter->first_start_vertex <= vertex; iter++) {
+                blocks.push_back(iter - index);
+            }
+            epoch_begin = epoch_end;
+        }
+    }
+
+    // Read the paths of all the walkers starting from the vertex
+    void read_start_vertex(vertex_id_t vertex, std::vector<vertex_id_t> &paths) {
+        paths.clear();
+        std::vector<uint64_t> blocks;
+        find_start_vertex_blocks(vertex, blocks);
+        std::vector<vertex_id_t> block_paths;
+        for (auto block : blocks) {
+            block_paths.resize((uint64_t) index[block].walker_num * header.walk_len);
+            read_block(block, block_paths.data());
+            for (uint64_t offset = 0; offset < block_paths.size(); offset += header.walk_len) {
+                if (block_paths[offset] == vertex) {
+                    paths.insert(paths.end(), block_paths.begin() + offset, block_paths.begin() + offset + header.walk_len);
+                }
+            }
+        }
+    }
+
+    // Decode all the walkers with all the OpenMP threads
+    void read_all(vertex_id_t* paths) {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (uint64_t b_i = 0; b_i < footer.block_num; b_i++) {
+            read_block(b_i, paths + index[b_i].first_walker * header.walk_len);
+        }
+    }
+};
@@ -16,9 +16,16 @@ int main(int argc, char** argv)
     init_concurrency(opt.mtcfg);
 
     Graph graph(opt.mtcfg);
-    make_graph(opt.graph_path.c_str(), opt.graph_format, true, opt.get_walker_num_func(), opt.walk_len, opt.mtcfg, opt.mem_quota, false, graph);
+    graph.set_streaming(opt.streaming);
+    graph.set_clean_edges(opt.clean_edges);
+    graph.set_weighted(opt.weighted);
+    graph.set_temporal(opt.temporal);
+    make_graph(opt.graph_path.c_str(), opt.graph_format, opt.as_undirected, opt.get_walker_num_func(), opt.walk_len, opt.mtcfg, opt.mem_quota, false, graph, opt.use_snapshot);
 
     FMobSolver solver(&graph, opt.mtcfg);
-    walk(&solver, opt.get_walker_num(graph.v_num), opt.walk_len, opt.mem_quota);
+    solver.set_dead_end_mode(opt.dead_end_mode);
+    solver.set_termination_prob(opt.termination_prob);
+    WalkOutputConfig output_cfg = {opt.output_path, opt.output_format, opt.direct_io};
+    walk(&solver, opt.get_walker_num(graph.v_num), opt.walk_len, opt.mem_quota, opt.output_path.empty() ? nullptr : &output_cfg);
     return 0;
 }
@@ -6,6 +6,7 @@
 #include <limits.h>
 #include <assert.h>
 #include <vector>
+#include <string>
 #include <unordered_map>
 #include <cstddef>
 #include <memory>
@@ -22,6 +23,7 @@
 #include "random.hpp"
 #include "memory.hpp"
 #include "hash.hpp"
+#include "parallel.hpp"
 
 struct AdjUnit {
     vertex_id_t neighbor;
@@ -32,6 +34,73 @@ struct AdjList {
     AdjUnit *begin;
 } __attribute__((packed));
 
+/**
+ * The neighbors of a high-degree vertex for node2vec, as a bitmap over all the
+ * vertices if it is smaller, or otherwise as a hash set of cache-line buckets.
+ * A neighbor is put in the first bucket with an empty slot from its hash, and
+ * the buckets are at most half full, so a query mostly reads one cache line.
+ */
+#define NeighborBucketSlotNum (CacheLineSize / sizeof(vertex_id_t))
+struct NeighborSet {
+    uint64_t *bitmap;
+    vertex_id_t *buckets;
+    uint64_t bucket_mask;
+
+    static uint64_t get_bucket_num(vertex_id_t degree) {
+        uint64_t bucket_num = 1;
+        while (bucket_num * NeighborBucketSlotNum < (uint64_t) degree * 2) {
+            bucket_num *= 2;
+        }
+        return bucket_num;
+    }
+
+    void insert(vertex_id_t vertex) {
+        if (bitmap != nullptr) {
+            bitmap[vertex / 64] |= (uint64_t) 1 << (vertex % 64);
+            return;
+        }
+        for (uint64_t b_i = splitmix64_hash(vertex) & bucket_mask; ; b_i = (b_i + 1) & bucket_mask) {
+            vertex_id_t *slots = buckets + b_i * NeighborBucketSlotNum;
+            for (size_t s_i = 0; s_i < NeighborBucketSlotNum; s_i++) {
+                if (slots[s_i] == vertex) {
+                    return;
+                }
+                if (slots[s_i] == MaxVertexId) {
+                    slots[s_i] = vertex;
+                    return;
+                }
+            }
+        }
+    }
+
+    void prefetch(vertex_id_t vertex) const {
+        if (bitmap != nullptr) {
+            _mm_prefetch(&bitmap[vertex / 64], _MM_HINT_T0);
+        } else {
+            _mm_prefetch(buckets + (splitmix64_hash(vertex) & bucket_mask) * NeighborBucketSlotNum, _MM_HINT_T0);
+        }
+    }
+
+    // The slots of a bucket are compared without early exits, which is vectorized
+    bool contain(vertex_id_t vertex) const {
+        if (bitmap != nullptr) {
+            return (bitmap[vertex / 64] >> (vertex % 64)) & 1;
+        }
+        for (uint64_t b_i = splitmix64_hash(vertex) & bucket_mask; ; b_i = (b_i + 1) & bucket_mask) {
+            const vertex_id_t *slots = buckets + b_i * NeighborBucketSlotNum;
+            bool found = false;
+            bool full = true;
+            for (size_t s_i = 0; s_i < NeighborBucketSlotNum; s_i++) {
+                found |= (slots[s_i] == vertex);
+                full &= (slots[s_i] != MaxVertexId);
+            }
+            if (found || !full) {
+                return found;
+            }
+        }
+    }
+};
+
 /**
  * Brief description of a group used in Graph class.
  *
@@ -91,6 +160,9 @@ struct GraphHint {
  * Vertices are sorted by degree, except for the vertices of the first few
  * partitions, which are evenly shuffled for load-balance.
  *
+ * The dead ends, i.e. the vertices without out-edges, are sorted to the tail
+ * [dead_end_begin, v_num), which is not covered by any group or partition.
+ *
  */
 class Graph
 {
@@ -99,37 +171,95 @@ class Graph
         vertex_id_t degree;
     };
 
-    // Sort vertices by degree. Could be faster if parallel sorting is implemented.
+    /**
+     * Sort vertices by degree in descending order, with vertices of the same
+     * degree kept in their original order.
+     *
+     * Each thread counts the degrees of its own contiguous range into a private
+     * histogram, then scatters the range to the offsets derived from the
+     * histograms. To bound the histogram size, only degrees below
+     * CountingSortMaxBucket are counted, and the few vertices with higher
+     * degrees are put at the front and sorted separately. Vertices without
+     * out-edges end up at the tail.
+     */
     void counting_sort(VertexSortUnit *data, vertex_id_t num) {
         vertex_id_t high = 0;
         #pragma omp parallel for reduction (max: high)
         for (vertex_id_t v_i = 0; v_i < num; v_i++) {
             high = std::max(high, data[v_i].degree);
         }
+        const vertex_id_t bucket_num = std::min(high + 1, (vertex_id_t) CountingSortMaxBucket);
+        const int thread_num = omp_get_max_threads();
+        const vertex_id_t range = (num + thread_num - 1) / thread_num;
         VertexSortUnit *temp_data = new VertexSortUnit[num];
-        vertex_id_t *counters = new vertex_id_t[high + 1];
-        #pragma omp parallel for
-        for (vertex_id_t d_i = 0; d_i <= high; d_i++) {
-            counters[d_i] = 0;
+        // counters[t][d] is the number of vertices of degree d in the range of thread t,
+        // and later the position to put the next such vertex.
+        std::vector<std::vector<edge_id_t> > counters(thread_num);
+        std::vector<edge_id_t> high_counters(thread_num, 0);
+        #pragma omp parallel num_threads(thread_num)
+        {
+            int t = omp_get_thread_num();
+            vertex_id_t begin = std::min(num, range * t);
+            vertex_id_t end = std::min(num, begin + range);
+            counters[t].assign(bucket_num, 0);
+            for (vertex_id_t v_i = begin; v_i < end; v_i++) {
+                temp_data[v_i] = data[v_i];
+                if (data[v_i].degree < bucket_num) {
+                    counters[t][data[v_i].degree]++;
+                } else {
+                    high_counters[t]++;
+                }
+            }
         }
-        #pragma omp parallel for
-        for (vertex_id_t v_i = 0; v_i < num; v_i++) {
-            temp_data[v_i] = data[v_i];
+
+        // The high degree vertices come first, then the buckets from high degree
+        // to low degree. In each bucket, vertices are ordered by thread ranges.
+        edge_id_t high_num = 0;
+        for (int t_i = 0; t_i < thread_num; t_i++) {
+            edge_id_t count = high_counters[t_i];
+            high_counters[t_i] = high_num;
+            high_num += count;
         }
-        for (vertex_id_t v_i = 0; v_i < num; v_i++) {
-            assert(data[v_i].degree != 0);
-            counters[data[v_i].degree]++;
+        std::vector<edge_id_t> bucket_sizes(bucket_num);
+        #pragma omp parallel for
+        for (vertex_id_t d_i = 0; d_i < bucket_num; d_i++) {
+            edge_id_t sum = 0;
+            for (int t_i = 0; t_i < thread_num; t_i++) {
+                sum += counters[t_i][bucket_num - d_i - 1];
+            }
+            bucket_sizes[d_i] = sum;
         }
-        for (vertex_id_t d_i = 1; d_i <= high; d_i++) {
-            counters[d_i] += counters[d_i - 1];
+        std::vector<edge_id_t> bucket_begins(bucket_num + 1);
+        parallel_prefix_sum(bucket_sizes.data(), bucket_begins.data(), bucket_num);
+        #pragma omp parallel for
+        for (vertex_id_t d_i = 0; d_i < bucket_num; d_i++) {
+            edge_id_t pos = high_num + bucket_begins[bucket_num - d_i - 1];
+            for (int t_i = 0; t_i < thread_num; t_i++) {
+                edge_id_t count = counters[t_i][d_i];
+                counters[t_i][d_i] = pos;
+                pos += count;
+            }
         }
-        for (vertex_id_t v_i = 0; v_i < num; v_i++) {
-            vertex_id_t pos = counters[temp_data[v_i].degree - 1]++;
-            data[num - pos - 1] = temp_data[v_i];
+
+        #pragma omp parallel num_threads(thread_num)
+        {
+            int t = omp_get_thread_num();
+            vertex_id_t begin = std::min(num, range * t);
+            vertex_id_t end = std::min(num, begin + range);
+            for (vertex_id_t v_i = begin; v_i < end; v_i++) {
+                vertex_id_t degree = temp_data[v_i].degree;
+                if (degree < bucket_num) {
+                    data[counters[t][degree]++] = temp_data[v_i];
+                } else {
+                    data[high_counters[t]++] = temp_data[v_i];
+                }
+            }
         }
+        std::stable_sort(data, data + high_num, [] (const VertexSortUnit &a, const VertexSortUnit &b) {
+            return a.degree > b.degree;
+        });
 
         delete []temp_data;
-        delete []counters;
     }
 protected:
     MultiThreadConfig mtcfg;
@@ -137,12 +267,24 @@ protected:
 public:
     std::unique_ptr<AdjList*[]> adjlists; // AdjList [sockets][vertices]
     std::unique_ptr<AdjUnit*[]> edges; // AdjUnit [sockets][vertices / sockets]
+    // Only for weighted graphs, in the same layout as edges
+    std::unique_ptr<real_t*[]> edge_weights; // real_t [sockets][vertices / sockets]
+    // Only for temporal graphs, in the same layout as edges
+    std::unique_ptr<edge_time_t*[]> edge_times; // edge_time_t [sockets][vertices / sockets]
     vertex_id_t v_num;
     edge_id_t e_num;
     bool as_undirected;
+    // The number of vertices with out-edges, and the first dead end
+    vertex_id_t dead_end_begin;
 
     vertex_id_t *id2name; // vertex_id_t [vertices] (interleaved)
 
+    // Only for typed graphs, see load_vertex_types()
+    vertex_type_t *vertex_types; // vertex_type_t [vertices] (interleaved)
+    vertex_id_t type_num;
+    // Where the edges to each neighbor type begin, see prepare_type_segments()
+    vertex_id_t *type_offsets; // vertex_id_t [vertices][type_num + 1] (interleaved)
+
     vertex_id_t group_num;
     vertex_id_t group_bits;
     vertex_id_t group_mask;
@@ -158,27 +300,109 @@ public:
     std::vector<vertex_id_t> partition_max_degree;
     std::vector<vertex_id_t> partition_min_degree;
     std::vector<edge_id_t> partition_edge_num;
+    std::vector<edge_id_t> socket_edge_num;
     std::unique_ptr<int*[]> socket_partitions;
     std::unique_ptr<int[]> socket_partition_nums;
 
     // For node2vec
     std::unique_ptr<BloomFilter> bf;
+    /**
+     * The neighbor query of node2vec is decided by vertex ID, as the vertices
+     * are sorted by degree except for the shuffled ones with the highest
+     * degrees. The vertices in [0, neighbor_set_end) have NeighborSets, the
+     * ones in [neighbor_scan_begin, v_num) are scanned, and the ones in
+     * between are checked with the bloom filter, then binary searched.
+     */
+    vertex_id_t neighbor_set_end;
+    vertex_id_t neighbor_scan_begin;
+    NeighborSet *neighbor_sets;
+    size_t neighbor_index_size;
 
     // Temporary variables, which will be cleared after making graph.
     std::vector<vertex_id_t> degrees;
     std::vector<Edge> raw_edges;
+    std::vector<real_t> raw_weights;
+    std::vector<edge_time_t> raw_times;
     std::vector<vertex_id_t> name2id;
     std::vector<VertexSortUnit> vertex_units;
     std::vector<edge_id_t> degree_prefix_sum;
 
+    // The files of the graph, which could be multiple shards
+    std::vector<std::string> shard_paths;
+    GraphFormat graph_format;
+    // For streaming construction, the edges are read from the files
+    // again in make() instead of being kept in raw_edges.
+    bool streaming;
+    // Remove the self-loops and the duplicate edges while loading
+    bool clean_edges;
+    bool weighted;
+    bool temporal;
+
     Graph(MultiThreadConfig _mtcfg) : mpool (_mtcfg) {
         mtcfg = _mtcfg;
         id2name = nullptr;
+        vertex_types = nullptr;
+        type_num = 0;
+        type_offsets = nullptr;
+        neighbor_set_end = 0;
+        neighbor_scan_begin = 0;
+        neighbor_sets = nullptr;
+        neighbor_index_size = 0;
+        streaming = false;
+        clean_edges = false;
+        weighted = false;
+        temporal = false;
+        dead_end_begin = 0;
+    }
+
+    /**
+     * Build the graph with two passes over the graph file. The first pass in
+     * load() counts degrees, and the second pass in make() scatters the edges
+     * to the edge lists, so the raw edge list is never held in memory.
+     * The graph file must not be changed between load() and make().
+     */
+    void set_streaming(bool _streaming) {
+        streaming = _streaming;
+    }
+
+    /**
+     * Remove the self-loops and the duplicate edges of the input, which
+     * otherwise skew the sampling probabilities. For undirected graphs,
+     * (u, v) and (v, u) are duplicates. It needs the raw edges in memory,
+     * so it does not work with streaming construction.
+     */
+    void set_clean_edges(bool _clean_edges) {
+        clean_edges = _clean_edges;
+    }
+
+    /**
+     * Read the edge weights as well, from text lines of "src dst weight", or
+     * from binary graphs of WeightedEdge. The edges of each vertex are then
+     * sampled in proportion to their weights. It needs the raw edges in
+     * memory, so it does not work with streaming construction.
+     */
+    void set_weighted(bool _weighted) {
+        weighted = _weighted;
+    }
+
+    /**
+     * Read the edge times as well, from text lines of "src dst time" with
+     * integer times, or from binary graphs of TemporalEdge. The edges of each
+     * vertex are sorted by time, and the walks are time-respecting. It needs
+     * the raw edges in memory, so it does not work with streaming construction.
+     */
+    void set_temporal(bool _temporal) {
+        temporal = _temporal;
     }
 
     ~Graph() {
     }
 
+    bool has_dead_end() {
+        return dead_end_begin < v_num;
+    }
+
+    // The vertex must not be a dead end
     int get_vertex_partition_id(vertex_id_t vertex) {
         vertex_id_t g_id = vertex >> group_bits;
         return ((vertex & group_mask) >> groups[0][g_id].partition_bits) + groups[0][g_id].partition_offset;
@@ -188,45 +412,236 @@ public:
         return partition_begin[partition] >> group_bits;
     }
 
-    void load(const char* path, GraphFormat graph_format, bool _as_undirected = true) {
-        LOG(WARNING) << block_begin_str(1) << "Load graph";
+    // The weights of the vertex's edges, for weighted graphs only. The vertex must not be a dead end.
+    real_t* get_edge_weights(vertex_id_t vertex) {
+        int socket = partition_socket[get_vertex_partition_id(vertex)];
+        return edge_weights[socket] + (adjlists[0][vertex].begin - edges[socket]);
+    }
+
+    // The times of the vertex's edges on its socket, for temporal graphs only
+    edge_time_t* get_edge_times(vertex_id_t vertex, int socket) {
+        return edge_times[socket] + (adjlists[socket][vertex].begin - edges[socket]);
+    }
+
+    /**
+     * Give the vertex names marked in name_bitmap dense IDs from 0 to v_num - 1,
+     * in the order of names, and fill name2id.
+     */
+    void assign_vertex_ids(const ConcurrentBitmap &name_bitmap, size_t name_num) {
+        std::vector<size_t> word_ranks;
+        name_bitmap.get_word_ranks(word_ranks);
+        CHECK(word_ranks.back() < MaxVertexId) << "Too many vertices, try the 64-bit build";
+        v_num = word_ranks.back();
+        name2id.resize(name_num);
+        #pragma omp parallel for
+        for (size_t n_i = 0; n_i < name_num; n_i++) {
+            name2id[n_i] = name_bitmap.get(n_i) ? name_bitmap.rank(word_ranks, n_i) : MaxVertexId;
+        }
+    }
+
+    /**
+     * The first pass of streaming construction. Collect vertex names
+     * and count degrees from the graph file.
+     */
+    void scan_graph_file() {
+        const size_t pad = CacheLineSize / sizeof(vertex_id_t);
+        std::vector<vertex_id_t> thread_max_name(omp_get_max_threads() * pad, 0);
+        edge_id_t raw_e_num = foreach_graph_edge(shard_paths, graph_format, [&] (vertex_id_t a, vertex_id_t b) {
+            vertex_id_t &max_name = thread_max_name[omp_get_thread_num() * pad];
+            max_name = std::max(max_name, std::max(a, b));
+        });
+        vertex_id_t max_name = 0;
+        for (auto name : thread_max_name) {
+            max_name = std::max(max_name, name);
+        }
+
+        size_t name_num = raw_e_num == 0 ? 0 : (size_t) max_name + 1;
+        std::vector<vertex_id_t> name_degrees(name_num);
+        #pragma omp parallel for
+        for (size_t n_i = 0; n_i < name_num; n_i++) {
+            name_degrees[n_i] = 0;
+        }
+        ConcurrentBitmap name_bitmap;
+        name_bitmap.resize(name_num);
+        foreach_graph_edge(shard_paths, graph_format, [&] (vertex_id_t a, vertex_id_t b) {
+            __sync_fetch_and_add(&name_degrees[a], 1);
+            if (as_undirected) {
+                __sync_fetch_and_add(&name_degrees[b], 1);
+            }
+            name_bitmap.set(a);
+            name_bitmap.set(b);
+        });
+        assign_vertex_ids(name_bitmap, name_num);
+
+        vertex_units.resize(v_num);
+        #pragma omp parallel for
+        for (size_t n_i = 0; n_i < name2id.size(); n_i++) {
+            if (name2id[n_i] != MaxVertexId) {
+                vertex_units[name2id[n_i]].vertex = name2id[n_i];
+                vertex_units[name2id[n_i]].degree = name_degrees[n_i];
+            }
+        }
+        e_num = as_undirected ? raw_e_num * 2 : raw_e_num;
+    }
+
+    /**
+     * Remove the self-loops and the duplicate edges from the relabeled raw_edges.
+     * The edges are scattered to a CSR by source, then the adjacency list of
+     * each vertex is sorted and deduplicated in parallel, and compacted back
+     * to raw_edges. Undirected edges are keyed by the smaller endpoint, so
+     * both directions of an edge are merged. The weights of duplicate edges
+     * are summed up.
+     */
+    void clean_raw_edges() {
         Timer timer;
-        as_undirected = _as_undirected;
-        e_num = 0;
-        v_num = 0;
-        if (graph_format == BinaryGraphFormat) {
-            read_binary_graph(path, raw_edges);
-        } else {
-            read_text_graph(path, raw_edges);
+        auto get_key = [&] (const Edge &e) {
+            return as_undirected ? std::min(e.src, e.dst) : e.src;
+        };
+        auto get_value = [&] (const Edge &e) {
+            return as_undirected ? std::max(e.src, e.dst) : e.dst;
+        };
+        std::vector<edge_id_t> counts(v_num, 0);
+        #pragma omp parallel for
+        for (edge_id_t e_i = 0; e_i < raw_edges.size(); e_i++) {
+            if (raw_edges[e_i].src != raw_edges[e_i].dst) {
+                __sync_fetch_and_add(&counts[get_key(raw_edges[e_i])], 1);
+            }
         }
-        if (as_undirected) {
-            e_num = raw_edges.size() * 2;
-        } else {
-            e_num = raw_edges.size();
+        std::vector<edge_id_t> offsets(v_num + 1);
+        parallel_prefix_sum(counts.data(), offsets.data(), v_num);
+        std::vector<vertex_id_t> neighbors(offsets[v_num]);
+        std::vector<real_t> weights(weighted ? offsets[v_num] : 0);
+        #pragma omp parallel for
+        for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
+            counts[v_i] = offsets[v_i];
         }
+        #pragma omp parallel for
         for (edge_id_t e_i = 0; e_i < raw_edges.size(); e_i++) {
-            vertex_id_t &a = raw_edges[e_i].src;
-            vertex_id_t &b = raw_edges[e_i].dst;
-            while (a >= name2id.size()) {
-                name2id.push_back(UINT_MAX);
+            if (raw_edges[e_i].src != raw_edges[e_i].dst) {
+                edge_id_t pos = __sync_fetch_and_add(&counts[get_key(raw_edges[e_i])], 1);
+                neighbors[pos] = get_value(raw_edges[e_i]);
+                if (weighted) {
+                    weights[pos] = raw_weights[e_i];
+                }
             }
-            while (b >= name2id.size()) {
-                name2id.push_back(UINT_MAX);
+        }
+
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
+            auto begin = neighbors.begin() + offsets[v_i];
+            auto end = neighbors.begin() + offsets[v_i + 1];
+            if (!weighted) {
+                std::sort(begin, end);
+                counts[v_i] = std::unique(begin, end) - begin;
+                continue;
             }
-            if (name2id[a] == UINT_MAX) {
-                name2id[a] = v_num++;
+            std::vector<std::pair<vertex_id_t, real_t> > units(end - begin);
+            for (size_t u_i = 0; u_i < units.size(); u_i++) {
+                units[u_i] = std::make_pair(begin[u_i], weights[offsets[v_i] + u_i]);
             }
-            if (name2id[b] == UINT_MAX) {
-                name2id[b] = v_num++;
+            std::sort(units.begin(), units.end());
+            edge_id_t num = 0;
+            for (size_t u_i = 0; u_i < units.size(); u_i++) {
+                if (num != 0 && begin[num - 1] == units[u_i].first) {
+                    weights[offsets[v_i] + num - 1] += units[u_i].second;
+                } else {
+                    begin[num] = units[u_i].first;
+                    weights[offsets[v_i] + num] = units[u_i].second;
+                    num++;
+                }
             }
-            a = name2id[a];
-            b = name2id[b];
+            counts[v_i] = num;
         }
+        std::vector<edge_id_t> clean_offsets(v_num + 1);
+        parallel_prefix_sum(counts.data(), clean_offsets.data(), v_num);
+        edge_id_t raw_e_num = raw_edges.size();
+        raw_edges.resize(clean_offsets[v_num]);
+        raw_weights.resize(weighted ? clean_offsets[v_num] : 0);
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
+            for (edge_id_t e_i = 0; e_i < counts[v_i]; e_i++) {
+                raw_edges[clean_offsets[v_i] + e_i] = Edge(v_i, neighbors[offsets[v_i] + e_i]);
+                if (weighted) {
+                    raw_weights[clean_offsets[v_i] + e_i] = weights[offsets[v_i] + e_i];
+                }
+            }
+        }
+        LOG(WARNING) << block_mid_str(1) << "Remove " << raw_e_num - raw_edges.size() << " self-loops and duplicate edges in " << timer.duration() << " seconds";
+    }
 
-        LOG(WARNING) << block_mid_str(1) << "Read graph from files in " << timer.duration() << " seconds";
-        LOG(WARNING) << block_mid_str(1) << "Vertices number: " << v_num;
-        LOG(WARNING) << block_mid_str(1) << "Edges number: " << e_num;
-        LOG(WARNING) << block_mid_str(1) << "As undirected: " << (as_undirected ? "true" : "false");
+    // Read all the edges into raw_edges, and their weights into raw_weights
+    void read_weighted_edges() {
+        std::vector<WeightedEdge> weighted_edges;
+        if (graph_format == BinaryGraphFormat) {
+            read_binary_graph(shard_paths, weighted_edges);
+        } else {
+            read_text_graph(shard_paths, weighted_edges);
+        }
+        raw_edges.resize(weighted_edges.size());
+        raw_weights.resize(weighted_edges.size());
+        #pragma omp parallel for
+        for (edge_id_t e_i = 0; e_i < weighted_edges.size(); e_i++) {
+            raw_edges[e_i] = Edge(weighted_edges[e_i].src, weighted_edges[e_i].dst);
+            raw_weights[e_i] = weighted_edges[e_i].weight;
+        }
+    }
+
+    // Read all the edges into raw_edges, and their times into raw_times
+    void read_temporal_edges() {
+        std::vector<TemporalEdge> temporal_edges;
+        if (graph_format == BinaryGraphFormat) {
+            read_binary_graph(shard_paths, temporal_edges);
+        } else {
+            read_text_graph(shard_paths, temporal_edges);
+        }
+        raw_edges.resize(temporal_edges.size());
+        raw_times.resize(temporal_edges.size());
+        #pragma omp parallel for
+        for (edge_id_t e_i = 0; e_i < temporal_edges.size(); e_i++) {
+            raw_edges[e_i] = Edge(temporal_edges[e_i].src, temporal_edges[e_i].dst);
+            raw_times[e_i] = temporal_edges[e_i].time;
+        }
+    }
+
+    // Read all the edges into raw_edges and relabel the vertices
+    void read_edges() {
+        if (weighted) {
+            read_weighted_edges();
+        } else if (temporal) {
+            read_temporal_edges();
+        } else if (graph_format == BinaryGraphFormat) {
+            read_binary_graph(shard_paths, raw_edges);
+        } else {
+            read_text_graph(shard_paths, raw_edges);
+        }
+
+        vertex_id_t max_name = 0;
+        #pragma omp parallel for reduction (max: max_name)
+        for (edge_id_t e_i = 0; e_i < raw_edges.size(); e_i++) {
+            max_name = std::max(max_name, std::max(raw_edges[e_i].src, raw_edges[e_i].dst));
+        }
+        size_t name_num = raw_edges.empty() ? 0 : (size_t) max_name + 1;
+        ConcurrentBitmap name_bitmap;
+        name_bitmap.resize(name_num);
+        #pragma omp parallel for
+        for (edge_id_t e_i = 0; e_i < raw_edges.size(); e_i++) {
+            name_bitmap.set(raw_edges[e_i].src);
+            name_bitmap.set(raw_edges[e_i].dst);
+        }
+        assign_vertex_ids(name_bitmap, name_num);
+        #pragma omp parallel for
+        for (edge_id_t e_i = 0; e_i < raw_edges.size(); e_i++) {
+            raw_edges[e_i].src = name2id[raw_edges[e_i].src];
+            raw_edges[e_i].dst = name2id[raw_edges[e_i].dst];
+        }
+        if (clean_edges) {
+            clean_raw_edges();
+        }
+        if (as_undirected) {
+            e_num = raw_edges.size() * 2;
+        } else {
+            e_num = raw_edges.size();
+        }
 
         vertex_units.resize(v_num);
         #pragma omp parallel for
@@ -241,6 +656,45 @@ public:
                 __sync_fetch_and_add(&vertex_units[raw_edges[e_i].dst].degree, 1);
             }
         }
+    }
+
+    /**
+     * Load the graph from path, which could be a file, or a directory or glob
+     * pattern of shards that are read concurrently.
+     */
+    void load(const char* path, GraphFormat _graph_format, bool _as_undirected = true) {
+        LOG(WARNING) << block_begin_str(1) << "Load graph";
+        Timer timer;
+        as_undirected = _as_undirected;
+        graph_format = _graph_format;
+        get_graph_shard_paths(path, shard_paths);
+        CHECK(!(streaming && clean_edges)) << "Cleaning edges needs the raw edges in memory, which streaming construction does not keep";
+        CHECK(!(streaming && weighted)) << "Weighted graphs need the raw edges in memory, which streaming construction does not keep";
+        CHECK(!(streaming && temporal)) << "Temporal graphs need the raw edges in memory, which streaming construction does not keep";
+        CHECK(!(weighted && temporal)) << "A graph could not be both weighted and temporal";
+        CHECK(!(clean_edges && temporal)) << "Cleaning edges would merge the edges of different times";
+        e_num = 0;
+        v_num = 0;
+        if (shard_paths.size() > 1) {
+            LOG(WARNING) << block_mid_str(1) << "Graph shards: " << shard_paths.size();
+        }
+        if (streaming) {
+            scan_graph_file();
+            LOG(WARNING) << block_mid_str(1) << "Scan graph file in " << timer.duration() << " seconds";
+        } else {
+            read_edges();
+            LOG(WARNING) << block_mid_str(1) << "Read graph from files in " << timer.duration() << " seconds";
+        }
+        LOG(WARNING) << block_mid_str(1) << "Vertices number: " << v_num;
+        LOG(WARNING) << block_mid_str(1) << "Edges number: " << e_num;
+        LOG(WARNING) << block_mid_str(1) << "As undirected: " << (as_undirected ? "true" : "false");
+        if (weighted) {
+            LOG(WARNING) << block_mid_str(1) << "Weighted: true";
+        }
+        if (temporal) {
+            LOG(WARNING) << block_mid_str(1) << "Temporal: true";
+        }
+
         Timer sort_timer;
         // std::sort(vertex_units.begin(), vertex_units.end(), [](const VertexSortUnit &a, const VertexSortUnit &b) { return a.degree > b.degree;});
         counting_sort(vertex_units.data(), vertex_units.size());
@@ -253,18 +707,28 @@ public:
         }
 
         degree_prefix_sum.resize(v_num + 1, 0);
-        degree_prefix_sum[0] = 0;
+        parallel_prefix_sum(degrees.data(), degree_prefix_sum.data(), v_num);
+
+        vertex_id_t walkable_num = 0;
+        #pragma omp parallel for reduction (+: walkable_num)
         for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
-            degree_prefix_sum[v_i + 1] = degree_prefix_sum[v_i] + degrees[v_i];
+            walkable_num += (degrees[v_i] != 0);
+        }
+        dead_end_begin = walkable_num;
+        if (has_dead_end()) {
+            LOG(WARNING) << block_mid_str(1) << "Dead-end vertices: " << v_num - dead_end_begin;
         }
         LOG(WARNING) << block_end_str(1) << "Load graph in " << timer.duration() << " seconds";
     }
 
-    void make(GraphHint* graph_hint) {
-        LOG(WARNING) << block_begin_str(1) << "Make edgelists";
-        Timer timer;
+    /**
+     * Set up groups and partitions according to the hint, and distribute
+     * the partitions to sockets. Only v_num and dead_end_begin are required
+     * to be known.
+     */
+    void make_partitions(GraphHint* graph_hint) {
         group_bits = graph_hint->group_bits;
-        group_mask = (1u <<group_bits) - 1;
+        group_mask = ((vertex_id_t) 1 << group_bits) - 1;
         group_hints = graph_hint->group_hints;
         partition_sampler_class = graph_hint->partition_sampler_class;
         group_num = graph_hint->group_num;
@@ -287,7 +751,7 @@ public:
             auto &hint = group_hints[g_i];
             for (vertex_id_t v = hint.vertex_begin; v < hint.vertex_end; v += bit2value(hint.partition_bits)) {
                 partition_begin.push_back(v);
-                partition_end.push_back(std::min(v + bit2value(hint.partition_bits), v_num));
+                partition_end.push_back(std::min(v + bit2value(hint.partition_bits), dead_end_begin));
                 partition_num++;
             }
             if (g_i == 0) {
@@ -295,6 +759,130 @@ public:
                 shuffle_partition_num = std::min(mtcfg.thread_num, partition_num);
             }
         }
+
+        socket_partition_nums.reset(new int[mtcfg.socket_num]);
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            socket_partition_nums[s_i] = 0;
+        }
+        partition_socket.resize(this->partition_num);
+        for (int p_i = 0; p_i < this->partition_num; p_i++) {
+            if (p_i % (mtcfg.socket_num * 2) < mtcfg.socket_num) {
+                partition_socket[p_i] = p_i % mtcfg.socket_num;
+            } else {
+                partition_socket[p_i] = mtcfg.socket_num - p_i % mtcfg.socket_num - 1;
+            }
+            socket_partition_nums[partition_socket[p_i]]++;
+        }
+        socket_partitions.reset(new int*[mtcfg.socket_num]);
+        std::vector<vertex_id_t> temp_socket_partition_count(mtcfg.socket_num, 0);
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            socket_partitions[s_i] = mpool.alloc<int>(socket_partition_nums[s_i], s_i);
+        }
+        for (int p_i = 0; p_i < this->partition_num; p_i++) {
+            auto socket = partition_socket[p_i];
+            socket_partitions[socket][temp_socket_partition_count[socket]++] = p_i;
+        }
+    }
+
+    void alloc_id2name() {
+        id2name = mpool.alloc<vertex_id_t>(v_num, MemoryInterleaved);
+    }
+
+    void alloc_adjlists() {
+        adjlists.reset(new AdjList*[mtcfg.socket_num]);
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            adjlists[s_i] = mpool.alloc<AdjList>(v_num, s_i);
+        }
+    }
+
+    /**
+     * Allocate the edges of each socket according to the degrees in adjlists[0],
+     * and point adjlists[0] to the beginning of each vertex's edges. The edges of
+     * a socket are ordered by the partitions it owns. The weights of weighted
+     * graphs and the times of temporal graphs are allocated alongside.
+     */
+    void alloc_edges() {
+        edges.reset(new AdjUnit*[mtcfg.socket_num]);
+        if (weighted) {
+            edge_weights.reset(new real_t*[mtcfg.socket_num]);
+        }
+        if (temporal) {
+            edge_times.reset(new edge_time_t*[mtcfg.socket_num]);
+        }
+        socket_edge_num.resize(mtcfg.socket_num);
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            edge_id_t p_e_num = 0;
+            #pragma omp parallel for reduction (+: p_e_num)
+            for (int p_i = 0; p_i < socket_partition_nums[s_i]; p_i++) {
+                auto partition = socket_partitions[s_i][p_i];
+                for (vertex_id_t v_i = partition_begin[partition]; v_i < partition_end[partition]; v_i++) {
+                    p_e_num += adjlists[0][v_i].degree;
+                }
+            }
+            edges[s_i] = mpool.alloc<AdjUnit>(p_e_num, s_i);
+            if (weighted) {
+                edge_weights[s_i] = mpool.alloc<real_t>(p_e_num, s_i);
+            }
+            if (temporal) {
+                edge_times[s_i] = mpool.alloc<edge_time_t>(p_e_num, s_i);
+            }
+            socket_edge_num[s_i] = p_e_num;
+        }
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            size_t temp = 0;
+            for (int p_i = 0; p_i < socket_partition_nums[s_i]; p_i++) {
+                auto partition = socket_partitions[s_i][p_i];
+                for (vertex_id_t v_i = partition_begin[partition]; v_i < partition_end[partition]; v_i++) {
+                    adjlists[0][v_i].begin = edges[s_i] + temp;
+                    temp += adjlists[0][v_i].degree;
+                }
+            }
+        }
+        #pragma omp parallel for
+        for (vertex_id_t v_i = dead_end_begin; v_i < v_num; v_i++) {
+            adjlists[0][v_i].begin = nullptr;
+        }
+    }
+
+    // Copy adjlists[0] to the other sockets
+    void sync_adjlists() {
+        for (int s_i = 1; s_i < mtcfg.socket_num; s_i++) {
+            #pragma omp parallel for
+            for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
+                adjlists[s_i][v_i] = adjlists[0][v_i];
+            }
+        }
+    }
+
+    /**
+     * Sort the edges of each vertex by time, then by neighbor, so that the
+     * edges no earlier than a time are a suffix of the edges.
+     */
+    void sort_edges_by_time() {
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int p_i = 0; p_i < partition_num; p_i++) {
+            int socket = partition_socket[p_i];
+            std::vector<std::pair<edge_time_t, vertex_id_t> > units;
+            for (vertex_id_t v_i = partition_begin[p_i]; v_i < partition_end[p_i]; v_i++) {
+                AdjList* adj = adjlists[0] + v_i;
+                edge_time_t* times = edge_times[socket] + (adj->begin - edges[socket]);
+                units.resize(adj->degree);
+                for (vertex_id_t e_i = 0; e_i < adj->degree; e_i++) {
+                    units[e_i] = std::make_pair(times[e_i], adj->begin[e_i].neighbor);
+                }
+                std::sort(units.begin(), units.end());
+                for (vertex_id_t e_i = 0; e_i < adj->degree; e_i++) {
+                    times[e_i] = units[e_i].first;
+                    adj->begin[e_i].neighbor = units[e_i].second;
+                }
+            }
+        }
+    }
+
+    void make(GraphHint* graph_hint) {
+        LOG(WARNING) << block_begin_str(1) << "Make edgelists";
+        Timer timer;
+        make_partitions(graph_hint);
         LOG(WARNING) << block_mid_str(1) << "Partition the graph according to hint in " << timer.duration() << " seconds";
 
         std::vector<vertex_id_t> id2newid(v_num, 0);
@@ -331,29 +919,6 @@ public:
             }
         }
 
-        socket_partition_nums.reset(new int[mtcfg.socket_num]);
-        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
-            socket_partition_nums[s_i] = 0;
-        }
-        partition_socket.resize(this->partition_num);
-        for (int p_i = 0; p_i < this->partition_num; p_i++) {
-            if (p_i % (mtcfg.socket_num * 2) < mtcfg.socket_num) {
-                partition_socket[p_i] = p_i % mtcfg.socket_num;
-            } else {
-                partition_socket[p_i] = mtcfg.socket_num - p_i % mtcfg.socket_num - 1;
-            }
-            socket_partition_nums[partition_socket[p_i]]++;
-        }
-        socket_partitions.reset(new int*[mtcfg.socket_num]);
-        std::vector<vertex_id_t> temp_socket_partition_count(mtcfg.socket_num, 0);
-        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
-            socket_partitions[s_i] = mpool.alloc<int>(socket_partition_nums[s_i], s_i);
-        }
-        for (int p_i = 0; p_i < this->partition_num; p_i++) {
-            auto socket = partition_socket[p_i];
-            socket_partitions[socket][temp_socket_partition_count[socket]++] = p_i;
-        }
-
         partition_edge_num.resize(this->partition_num, 0);
         #pragma omp parallel for
         for (int p_i = 0; p_i < this->partition_num; p_i++) {
@@ -366,6 +931,10 @@ public:
             }
             partition_edge_num[p_i] = edge_nums;
         }
+        #pragma omp parallel for
+        for (vertex_id_t v_i = dead_end_begin; v_i < v_num; v_i++) {
+            id2newid[vertex_units[v_i].vertex] = v_i;
+        }
 
         partition_max_degree.resize(partition_num);
         partition_min_degree.resize(partition_num);
@@ -398,71 +967,93 @@ public:
         LOG(INFO) << "\t" << pinfo_ss.str();
         #endif
 
-        id2name = mpool.alloc<vertex_id_t>(v_num, MemoryInterleaved);
+        alloc_id2name();
         #pragma omp parallel for
         for (size_t n_i = 0; n_i < name2id.size(); n_i++) {
-            if (name2id[n_i] != UINT_MAX) {
+            if (name2id[n_i] != MaxVertexId) {
                 name2id[n_i] = id2newid[name2id[n_i]];
                 id2name[name2id[n_i]] = n_i;
             }
         }
 
-        adjlists.reset(new AdjList*[mtcfg.socket_num]);
-        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
-            adjlists[s_i] = mpool.alloc<AdjList>(v_num, s_i);
-        }
+        alloc_adjlists();
         #pragma omp parallel for
         for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
-            for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
-                adjlists[s_i][v_i].degree = vertex_units[v_i].degree;
-            }
+            adjlists[0][v_i].degree = vertex_units[v_i].degree;
         }
+        alloc_edges();
 
-        edges.reset(new AdjUnit*[mtcfg.socket_num]);
-        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
-            edge_id_t p_e_num = 0;
-            #pragma omp parallel for reduction (+: p_e_num)
-            for (int p_i = 0; p_i < socket_partition_nums[s_i]; p_i++) {
-                auto partition = socket_partitions[s_i][p_i];
-                for (vertex_id_t v_i = partition_begin[partition]; v_i < partition_end[partition]; v_i++) {
-                    p_e_num += adjlists[s_i][v_i].degree;
-                }
-            }
-            edges[s_i] = mpool.alloc<AdjUnit>(p_e_num, s_i);
-        }
         std::vector<AdjUnit*> edge_end(v_num);
-        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
-            size_t temp = 0;
-            for (int p_i = 0; p_i < socket_partition_nums[s_i]; p_i++) {
-                auto partition = socket_partitions[s_i][p_i];
-                for (vertex_id_t v_i = partition_begin[partition]; v_i < partition_end[partition]; v_i++) {
-                    adjlists[0][v_i].begin = edges[s_i] + temp;
-                    edge_end[v_i] = edges[s_i] + temp;
-                    temp += adjlists[s_i][v_i].degree;
-                }
-            }
-        }
-
         #pragma omp parallel for
-        for (size_t e_i = 0; e_i < raw_edges.size(); e_i++) {
-            vertex_id_t u = raw_edges[e_i].src;
-            vertex_id_t v = raw_edges[e_i].dst;
+        for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
+            edge_end[v_i] = adjlists[0][v_i].begin;
+        }
+        auto add_edge = [&] (vertex_id_t u, vertex_id_t v) {
             auto *temp = __sync_fetch_and_add(&edge_end[u], sizeof(AdjUnit));
             temp->neighbor = v;
             if (as_undirected) {
                 auto *temp = __sync_fetch_and_add(&edge_end[v], sizeof(AdjUnit));
                 temp->neighbor = u;
             }
-        }
-        for (int s_i = 1; s_i < mtcfg.socket_num; s_i++) {
+        };
+        auto set_weight = [&] (vertex_id_t u, AdjUnit *unit, real_t weight) {
+            int socket = partition_socket[get_vertex_partition_id(u)];
+            edge_weights[socket][unit - edges[socket]] = weight;
+        };
+        // Both directions of an undirected edge have the same weight
+        auto add_weighted_edge = [&] (vertex_id_t u, vertex_id_t v, real_t weight) {
+            auto *temp = __sync_fetch_and_add(&edge_end[u], sizeof(AdjUnit));
+            temp->neighbor = v;
+            set_weight(u, temp, weight);
+            if (as_undirected) {
+                auto *temp = __sync_fetch_and_add(&edge_end[v], sizeof(AdjUnit));
+                temp->neighbor = u;
+                set_weight(v, temp, weight);
+            }
+        };
+        auto set_time = [&] (vertex_id_t u, AdjUnit *unit, edge_time_t time) {
+            int socket = partition_socket[get_vertex_partition_id(u)];
+            edge_times[socket][unit - edges[socket]] = time;
+        };
+        // Both directions of an undirected edge have the same time
+        auto add_temporal_edge = [&] (vertex_id_t u, vertex_id_t v, edge_time_t time) {
+            auto *temp = __sync_fetch_and_add(&edge_end[u], sizeof(AdjUnit));
+            temp->neighbor = v;
+            set_time(u, temp, time);
+            if (as_undirected) {
+                auto *temp = __sync_fetch_and_add(&edge_end[v], sizeof(AdjUnit));
+                temp->neighbor = u;
+                set_time(v, temp, time);
+            }
+        };
+        if (weighted) {
             #pragma omp parallel for
-            for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
-                adjlists[s_i][v_i] = adjlists[0][v_i];
+            for (size_t e_i = 0; e_i < raw_edges.size(); e_i++) {
+                add_weighted_edge(raw_edges[e_i].src, raw_edges[e_i].dst, raw_weights[e_i]);
+            }
+        } else if (temporal) {
+            #pragma omp parallel for
+            for (size_t e_i = 0; e_i < raw_edges.size(); e_i++) {
+                add_temporal_edge(raw_edges[e_i].src, raw_edges[e_i].dst, raw_times[e_i]);
+            }
+            sort_edges_by_time();
+        } else if (streaming) {
+            // The second pass of streaming construction
+            foreach_graph_edge(shard_paths, graph_format, [&] (vertex_id_t a, vertex_id_t b) {
+                add_edge(name2id[a], name2id[b]);
+            });
+        } else {
+            #pragma omp parallel for
+            for (size_t e_i = 0; e_i < raw_edges.size(); e_i++) {
+                add_edge(raw_edges[e_i].src, raw_edges[e_i].dst);
             }
         }
+        sync_adjlists();
 
         std::vector<vertex_id_t>().swap(degrees);
         std::vector<Edge>().swap(raw_edges);
+        std::vector<real_t>().swap(raw_weights);
+        std::vector<edge_time_t>().swap(raw_times);
         std::vector<vertex_id_t>().swap(name2id);
         std::vector<VertexSortUnit>().swap(vertex_units);
         std::vector<edge_id_t>().swap(degree_prefix_sum);
@@ -472,46 +1063,281 @@ public:
         //LOG(WARNING) << "\tMax alignment: " << alignof(std::max_align_t);
 #endif
         LOG(WARNING) << block_mid_str(1) << "Total graph size: " << size_string(get_memory_size());
+        if (mtcfg.hugepage_mode != HugePageOff) {
+            LOG(WARNING) << block_mid_str(1) << "Memory backed by huge pages: " << size_string(get_huge_page_mem());
+        }
         LOG(WARNING) << block_end_str(1) << "Make edgelists in " << timer.duration() << " seconds";
     }
 
-    // Create bloom filter for node2vec
+    /**
+     * The number of keys in the bloom filter. The keys are unordered vertex
+     * pairs, so both directions of an undirected edge share one key.
+     */
+    edge_id_t get_neighbor_query_item_num() {
+        return as_undirected ? e_num / 2 : e_num;
+    }
+
+    /**
+     * Build the NeighborSets of the vertices in [0, neighbor_set_end) on the
+     * sockets of their edges. The sets of each socket are allocated together.
+     */
+    void build_neighbor_sets() {
+        neighbor_set_end = 0;
+        neighbor_scan_begin = 0;
+        #pragma omp parallel for reduction (max: neighbor_set_end, neighbor_scan_begin)
+        for (vertex_id_t v_i = 0; v_i < dead_end_begin; v_i++) {
+            vertex_id_t degree = adjlists[0][v_i].degree;
+            if (degree >= NeighborIndexMinDegree) {
+                neighbor_set_end = std::max(neighbor_set_end, v_i + 1);
+            }
+            if (degree > NeighborScanMaxDegree) {
+                neighbor_scan_begin = std::max(neighbor_scan_begin, v_i + 1);
+            }
+        }
+        neighbor_index_size = 0;
+        if (neighbor_set_end == 0) {
+            return;
+        }
+        const uint64_t bitmap_word_num = ((uint64_t) v_num + 63) / 64;
+        neighbor_sets = mpool.alloc<NeighborSet>(neighbor_set_end, MemoryInterleaved);
+        // The offsets of the bitmap words and the bucket slots of each set on its socket
+        std::vector<uint64_t> set_offsets(neighbor_set_end);
+        std::vector<bool> use_bitmap(neighbor_set_end);
+        std::vector<uint64_t> socket_word_num(mtcfg.socket_num, 0);
+        std::vector<uint64_t> socket_slot_num(mtcfg.socket_num, 0);
+        for (vertex_id_t v_i = 0; v_i < neighbor_set_end; v_i++) {
+            int socket = partition_socket[get_vertex_partition_id(v_i)];
+            uint64_t bucket_num = NeighborSet::get_bucket_num(adjlists[0][v_i].degree);
+            NeighborSet &set = neighbor_sets[v_i];
+            set.bitmap = nullptr;
+            set.buckets = nullptr;
+            set.bucket_mask = bucket_num - 1;
+            use_bitmap[v_i] = bitmap_word_num * sizeof(uint64_t) <= bucket_num * CacheLineSize;
+            if (use_bitmap[v_i]) {
+                set_offsets[v_i] = socket_word_num[socket];
+                socket_word_num[socket] += bitmap_word_num;
+            } else {
+                set_offsets[v_i] = socket_slot_num[socket];
+                socket_slot_num[socket] += bucket_num * NeighborBucketSlotNum;
+            }
+        }
+        std::vector<uint64_t*> socket_bitmaps(mtcfg.socket_num, nullptr);
+        std::vector<vertex_id_t*> socket_buckets(mtcfg.socket_num, nullptr);
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            if (socket_word_num[s_i] != 0) {
+                socket_bitmaps[s_i] = mpool.alloc<uint64_t>(socket_word_num[s_i], s_i);
+            }
+            if (socket_slot_num[s_i] != 0) {
+                socket_buckets[s_i] = mpool.alloc<vertex_id_t>(socket_slot_num[s_i], s_i);
+            }
+            neighbor_index_size += sizeof(uint64_t) * socket_word_num[s_i] + sizeof(vertex_id_t) * socket_slot_num[s_i];
+        }
+        neighbor_index_size += sizeof(NeighborSet) * neighbor_set_end;
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (vertex_id_t v_i = 0; v_i < neighbor_set_end; v_i++) {
+            int socket = partition_socket[get_vertex_partition_id(v_i)];
+            NeighborSet &set = neighbor_sets[v_i];
+            if (use_bitmap[v_i]) {
+                set.bitmap = socket_bitmaps[socket] + set_offsets[v_i];
+                std::fill(set.bitmap, set.bitmap + bitmap_word_num, 0);
+            } else {
+                set.buckets = socket_buckets[socket] + set_offsets[v_i];
+                std::fill(set.buckets, set.buckets + (set.bucket_mask + 1) * NeighborBucketSlotNum, MaxVertexId);
+            }
+            AdjList* adj = adjlists[0] + v_i;
+            for (vertex_id_t e_i = 0; e_i < adj->degree; e_i++) {
+                set.insert(adj->begin[e_i].neighbor);
+            }
+        }
+    }
+
+    size_t get_neighbor_index_size() {
+        return neighbor_index_size;
+    }
+
+    // Create bloom filter and the neighbor sets for node2vec
     void prepare_neighbor_query() {
         Timer timer;
         #pragma omp parallel for schedule(dynamic, 1)
         for (int p_i = 0; p_i < partition_num; p_i++) {
+            std::vector<std::pair<vertex_id_t, real_t> > units;
             for (vertex_id_t v_i = partition_begin[p_i]; v_i < partition_end[p_i]; v_i++) {
                 AdjList* adj= adjlists[0] + v_i;
-                std::sort(adj->begin, adj->begin + adj->degree, [](const AdjUnit& a, const AdjUnit& b){return a.neighbor < b.neighbor;});
+                if (!weighted) {
+                    std::sort(adj->begin, adj->begin + adj->degree, [](const AdjUnit& a, const AdjUnit& b){return a.neighbor < b.neighbor;});
+                    continue;
+                }
+                // The weights are sorted along with the neighbors
+                real_t* weights = get_edge_weights(v_i);
+                units.resize(adj->degree);
+                for (vertex_id_t e_i = 0; e_i < adj->degree; e_i++) {
+                    units[e_i] = std::make_pair(adj->begin[e_i].neighbor, weights[e_i]);
+                }
+                std::sort(units.begin(), units.end());
+                for (vertex_id_t e_i = 0; e_i < adj->degree; e_i++) {
+                    adj->begin[e_i].neighbor = units[e_i].first;
+                    weights[e_i] = units[e_i].second;
+                }
             }
         }
         bf.reset(new BloomFilter(mtcfg));
-        bf->create(as_undirected ? e_num / 2 : e_num);
+        bf->create(get_neighbor_query_item_num());
         #pragma omp parallel for schedule(dynamic, 1)
         for (int p_i = 0; p_i < partition_num; p_i++) {
             for (vertex_id_t v_i = partition_begin[p_i]; v_i < partition_end[p_i]; v_i++) {
                 AdjList* adj = adjlists[0] + v_i;
                 for (auto *edge = adj->begin; edge < adj->begin + adj->degree; edge++) {
-                    bf->insert(v_i, edge->neighbor);
+                    // The reverse edge of an undirected graph has the same key
+                    if (!as_undirected || v_i <= edge->neighbor) {
+                        bf->insert(v_i, edge->neighbor);
+                    }
                 }
             }
         }
+        build_neighbor_sets();
+        LOG(WARNING) << block_mid_str() << "Neighbor sets: " << neighbor_set_end << " vertices, " << size_string(neighbor_index_size) << ", scanned from vertex " << neighbor_scan_begin;
         LOG(WARNING) << block_mid_str() << "Prepare neighborhood query in " << timer.duration() << " seconds";
     }
 
+    /**
+     * Read the vertex types from text lines of "vertex type", where the vertices
+     * are given by their names in the graph file, and the types are integers
+     * from 0. Every vertex must have a type. It works on made graphs, including
+     * the ones loaded from snapshots.
+     */
+    void load_vertex_types(const char* path) {
+        Timer timer;
+        vertex_id_t max_name = 0;
+        #pragma omp parallel for reduction (max: max_name)
+        for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
+            max_name = std::max(max_name, id2name[v_i]);
+        }
+        std::vector<vertex_type_t> name_types((size_t) max_name + 1, MaxVertexType);
+        {
+            MappedFile f(path);
+            std::vector<TextChunk> chunks;
+            split_text_chunks(f.data, f.data + f.size, (size_t) omp_get_max_threads() * 8, chunks);
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (size_t c_i = 0; c_i < chunks.size(); c_i++) {
+                foreach_text_edge(chunks[c_i].begin, chunks[c_i].end, [&] (vertex_id_t name, vertex_id_t type) {
+                    CHECK(type < MaxVertexType) << "Vertex types must be less than " << (int) MaxVertexType;
+                    if (name <= max_name) {
+                        name_types[name] = type;
+                    }
+                });
+            }
+        }
+        vertex_types = mpool.alloc<vertex_type_t>(v_num, MemoryInterleaved);
+        vertex_id_t temp_type_num = 0;
+        #pragma omp parallel for reduction (max: temp_type_num)
+        for (vertex_id_t v_i = 0; v_i < v_num; v_i++) {
+            vertex_type_t type = name_types[id2name[v_i]];
+            CHECK(type != MaxVertexType) << "No type is given to vertex " << id2name[v_i];
+            vertex_types[v_i] = type;
+            temp_type_num = std::max(temp_type_num, (vertex_id_t) type + 1);
+        }
+        type_num = temp_type_num;
+        LOG(WARNING) << block_mid_str() << "Vertex types: " << type_num;
+        LOG(WARNING) << block_mid_str() << "Load vertex types in " << timer.duration() << " seconds";
+    }
+
+    /**
+     * Sort the edges of each vertex by neighbor type, then by neighbor, and
+     * record where the edges to each type begin, so that the neighbors of a
+     * type are sampled without scanning the edges. The weights and the times
+     * are not moved along, so it does not work with weighted or temporal graphs.
+     */
+    void prepare_type_segments() {
+        CHECK(vertex_types != nullptr) << "The vertex types are not loaded";
+        CHECK(!weighted && !temporal) << "Type segments do not support weighted or temporal graphs";
+        if (type_offsets != nullptr) {
+            return;
+        }
+        Timer timer;
+        const size_t stride = type_num + 1;
+        type_offsets = mpool.alloc<vertex_id_t>((size_t) v_num * stride, MemoryInterleaved);
+        const vertex_type_t* types = vertex_types;
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int p_i = 0; p_i < partition_num; p_i++) {
+            for (vertex_id_t v_i = partition_begin[p_i]; v_i < partition_end[p_i]; v_i++) {
+                AdjList* adj = adjlists[0] + v_i;
+                std::sort(adj->begin, adj->begin + adj->degree, [&](const AdjUnit& a, const AdjUnit& b) {
+                    return types[a.neighbor] < types[b.neighbor] || (types[a.neighbor] == types[b.neighbor] && a.neighbor < b.neighbor);
+                });
+                vertex_id_t* offsets = type_offsets + v_i * stride;
+                vertex_id_t e_i = 0;
+                for (vertex_id_t t_i = 0; t_i <= type_num; t_i++) {
+                    while (e_i < adj->degree && types[adj->begin[e_i].neighbor] < t_i) {
+                        e_i++;
+                    }
+                    offsets[t_i] = e_i;
+                }
+            }
+        }
+        #pragma omp parallel for
+        for (vertex_id_t v_i = dead_end_begin; v_i < v_num; v_i++) {
+            std::fill(type_offsets + v_i * stride, type_offsets + (v_i + 1) * stride, 0);
+        }
+        LOG(WARNING) << block_mid_str() << "Prepare type segments in " << timer.duration() << " seconds";
+    }
+
+    // The edges of the vertex to the neighbors of the type, after prepare_type_segments()
+    AdjList get_type_adjlist(vertex_id_t vertex, vertex_type_t type, int socket) {
+        const vertex_id_t* offsets = type_offsets + (size_t) vertex * (type_num + 1);
+        AdjList adj;
+        adj.begin = adjlists[socket][vertex].begin + offsets[type];
+        adj.degree = offsets[type + 1] - offsets[type];
+        return adj;
+    }
+
+    size_t get_vertex_type_size() {
+        return (sizeof(vertex_type_t) + sizeof(vertex_id_t) * (type_num + 1)) * (size_t) v_num;
+    }
+
+    // Prefetch what has_neighbor(src, ...) reads before knowing dst
+    void prefetch_neighbor_index(vertex_id_t src, int socket) {
+        if (src < neighbor_set_end) {
+            _mm_prefetch(neighbor_sets + src, _MM_HINT_T0);
+        } else {
+            _mm_prefetch(adjlists[socket] + src, _MM_HINT_T0);
+        }
+    }
+
+    // Prefetch what has_neighbor(src, dst) reads next, after prefetch_neighbor_index(src)
+    void prefetch_neighbor(vertex_id_t src, vertex_id_t dst, int socket) {
+        if (src < neighbor_set_end) {
+            neighbor_sets[src].prefetch(dst);
+        } else if (src >= neighbor_scan_begin) {
+            _mm_prefetch(adjlists[socket][src].begin, _MM_HINT_T0);
+        } else {
+            bf->prefetch(src, dst);
+        }
+    }
+
     // Neighborhood query for node2vec
     bool has_neighbor(vertex_id_t src, vertex_id_t dst, int socket) {
+        if (src < neighbor_set_end) {
+            return neighbor_sets[src].contain(dst);
+        }
+        AdjList* adj = adjlists[socket] + src;
+        if (src >= neighbor_scan_begin) {
+            // At most NeighborScanMaxDegree neighbors, compared without early exits
+            bool found = false;
+            for (vertex_id_t e_i = 0; e_i < adj->degree; e_i++) {
+                found |= (adj->begin[e_i].neighbor == dst);
+            }
+            return found;
+        }
         if (bf->exist(src, dst) == false) {
             return false;
         }
-        AdjList* adj = adjlists[socket] + src;
         AdjUnit unit;
         unit.neighbor = dst;
         return std::binary_search(adj->begin, adj->begin + adj->degree, unit, [](const AdjUnit &a, const AdjUnit &b) { return a.neighbor < b.neighbor; });
     }
 
     size_t get_memory_size() {
-        return sizeof(AdjList) * v_num * (size_t) mtcfg.socket_num + sizeof(AdjUnit) * e_num;
+        return sizeof(AdjList) * v_num * (size_t) mtcfg.socket_num + (sizeof(AdjUnit) + (weighted ? sizeof(real_t) : 0) + (temporal ? sizeof(edge_time_t) : 0)) * e_num;
     }
 
     size_t get_csr_size() {
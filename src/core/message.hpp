@@ -12,15 +12,21 @@
  * MessageTask does shuffling and updating for a sub-array of walkers.
  * The message[i][j] will first be shuffled to partition[message[i][j]],
  * and then be written back to message[i+1][j].
+ * If the graph has dead ends, the messages at dead ends are shuffled to
+ * an extra bucket after the partitions, i.e. bucket partition_num.
  */
 struct MessageTask {
     Graph* graph;
     int socket;
     vertex_id_t partition_num;
+    // partition_num, plus 1 if the graph has dead ends
+    vertex_id_t bucket_num;
     walker_id_t origin_message_begin;
     walker_id_t origin_message_end;
-    walker_id_t *shuffled_message_begin; // vertex_id_t[partition_num]
-    walker_id_t *shuffled_message_end; // vertex_id_t[partition_num]
+    // The messages of the walkers still walking are [origin_message_begin, active_message_end)
+    walker_id_t active_message_end;
+    walker_id_t *shuffled_message_begin; // vertex_id_t[bucket_num]
+    walker_id_t *shuffled_message_end; // vertex_id_t[bucket_num]
     vertex_id_t *shuffled_messages; // vertex_id_t[origin_message_(end - begin) + alignement * parition_num]
     walker_state_t *shuffled_states; // vertex_id_t[origin_message_(end - begin) + alignement * parition_num]
     partition_id_t *partition_ids; // partition_id_t[origin_message_begin .. origin_message_end]
@@ -31,8 +37,10 @@ struct MessageTask {
     MessageTask() {
         graph = nullptr;
         partition_num = 0;
+        bucket_num = 0;
         origin_message_begin = 0;
         origin_message_end = 0;
+        active_message_end = 0;
         shuffled_message_begin = nullptr;
         shuffled_message_end = nullptr;
         shuffled_messages = nullptr;
@@ -44,33 +52,50 @@ struct MessageTask {
      * prepare: Counting for each partition how many messages will be
      * sent to by this MessageTask instance. Then use this information
      * to calculate the begining position of the messages in each partition.
+     * The dead-end check is compiled in only for graphs with dead ends.
      */
-    void prepare (vertex_id_t *origin_messages)
+    template<bool with_dead_end>
+    void prepare_messages(vertex_id_t *origin_messages)
     {
-        for (vertex_id_t p_i = 0; p_i < partition_num; p_i++) {
+        for (vertex_id_t p_i = 0; p_i < bucket_num; p_i++) {
             shuffled_message_end[p_i] = 0;
         }
         const vertex_id_t group_bits = graph->group_bits;
         const vertex_id_t group_mask = graph->group_mask;
+        const vertex_id_t dead_end_begin = graph->dead_end_begin;
         GroupHeader *gh = graph->groups[socket];
-        for (walker_id_t m_i = origin_message_begin; m_i < origin_message_end; m_i++) {
+        for (walker_id_t m_i = origin_message_begin; m_i < active_message_end; m_i++) {
             vertex_id_t msg = origin_messages[m_i];
-            vertex_id_t group_id = msg >> group_bits;
-            partition_id_t p_i = ((msg & group_mask) >> gh[group_id].partition_bits) + gh[group_id].partition_offset;
-            assert(p_i < partition_num);
+            partition_id_t p_i;
+            if (with_dead_end && msg >= dead_end_begin) {
+                p_i = partition_num;
+            } else {
+                vertex_id_t group_id = msg >> group_bits;
+                p_i = ((msg & group_mask) >> gh[group_id].partition_bits) + gh[group_id].partition_offset;
+            }
+            assert(p_i < bucket_num);
             partition_ids[m_i] = p_i;
             shuffled_message_end[p_i] ++;
         }
         walker_id_t counter = 0;
-        for (vertex_id_t p_i = 0; p_i < partition_num; p_i++) {
+        for (vertex_id_t p_i = 0; p_i < bucket_num; p_i++) {
             shuffled_message_begin[p_i] = counter;
             counter += shuffled_message_end[p_i];
         }
-        for (vertex_id_t p_i = 0; p_i < partition_num; p_i++) {
+        for (vertex_id_t p_i = 0; p_i < bucket_num; p_i++) {
             shuffled_message_end[p_i] = shuffled_message_begin[p_i];
         }
     }
 
+    void prepare (vertex_id_t *origin_messages)
+    {
+        if (bucket_num > partition_num) {
+            prepare_messages<true>(origin_messages);
+        } else {
+            prepare_messages<false>(origin_messages);
+        }
+    }
+
     /**
      * shuffle: Send messages and its associated states if any, to their
      * destination partitions.
@@ -78,13 +103,13 @@ struct MessageTask {
     void shuffle(vertex_id_t *origin_messages, walker_state_t *origin_states)
     {
         if (origin_states == nullptr) {
-            for (walker_id_t m_i = origin_message_begin; m_i < origin_message_end; m_i++) {
+            for (walker_id_t m_i = origin_message_begin; m_i < active_message_end; m_i++) {
                 partition_id_t p_i = partition_ids[m_i];
                 vertex_id_t shuffled_i = shuffled_message_end[p_i] ++;
                 shuffled_messages[shuffled_i] = origin_messages[m_i];
             }
         } else {
-            for (walker_id_t m_i = origin_message_begin; m_i < origin_message_end; m_i++) {
+            for (walker_id_t m_i = origin_message_begin; m_i < active_message_end; m_i++) {
                 partition_id_t p_i = partition_ids[m_i];
                 vertex_id_t shuffled_i = shuffled_message_end[p_i] ++;
                 shuffled_messages[shuffled_i] = origin_messages[m_i];
@@ -94,14 +119,24 @@ struct MessageTask {
     }
 
     /**
-     * update: Write the updated messages back to the walkers.
+     * update: Write the updated messages back to the walkers, and the
+     * updated states as well if target_states is given.
      */
-    void update (vertex_id_t *target_messages)
+    void update (vertex_id_t *target_messages, walker_state_t *target_states)
     {
-        for (walker_id_t m_i = origin_message_begin; m_i < origin_message_end; m_i++) {
-            partition_id_t p_i = partition_ids[m_i];
-            walker_id_t shuffled_i = shuffled_message_begin[p_i]++;
-            target_messages[m_i] = shuffled_messages[shuffled_i];
+        if (target_states == nullptr) {
+            for (walker_id_t m_i = origin_message_begin; m_i < active_message_end; m_i++) {
+                partition_id_t p_i = partition_ids[m_i];
+                walker_id_t shuffled_i = shuffled_message_begin[p_i]++;
+                target_messages[m_i] = shuffled_messages[shuffled_i];
+            }
+        } else {
+            for (walker_id_t m_i = origin_message_begin; m_i < active_message_end; m_i++) {
+                partition_id_t p_i = partition_ids[m_i];
+                walker_id_t shuffled_i = shuffled_message_begin[p_i]++;
+                target_messages[m_i] = shuffled_messages[shuffled_i];
+                target_states[m_i] = shuffled_states[shuffled_i];
+            }
         }
     }
 };
@@ -115,7 +150,7 @@ class MessageManager
     MultiThreadConfig mtcfg;
 
     MemoryPool mpool;
-    bool is_node2vec;
+    bool with_states;
     partition_id_t *partition_ids;
 
     // shared members, not owned.
@@ -125,6 +160,7 @@ class MessageManager
 
 public:
     std::vector<MessageTask**> mtasks;
+    walker_id_t active_message_num;
     int num_lv1_task;
     vertex_id_t lv0_partition_bits;
 
@@ -137,6 +173,7 @@ public:
 
     MessageManager(MultiThreadConfig _mtcfg) : mpool(_mtcfg) {
         mtcfg = _mtcfg;
+        active_message_num = 0;
         num_lv1_task = 0;
         lv0_partition_bits = 0;
         partition_ids = nullptr;
@@ -146,14 +183,20 @@ public:
         profiler = nullptr;
     }
 
-    void init(Graph* _graph, WalkerManager *_wkrm, SampleProfiler *_profiler, bool _is_node2vec) {
+    /**
+     * The walkers carry states if with_states is set. The extra bucket is
+     * there for the dead ends, and for the walkers stopped at WalkEndVertex
+     * if with_end_bucket is set.
+     */
+    void init(Graph* _graph, WalkerManager *_wkrm, SampleProfiler *_profiler, bool _with_states, bool with_end_bucket = false) {
         Timer timer;
         graph = _graph;
         wkrm = _wkrm;
         profiler = _profiler;
-        is_node2vec = _is_node2vec;
+        with_states = _with_states;
 
         mtasks.resize(mtcfg.socket_num, nullptr);
+        const vertex_id_t bucket_num = graph->partition_num + ((graph->has_dead_end() || with_end_bucket) ? 1 : 0);
         partition_ids = wkrm->alloc_walker_array<partition_id_t>();
         for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
             int socket_threads = mtcfg.socket_thread_num();
@@ -164,13 +207,13 @@ public:
             mc.al_alloc<MessageTask*>(socket_threads);
             for (int t_i = 0; t_i < socket_threads; t_i++) {
                 mc.al_alloc<MessageTask>();
-                mc.al_alloc<walker_id_t>(graph->partition_num);
-                mc.al_alloc<walker_id_t>(graph->partition_num);
+                mc.al_alloc<walker_id_t>(bucket_num);
+                mc.al_alloc<walker_id_t>(bucket_num);
                 auto origin_message_begin = wkrm->thread_walker_begin[s_i][t_i];
                 auto origin_message_end = wkrm->thread_walker_end[s_i][t_i];
                 mc.al_alloc<vertex_id_t>(origin_message_end - origin_message_begin);
-                if (is_node2vec) {
-                    mc.al_alloc<vertex_id_t>(origin_message_end - origin_message_begin);
+                if (with_states) {
+                    mc.al_alloc<walker_state_t>(origin_message_end - origin_message_begin);
                 }
                 mc.align();
             }
@@ -183,13 +226,15 @@ public:
                 mt = m->al_alloc_new<MessageTask>();
                 mt->graph = graph;
                 mt->partition_num = graph->partition_num;
+                mt->bucket_num = bucket_num;
                 mt->socket = s_i;
                 mt->origin_message_begin = wkrm->thread_walker_begin[s_i][t_i];
                 mt->origin_message_end = wkrm->thread_walker_end[s_i][t_i];
-                mt->shuffled_message_begin = m->al_alloc<walker_id_t>(graph->partition_num);
-                mt->shuffled_message_end = m->al_alloc<walker_id_t>(graph->partition_num);
+                mt->active_message_end = mt->origin_message_end;
+                mt->shuffled_message_begin = m->al_alloc<walker_id_t>(bucket_num);
+                mt->shuffled_message_end = m->al_alloc<walker_id_t>(bucket_num);
                 mt->shuffled_messages = m->al_alloc<vertex_id_t>(mt->origin_message_end - mt->origin_message_begin);
-                mt->shuffled_states = is_node2vec ? m->al_alloc<vertex_id_t>(mt->origin_message_end - mt->origin_message_begin) : nullptr;
+                mt->shuffled_states = with_states ? m->al_alloc<walker_state_t>(mt->origin_message_end - mt->origin_message_begin) : nullptr;
                 mt->partition_ids = partition_ids;
                 m->align();
             }
@@ -197,21 +242,62 @@ public:
         LOG(WARNING) << block_mid_str() << "Initialize MessageManager in " << timer.duration() << " seconds";
     }
 
-    void shuffle(vertex_id_t *messages, walker_state_t *states, walker_id_t active_message_num) {
-        Timer timer;
-
-        CHECK(mtasks[mtcfg.socket_num - 1][mtcfg.socket_thread_num() - 1]->origin_message_end >= active_message_num) << mtasks[mtcfg.socket_num - 1][mtcfg.socket_thread_num() - 1]->origin_message_end << " " << active_message_num;
+    // Activate the messages of the first walker_num walkers
+    void set_active_messages(walker_id_t walker_num) {
+        CHECK(mtasks[mtcfg.socket_num - 1][mtcfg.socket_thread_num() - 1]->origin_message_end >= walker_num) << mtasks[mtcfg.socket_num - 1][mtcfg.socket_thread_num() - 1]->origin_message_end << " " << walker_num;
         for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
-            for (int t_i = mtcfg.socket_thread_num() - 1; t_i >= 0; t_i--) {
+            for (int t_i = 0; t_i < mtcfg.socket_thread_num(); t_i++) {
                 auto mt = mtasks[s_i][t_i];
-                if (mt->origin_message_end > active_message_num) {
-                    mt->origin_message_end = active_message_num;
-                    mt->origin_message_begin = std::min(mt->origin_message_begin, active_message_num);
-                } else {
-                    break;
+                mt->active_message_end = std::max(mt->origin_message_begin, std::min(mt->origin_message_end, walker_num));
+            }
+        }
+        active_message_num = walker_num;
+    }
+
+    /**
+     * compact: Drop the walkers that finish their walks from the active
+     * messages. Each thread scans the active messages of its own task, and
+     * calls func(m_i, live_i), which returns false if the walker at m_i
+     * finishes, or otherwise moves its messages and the other walker arrays
+     * from m_i to live_i. The live walkers are thus packed to the front of the
+     * task, on the same socket. Return the number of live walkers.
+     */
+    template<typename F>
+    walker_id_t compact(F func) {
+        Timer timer;
+        walker_id_t live_num = 0;
+        double thread_time = 0;
+        #pragma omp parallel reduction(+: live_num, thread_time)
+        {
+            Timer thread_timer;
+            int thread_id = omp_get_thread_num();
+            auto mt = mtasks[mtcfg.socket_id(thread_id)][mtcfg.socket_offset(thread_id)];
+            walker_id_t live_end = mt->origin_message_begin;
+            for (walker_id_t m_i = mt->origin_message_begin; m_i < mt->active_message_end; m_i++) {
+                if (func(m_i, live_end)) {
+                    live_end++;
                 }
             }
+            mt->active_message_end = live_end;
+            live_num += live_end - mt->origin_message_begin;
+            thread_time += thread_timer.duration();
         }
+        active_message_num = live_num;
+        #if PROFILE_IF_BRIEF
+        profiler->sub_step_sync_times["1-CMP"] += timer.duration();
+        profiler->sub_step_thread_times["1-CMP"] += thread_time / mtcfg.thread_num;
+        #endif
+        return live_num;
+    }
+
+    void shuffle(vertex_id_t *messages, walker_state_t *states, walker_id_t walker_num) {
+        set_active_messages(walker_num);
+        shuffle(messages, states);
+    }
+
+    // Shuffle the active messages
+    void shuffle(vertex_id_t *messages, walker_state_t *states) {
+        Timer timer;
 
         // #if PROFILE_IF_NORMAL
         double shuffle_lv0_phase0_time = 0;
@@ -243,7 +329,7 @@ public:
         #endif
     }
 
-    void update(vertex_id_t* target_messages, walker_id_t walker_num) {
+    void update(vertex_id_t* target_messages, walker_id_t walker_num, walker_state_t* target_states = nullptr) {
         _unused(walker_num);
         Timer timer;
         double thread_time = 0;
@@ -253,7 +339,7 @@ public:
             Timer thread_timer;
             int thread_id = omp_get_thread_num();
             int socket = mtcfg.socket_id(thread_id);
-            mtasks[socket][mtcfg.socket_offset(thread_id)]->update(target_messages);
+            mtasks[socket][mtcfg.socket_offset(thread_id)]->update(target_messages, target_states);
             thread_time += thread_timer.duration();
         }
         #if PROFILE_IF_BRIEF
@@ -59,16 +59,34 @@ private:
     std::set<MiniBMKItem> cat_set;
     int new_item_num;
 public:
-    MiniBMKCatManager (double walker_per_edge, MultiThreadConfig mtcfg) {
+    static std::string get_cfg_name(double walker_per_edge, bool weighted, MultiThreadConfig mtcfg) {
+        // log(walker_per_edge, 1.5) with precision of 0
+        double wpe_log = log(walker_per_edge) / log(1.5);
+        std::stringstream cfg_name_ss;
+        cfg_name_ss << std::fixed << std::setprecision(0) << wpe_log << "_" << mtcfg.socket_num << "_" << mtcfg.thread_num;
+        // The 64-bit build has larger edges, thus different costs
+        if (sizeof(vertex_id_t) != sizeof(uint32_t)) {
+            cfg_name_ss << "_id64";
+        }
+        // Weighted graphs benchmark other samplers, which must not be mixed up
+        // with the unweighted ones
+        if (weighted) {
+            cfg_name_ss << "_weighted";
+        }
+        cfg_name_ss << ".txt";
+        return cfg_name_ss.str();
+    }
+
+    static std::string get_cfg_file(double walker_per_edge, bool weighted, MultiThreadConfig mtcfg) {
+        return std::string(FMobDir) + "/" + get_cfg_name(walker_per_edge, weighted, mtcfg);
+    }
+
+    MiniBMKCatManager (double walker_per_edge, bool weighted, MultiThreadConfig mtcfg) {
         cfg_dir = FMobDir;
         std::string cmd = std::string("mkdir -p ") + cfg_dir;
         CHECK(0 == system(cmd.c_str()));
 
-        // log(walker_per_edge, 1.5) with precision of 0
-        double wpe_log = log(walker_per_edge) / log(1.5);
-        std::stringstream cfg_name_ss;
-        cfg_name_ss << std::fixed << std::setprecision(0) << wpe_log << "_" << mtcfg.socket_num << "_" << mtcfg.thread_num << ".txt";
-        cfg_name = cfg_name_ss.str();
+        cfg_name = get_cfg_name(walker_per_edge, weighted, mtcfg);
         cfg_file = cfg_dir + "/" + cfg_name;
 
         LOG(WARNING) << block_mid_str(1) << "Mini-benchmark file: " << cfg_file;
@@ -76,8 +94,10 @@ public:
         FILE* f = fopen(cfg_file.c_str(), "r");
         if (f != NULL) {
             MiniBMKItem item;
-            uint32_t sampler_class;
-            while (4 == fscanf(f, "%u %u %u %lf", &item.partition_bits, &item.degree, &sampler_class, &item.step_time)) {
+            uint32_t partition_bits, degree, sampler_class;
+            while (4 == fscanf(f, "%u %u %u %lf", &partition_bits, &degree, &sampler_class, &item.step_time)) {
+                item.partition_bits = partition_bits;
+                item.degree = degree;
                 item.sampler_class = static_cast<SamplerClass>(sampler_class);
                 cat_set.insert(item);
             }
@@ -110,7 +130,7 @@ public:
         if (new_item_num != 0) {
             FILE* f = fopen(cfg_file.c_str(), "w");
             for (auto &item : cat_set) {
-                fprintf(f, "%u %u %u %lf\n", item.partition_bits, item.degree, item.sampler_class, item.step_time);
+                fprintf(f, "%u %u %u %lf\n", (uint32_t) item.partition_bits, (uint32_t) item.degree, item.sampler_class, item.step_time);
             }
             fclose(f);
         }
@@ -132,11 +152,36 @@ void walk_message_mock(sampler_t *sampler, vertex_id_t *message_begin, vertex_id
     }
 }
 
+/**
+ * Return the step time of the sampler on a partition of partition_vertex_num
+ * vertices, averaged over iter_num rounds that start with cold caches.
+ */
+template<typename sampler_t>
+double mini_benchmark_sampler(sampler_t *sampler, uint64_t iter_num, vertex_id_t partition_vertex_num, AdjList *adjlists, vertex_id_t *walkers, uint64_t partition_walker_num, default_rand_t *rd) {
+    uint64_t work = 0;
+    double work_time = 0;
+    Timer timer;
+    for (uint64_t iter_i = 0; iter_i < iter_num; iter_i++) {
+        sampler->reset(0, partition_vertex_num, adjlists);
+        timer.restart();
+        walk_message_mock(sampler, walkers, walkers + partition_walker_num, partition_vertex_num - 1, rd);
+        work_time += timer.duration();
+        work += partition_walker_num;
+    }
+    return get_step_cost(work_time, work, 1);
+}
+
+/**
+ * Benchmark the direct samplers and the buffered samplers on partitions of
+ * various sizes and degrees. For weighted graphs, AliasSampler and
+ * WeightedBufferSampler are benchmarked instead.
+ */
 void mini_benchmark(
     double walker_per_edge,
     vertex_id_t max_degree,
     vertex_id_t min_partition_vertex_bit,
     vertex_id_t max_partition_vertex_bit,
+    bool weighted,
     MultiThreadConfig mtcfg,
     std::map<vertex_id_t, std::map<vertex_id_t, std::vector<SampleEstimation> > > &results
 ) {
@@ -146,8 +191,8 @@ void mini_benchmark(
         SamplerClass sclass;
     };
     Timer benchmark_timer;
-    MiniBMKCatManager cat_manager(walker_per_edge, mtcfg);
-    const vertex_id_t internal_max_pt_bit = std::min(max_partition_vertex_bit, std::max(20u, min_partition_vertex_bit));
+    MiniBMKCatManager cat_manager(walker_per_edge, weighted, mtcfg);
+    const vertex_id_t internal_max_pt_bit = std::min(max_partition_vertex_bit, std::max((vertex_id_t) 20, min_partition_vertex_bit));
     const edge_id_t thread_edge_num = 1ull << 24;
     const vertex_id_t max_thread_vertex_num = 1 << internal_max_pt_bit;
     const uint64_t max_thread_walker_num = thread_edge_num * walker_per_edge;
@@ -159,6 +204,8 @@ void mini_benchmark(
         d_i = std::max(d_i + 1, (vertex_id_t) (d_i * 1.05));
     }
 
+    const SamplerClass direct_class = weighted ? ClassAliasSampler : ClassUniformDegreeDirectSampler;
+    const SamplerClass buffer_class = weighted ? ClassWeightedBufferSampler : ClassExclusiveBufferSampler;
     std::map<vertex_id_t, std::vector<BmkTask> > bmk_tasks;
     for (auto degree : test_degrees) {
         for (vertex_id_t partition_bits = min_partition_vertex_bit; partition_bits <= internal_max_pt_bit; partition_bits++) {
@@ -173,12 +220,12 @@ void mini_benchmark(
             }
             BmkTask task;
             task.ptn_bits = partition_bits;
-            if (!cat_manager.has_item(MiniBMKCatManager::MiniBMKItem(partition_bits, degree, ClassUniformDegreeDirectSampler))) {
-                task.sclass = ClassUniformDegreeDirectSampler;
+            if (!cat_manager.has_item(MiniBMKCatManager::MiniBMKItem(partition_bits, degree, direct_class))) {
+                task.sclass = direct_class;
                 bmk_tasks[degree].push_back(task);
             }
-            if (degree > 4 && !cat_manager.has_item(MiniBMKCatManager::MiniBMKItem(partition_bits, degree, ClassExclusiveBufferSampler))) {
-                task.sclass = ClassExclusiveBufferSampler;
+            if (degree > 4 && !cat_manager.has_item(MiniBMKCatManager::MiniBMKItem(partition_bits, degree, buffer_class))) {
+                task.sclass = buffer_class;
                 bmk_tasks[degree].push_back(task);
             }
         }
@@ -203,6 +250,12 @@ void mini_benchmark(
             adjunits[t_i] = mpool.alloc_new<AdjUnit>(thread_edge_num, mtcfg.socket_id(t_i));
         }
 
+        // In the same layout as adjunits
+        real_t *weights[mtcfg.thread_num];
+        for (int t_i = 0; t_i < mtcfg.thread_num; t_i++) {
+            weights[t_i] = weighted ? mpool.alloc_new<real_t>(thread_edge_num, mtcfg.socket_id(t_i)) : nullptr;
+        }
+
         vertex_id_t *walkers[mtcfg.thread_num];
         for (int t_i = 0; t_i < mtcfg.thread_num; t_i++) {
             walkers[t_i] = mpool.alloc_new<vertex_id_t>(max_thread_walker_num, mtcfg.socket_id(t_i));
@@ -215,6 +268,11 @@ void mini_benchmark(
             for (edge_id_t e_i = 0; e_i < thread_edge_num; e_i++) {
                 adjunits[thread][e_i].neighbor = rd->gen(max_value);
             }
+            if (weighted) {
+                for (edge_id_t e_i = 0; e_i < thread_edge_num; e_i++) {
+                    weights[thread][e_i] = rd->gen_float(1.0);
+                }
+            }
             for (walker_id_t w_i = 0; w_i < max_thread_walker_num; w_i++) {
                 walkers[thread][w_i] = rd->gen(max_value);
             }
@@ -247,45 +305,30 @@ void mini_benchmark(
                 for (auto &task : bmk_tasks[degree]) {
                     vertex_id_t partition_vertex_num = 1 << task.ptn_bits;
                     uint64_t partition_walker_num = (uint64_t) partition_vertex_num * degree * walker_per_edge;
+                    uint64_t direct_iter_num = std::max(4ul, (1ul << 20) / partition_walker_num);
+                    double time = 0;
                     if (task.sclass == ClassUniformDegreeDirectSampler) {
                         UniformDegreeDirectSampler sampler;
                         sampler.init(0, partition_vertex_num, adjlists[thread]);
-
-                        Timer timer;
-                        uint64_t work = 0;
-                        double work_time = 0;
-                        uint32_t iter_num = std::max(4ul, (1ul << 20) / partition_walker_num);
-                        for (vertex_id_t iter_i = 0; iter_i < iter_num; iter_i++) {
-                            sampler.reset(0, partition_vertex_num, adjlists[thread]);
-                            timer.restart();
-                            walk_message_mock(&sampler, walkers[thread], walkers[thread] + partition_walker_num, partition_vertex_num - 1, rd);
-                            work_time += timer.duration();
-                            work += partition_walker_num;
-                        }
-                        double time = get_step_cost(work_time, work, 1);
-                        cat_manager_lock.lock();
-                        cat_manager.add_item(MiniBMKCatManager::MiniBMKItem(task.ptn_bits, degree, ClassUniformDegreeDirectSampler, time));
-                        cat_manager_lock.unlock();
+                        time = mini_benchmark_sampler(&sampler, direct_iter_num, partition_vertex_num, adjlists[thread], walkers[thread], partition_walker_num, rd);
                     } else if (task.sclass == ClassExclusiveBufferSampler) {
                         ExclusiveBufferSampler sampler;
                         sampler.init(0, partition_vertex_num, adjlists[thread], &local_mpool, socket);
-
-                        uint64_t work = 0;
-                        double work_time = 0;
-                        Timer timer;
-                        vertex_id_t iter_num = std::max(4ul, std::max(1ul << 20, 4ul *  sampler.buffer_unit_num) / partition_walker_num);
-                        for (vertex_id_t iter_i = 0; iter_i < iter_num; iter_i++) {
-                            sampler.reset(0, partition_vertex_num, adjlists[thread]);
-                            timer.restart();
-                            walk_message_mock(&sampler, walkers[thread], walkers[thread] + partition_walker_num, partition_vertex_num - 1, rd);
-                            work_time += timer.duration();
-                            work += partition_walker_num;
-                        }
-                        double time = get_step_cost(work_time, work, 1);
-                        cat_manager_lock.lock();
-                        cat_manager.add_item(MiniBMKCatManager::MiniBMKItem(task.ptn_bits, degree, ClassExclusiveBufferSampler, time));
-                        cat_manager_lock.unlock();
+                        uint64_t iter_num = std::max(4ul, std::max(1ul << 20, 4ul *  sampler.buffer_unit_num) / partition_walker_num);
+                        time = mini_benchmark_sampler(&sampler, iter_num, partition_vertex_num, adjlists[thread], walkers[thread], partition_walker_num, rd);
+                    } else if (task.sclass == ClassAliasSampler) {
+                        AliasSampler sampler;
+                        sampler.init(0, partition_vertex_num, adjlists[thread], weights[thread], &local_mpool, socket);
+                        time = mini_benchmark_sampler(&sampler, direct_iter_num, partition_vertex_num, adjlists[thread], walkers[thread], partition_walker_num, rd);
+                    } else if (task.sclass == ClassWeightedBufferSampler) {
+                        WeightedBufferSampler sampler;
+                        sampler.init(0, partition_vertex_num, adjlists[thread], weights[thread], &local_mpool, socket);
+                        uint64_t iter_num = std::max(4ul, std::max(1ul << 20, 4ul *  sampler.buffer_unit_num) / partition_walker_num);
+                        time = mini_benchmark_sampler(&sampler, iter_num, partition_vertex_num, adjlists[thread], walkers[thread], partition_walker_num, rd);
                     }
+                    cat_manager_lock.lock();
+                    cat_manager.add_item(MiniBMKCatManager::MiniBMKItem(task.ptn_bits, degree, task.sclass, time));
+                    cat_manager_lock.unlock();
                 }
             }
             __sync_fetch_and_add(&finished_thread_num, 1);
@@ -0,0 +1,601 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <limits>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <numa.h>
+
+#include "type.hpp"
+#include "constants.hpp"
+#include "log.hpp"
+#include "io.hpp"
+#include "timer.hpp"
+#include "archive.hpp"
+
+/**
+ * The output stage of random walks. Each epoch's paths are handed to
+ * WalkWriter, which writes them in background threads while the next
+ * epoch is walking.
+ */
+
+struct WalkOutputConfig {
+    std::string path;
+    WalkOutputFormat format;
+    bool direct_io;
+};
+
+// Size of the staging buffer of each shard, which must be a multiple of PageSize
+#define WalkWriterStageSize (16ul << 20)
+// Max text size of a vertex ID and a delimiter
+#define MaxVertexTextSize (std::numeric_limits<vertex_id_t>::digits10 + 2)
+
+/**
+ * A reusable barrier for a fixed number of std::threads.
+ */
+class WorkerBarrier {
+    std::mutex mtx;
+    std::condition_variable cv;
+    int thread_num;
+    int count;
+    uint64_t generation;
+public:
+    WorkerBarrier(int _thread_num) {
+        thread_num = _thread_num;
+        count = 0;
+        generation = 0;
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        uint64_t gen = generation;
+        if (++count == thread_num) {
+            count = 0;
+            generation++;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [&] { return gen != generation; });
+        }
+    }
+};
+
+/**
+ * An append-only output file. With direct I/O, the data goes through a
+ * page-aligned staging buffer, since O_DIRECT requires aligned buffers,
+ * sizes and offsets. The padding of the last page is truncated on close.
+ */
+class WalkShardFile {
+    int fd;
+    bool direct_io;
+    char* stage;
+    size_t stage_size;
+    size_t file_size;
+
+    void write_all(const char* data, size_t size) {
+        while (size != 0) {
+            ssize_t ret = write(fd, data, size);
+            CHECK(ret > 0) << "Fail to write walks: " << strerror(errno);
+            data += ret;
+            size -= ret;
+        }
+    }
+
+    void flush_stage(bool final) {
+        size_t size = final ? (stage_size + PageSize - 1) / PageSize * PageSize : stage_size / PageSize * PageSize;
+        if (size > stage_size) {
+            memset(stage + stage_size, 0, size - stage_size);
+        }
+        write_all(stage, size);
+        if (size < stage_size) {
+            memmove(stage, stage + size, stage_size - size);
+        }
+        stage_size = stage_size > size ? stage_size - size : 0;
+    }
+
+public:
+    WalkShardFile(const char* path, bool _direct_io) {
+        direct_io = _direct_io;
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+        if (direct_io) {
+            flags |= O_DIRECT;
+        }
+        fd = open(path, flags, 0644);
+        if (fd < 0 && direct_io) {
+            LOG(WARNING) << block_mid_str() << "O_DIRECT is not supported for " << path << ", fall back to buffered I/O";
+            direct_io = false;
+            fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        CHECK(fd >= 0) << "Cannot create " << path;
+        stage = nullptr;
+        stage_size = 0;
+        file_size = 0;
+        if (direct_io) {
+            CHECK(0 == posix_memalign((void**) &stage, PageSize, WalkWriterStageSize));
+        }
+    }
+
+    ~WalkShardFile() {
+        if (direct_io) {
+            flush_stage(true);
+            CHECK(0 == ftruncate(fd, file_size));
+            free(stage);
+        }
+        close(fd);
+    }
+
+    void append(const char* data, size_t size) {
+        file_size += size;
+        if (!direct_io) {
+            write_all(data, size);
+            return;
+        }
+        while (size != 0) {
+            size_t len = std::min(size, WalkWriterStageSize - stage_size);
+            memcpy(stage + stage_size, data, len);
+            stage_size += len;
+            data += len;
+            size -= len;
+            if (stage_size == WalkWriterStageSize) {
+                flush_stage(false);
+            }
+        }
+    }
+};
+
+/**
+ * WalkWriter owns two output buffers. The solver walks into one buffer
+ * while the other one is being written by the writer threads.
+ *
+ * - Binary format: the paths are written as vertex_id_t [walkers][walk_len].
+ * - Text format: each path is written as a line of space-separated vertices.
+ * - Corpus format: like the text format, but with the original vertex names
+ *   from id2name, ready for word2vec-like trainers.
+ * - Archive format: the compressed and indexed walk archive (see archive.hpp).
+ *
+ * For the binary and text formats, each socket has a writer thread, bound to
+ * the socket, writing the walkers of that socket to its own shard
+ * <path>.<socket>. In each shard, epochs are written one after another.
+ *
+ * For the corpus format, there is one writer thread per walk thread, and all
+ * of them write to the single file <path>. Each thread takes a contiguous range
+ * of walkers and counts its text size first. Once the sizes of all the threads
+ * are known, each thread formats its range and writes to its own region.
+ *
+ * For the archive format, there is also one writer thread per walk thread.
+ * The threads sort the walkers of an epoch by start vertex together with a
+ * bucket sort, encode the blocks round-robin, and write them after the leader
+ * thread assigns the file offsets. The index is written at the end.
+ */
+class WalkWriter {
+    struct WriteJob {
+        int buffer;
+        walker_id_t walker_num;
+    };
+
+    MultiThreadConfig mtcfg;
+    WalkOutputConfig cfg;
+    int walk_len;
+    std::vector<walker_id_t> socket_walker_begin;
+    std::vector<walker_id_t> socket_walker_end;
+    const vertex_id_t* id2name;
+    vertex_id_t v_num;
+    // Names used in text output, which is id2name for the corpus format
+    const vertex_id_t* text_names;
+    int worker_num;
+
+    // For the corpus format and the archive format, which write a single file
+    int out_fd;
+    size_t out_size;
+    // The text size of each worker for each buffer
+    std::vector<size_t> worker_text_size[2];
+    // The number of workers which have got their text size of the buffer
+    int buffer_sized[2];
+    size_t buffer_offset[2];
+
+    vertex_id_t* buffers[2];
+    int curr_buffer;
+    // The number of shards which have not finished writing the buffer
+    int buffer_pending[2];
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::deque<WriteJob> > jobs;
+    std::vector<std::thread> threads;
+    bool stop;
+    double wait_time;
+
+    vertex_id_t get_name(vertex_id_t vertex) {
+        return text_names == nullptr ? vertex : text_names[vertex];
+    }
+
+    /**
+     * Format the paths of walker_num walkers into text, and pass each
+     * filled piece of the text to output(data, size). A path ends at the
+     * first WalkEndVertex.
+     */
+    template<typename F>
+    void format_text(const vertex_id_t* data, walker_id_t walker_num, std::vector<char> &text, F output) {
+        const size_t max_path_size = (size_t) walk_len * MaxVertexTextSize;
+        size_t pos = 0;
+        for (walker_id_t w_i = 0; w_i < walker_num; w_i++) {
+            if (pos + max_path_size > text.size()) {
+                output(text.data(), pos);
+                pos = 0;
+            }
+            char* p = text.data() + pos;
+            const vertex_id_t* path = data + (uint64_t) w_i * walk_len;
+            for (int l_i = 0; l_i < walk_len && path[l_i] != WalkEndVertex; l_i++) {
+                p = format_text_uint(p, get_name(path[l_i]));
+                *p++ = ' ';
+            }
+            *(p - 1) = '\n';
+            pos = p - text.data();
+        }
+        output(text.data(), pos);
+    }
+
+    size_t get_text_size(const vertex_id_t* data, walker_id_t walker_num) {
+        size_t size = 0;
+        for (uint64_t s_i = 0; s_i < (uint64_t) walker_num * walk_len; s_i++) {
+            if (data[s_i] != WalkEndVertex) {
+                size += text_uint_size(get_name(data[s_i])) + 1;
+            }
+        }
+        return size;
+    }
+
+    // Wait for a job of the worker, return false if there won't be any
+    bool get_job(int worker, WriteJob &job) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return stop || !jobs[worker].empty(); });
+        if (jobs[worker].empty()) {
+            return false;
+        }
+        job = jobs[worker].front();
+        jobs[worker].pop_front();
+        return true;
+    }
+
+    void complete_job(const WriteJob &job) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            buffer_pending[job.buffer]--;
+        }
+        cv.notify_all();
+    }
+
+    void corpus_loop(int worker) {
+        if (mtcfg.with_numa()) {
+            numa_run_on_node(mtcfg.get_socket_mapping(mtcfg.socket_id(worker)));
+        }
+        std::vector<char> text(std::max(WalkWriterStageSize, (size_t) walk_len * MaxVertexTextSize));
+        WriteJob job;
+        while (get_job(worker, job)) {
+            walker_id_t range = (job.walker_num + worker_num - 1) / worker_num;
+            walker_id_t begin = std::min((uint64_t) job.walker_num, (uint64_t) range * worker);
+            walker_id_t end = std::min(job.walker_num, begin + range);
+            const vertex_id_t* data = buffers[job.buffer] + (uint64_t) begin * walk_len;
+            size_t text_size = get_text_size(data, end - begin);
+
+            size_t offset = 0;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                auto &text_sizes = worker_text_size[job.buffer];
+                text_sizes[worker] = text_size;
+                if (++buffer_sized[job.buffer] == worker_num) {
+                    // The last sized worker places the whole epoch
+                    buffer_offset[job.buffer] = out_size;
+                    for (auto size : text_sizes) {
+                        out_size += size;
+                    }
+                    cv.notify_all();
+                } else {
+                    cv.wait(lock, [&] { return buffer_sized[job.buffer] == worker_num; });
+                }
+                offset = buffer_offset[job.buffer];
+                for (int w_i = 0; w_i < worker; w_i++) {
+                    offset += text_sizes[w_i];
+                }
+            }
+            format_text(data, end - begin, text, [&] (const char* piece, size_t size) {
+                pwrite_all(out_fd, piece, size, offset);
+                offset += size;
+            });
+            complete_job(job);
+        }
+    }
+
+    // For the archive format
+    std::unique_ptr<WorkerBarrier> barrier;
+    std::vector<std::vector<walker_id_t> > archive_bucket_counts;
+    std::vector<walker_id_t> archive_order;
+    std::vector<std::vector<uint8_t> > archive_blocks;
+    std::vector<WalkArchiveBlockIndex> archive_index;
+    uint64_t archive_walker_num;
+    uint32_t archive_epoch_num;
+
+    void archive_loop(int worker) {
+        if (mtcfg.with_numa()) {
+            numa_run_on_node(mtcfg.get_socket_mapping(mtcfg.socket_id(worker)));
+        }
+        // Walkers are bucketed by start vertex ranges, and the buckets are sorted by the workers in turn.
+        const uint64_t bucket_num = (uint64_t) worker_num * 16;
+        auto get_bucket = [&] (vertex_id_t vertex) {
+            return (uint64_t) vertex * bucket_num / std::max(v_num, (vertex_id_t) 1);
+        };
+        auto &bucket_counts = archive_bucket_counts[worker];
+        // Blocks are encoded here, and only their exact sizes are kept until they are written
+        std::vector<uint8_t> block_buffer((uint64_t) WalkArchiveBlockWalkerNum * walk_len * MaxVarintSize);
+        WriteJob job;
+        while (get_job(worker, job)) {
+            const walker_id_t walker_num = job.walker_num;
+            const vertex_id_t* paths = buffers[job.buffer];
+            walker_id_t range = (walker_num + worker_num - 1) / worker_num;
+            walker_id_t begin = std::min((uint64_t) walker_num, (uint64_t) range * worker);
+            walker_id_t end = std::min(walker_num, begin + range);
+            auto get_start = [&] (walker_id_t walker) {
+                return paths[(uint64_t) walker * walk_len];
+            };
+
+            std::fill(bucket_counts.begin(), bucket_counts.end(), 0);
+            for (walker_id_t w_i = begin; w_i < end; w_i++) {
+                bucket_counts[get_bucket(get_start(w_i))]++;
+            }
+            if (worker == 0) {
+                archive_order.resize(walker_num);
+            }
+            barrier->wait();
+            if (worker == 0) {
+                walker_id_t offset = 0;
+                for (uint64_t b_i = 0; b_i < bucket_num; b_i++) {
+                    for (int w_i = 0; w_i < worker_num; w_i++) {
+                        walker_id_t count = archive_bucket_counts[w_i][b_i];
+                        archive_bucket_counts[w_i][b_i] = offset;
+                        offset += count;
+                    }
+                }
+            }
+            barrier->wait();
+            for (walker_id_t w_i = begin; w_i < end; w_i++) {
+                archive_order[bucket_counts[get_bucket(get_start(w_i))]++] = w_i;
+            }
+            barrier->wait();
+            // After scattering, the counters of the last worker are the ends of the buckets
+            for (uint64_t b_i = worker; b_i < bucket_num; b_i += worker_num) {
+                walker_id_t bucket_begin = b_i == 0 ? 0 : archive_bucket_counts[worker_num - 1][b_i - 1];
+                walker_id_t bucket_end = archive_bucket_counts[worker_num - 1][b_i];
+                std::sort(archive_order.begin() + bucket_begin, archive_order.begin() + bucket_end, [&] (walker_id_t a, walker_id_t b) {
+                    return get_start(a) < get_start(b) || (get_start(a) == get_start(b) && a < b);
+                });
+            }
+            if (worker == 0) {
+                archive_blocks.resize((walker_num + WalkArchiveBlockWalkerNum - 1) / WalkArchiveBlockWalkerNum);
+            }
+            barrier->wait();
+            for (uint64_t b_i = worker; b_i < archive_blocks.size(); b_i += worker_num) {
+                walker_id_t block_begin = b_i * WalkArchiveBlockWalkerNum;
+                walker_id_t block_walker_num = std::min((walker_id_t) WalkArchiveBlockWalkerNum, walker_num - block_begin);
+                size_t block_size = encode_walk_block(paths, archive_order.data() + block_begin, block_walker_num, walk_len, block_buffer.data());
+                archive_blocks[b_i].assign(block_buffer.begin(), block_buffer.begin() + block_size);
+            }
+            barrier->wait();
+            if (worker == 0) {
+                for (uint64_t b_i = 0; b_i < archive_blocks.size(); b_i++) {
+                    walker_id_t block_begin = b_i * WalkArchiveBlockWalkerNum;
+                    walker_id_t block_walker_num = std::min((walker_id_t) WalkArchiveBlockWalkerNum, walker_num - block_begin);
+                    WalkArchiveBlockIndex block;
+                    block.offset = out_size;
+                    block.size = archive_blocks[b_i].size();
+                    block.first_walker = archive_walker_num + block_begin;
+                    block.first_start_vertex = get_start(archive_order[block_begin]);
+                    block.last_start_vertex = get_start(archive_order[block_begin + block_walker_num - 1]);
+                    block.walker_num = block_walker_num;
+                    block.epoch = archive_epoch_num;
+                    archive_index.push_back(block);
+                    out_size += block.size;
+                }
+                archive_walker_num += walker_num;
+                archive_epoch_num++;
+            }
+            barrier->wait();
+            uint64_t first_block = archive_index.size() - archive_blocks.size();
+            for (uint64_t b_i = worker; b_i < archive_blocks.size(); b_i += worker_num) {
+                pwrite_all(out_fd, (const char*) archive_blocks[b_i].data(), archive_blocks[b_i].size(), archive_index[first_block + b_i].offset);
+                std::vector<uint8_t>().swap(archive_blocks[b_i]);
+            }
+            barrier->wait();
+            complete_job(job);
+        }
+    }
+
+    // Write the index, id2name and the footer of the archive
+    void finish_archive() {
+        WalkArchiveFooter footer;
+        memset(&footer, 0, sizeof(footer));
+        footer.index_offset = out_size;
+        footer.block_num = archive_index.size();
+        pwrite_all(out_fd, (const char*) archive_index.data(), sizeof(WalkArchiveBlockIndex) * archive_index.size(), out_size);
+        out_size += sizeof(WalkArchiveBlockIndex) * archive_index.size();
+        if (id2name != nullptr) {
+            footer.id2name_offset = out_size;
+            pwrite_all(out_fd, (const char*) id2name, sizeof(vertex_id_t) * v_num, out_size);
+            out_size += sizeof(vertex_id_t) * v_num;
+        }
+        footer.v_num = v_num;
+        footer.walker_num = archive_walker_num;
+        footer.epoch_num = archive_epoch_num;
+        footer.magic = WalkArchiveMagic;
+        pwrite_all(out_fd, (const char*) &footer, sizeof(footer), out_size);
+        out_size += sizeof(footer);
+        LOG(WARNING) << block_mid_str() << "Walk archive size: " << out_size << " bytes" \
+            << ", " << (double) out_size * 8 / std::max(archive_walker_num * walk_len, (uint64_t) 1) << " bits/step";
+    }
+
+    void shard_loop(int socket) {
+        if (mtcfg.with_numa()) {
+            numa_run_on_node(mtcfg.get_socket_mapping(socket));
+        }
+        std::string shard_path = cfg.path + "." + std::to_string(socket);
+        WalkShardFile f(shard_path.c_str(), cfg.direct_io);
+        std::vector<char> text;
+        if (cfg.format == TextWalkOutputFormat) {
+            text.resize(std::max(WalkWriterStageSize, (size_t) walk_len * MaxVertexTextSize));
+        }
+        WriteJob job;
+        while (get_job(socket, job)) {
+            walker_id_t begin = std::min(socket_walker_begin[socket], job.walker_num);
+            walker_id_t end = std::min(socket_walker_end[socket], job.walker_num);
+            const vertex_id_t* data = buffers[job.buffer] + (uint64_t) begin * walk_len;
+            if (cfg.format == BinaryWalkOutputFormat) {
+                f.append((const char*) data, sizeof(vertex_id_t) * (uint64_t) (end - begin) * walk_len);
+            } else {
+                format_text(data, end - begin, text, [&] (const char* piece, size_t size) {
+                    f.append(piece, size);
+                });
+            }
+            complete_job(job);
+        }
+    }
+
+public:
+    WalkWriter(
+        MultiThreadConfig _mtcfg,
+        WalkOutputConfig _cfg,
+        int _walk_len,
+        std::vector<walker_id_t> _socket_walker_begin,
+        std::vector<walker_id_t> _socket_walker_end,
+        vertex_id_t* buffer_0,
+        vertex_id_t* buffer_1,
+        const vertex_id_t* _id2name = nullptr,
+        vertex_id_t _v_num = 0
+    ) {
+        mtcfg = _mtcfg;
+        cfg = _cfg;
+        walk_len = _walk_len;
+        socket_walker_begin = _socket_walker_begin;
+        socket_walker_end = _socket_walker_end;
+        buffers[0] = buffer_0;
+        buffers[1] = buffer_1;
+        curr_buffer = 0;
+        buffer_pending[0] = buffer_pending[1] = 0;
+        stop = false;
+        wait_time = 0;
+        id2name = _id2name;
+        v_num = _v_num;
+        text_names = nullptr;
+        out_fd = -1;
+        out_size = 0;
+        if (cfg.format == CorpusWalkOutputFormat || cfg.format == ArchiveWalkOutputFormat) {
+            if (cfg.direct_io) {
+                LOG(WARNING) << block_mid_str() << "Direct I/O is only used for binary and text output";
+            }
+            out_fd = open(cfg.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            CHECK(out_fd >= 0) << "Cannot create " << cfg.path;
+            worker_num = mtcfg.thread_num;
+        } else {
+            worker_num = mtcfg.socket_num;
+        }
+        if (cfg.format == CorpusWalkOutputFormat) {
+            CHECK(id2name != nullptr);
+            text_names = id2name;
+            buffer_sized[0] = buffer_sized[1] = 0;
+            worker_text_size[0].resize(worker_num, 0);
+            worker_text_size[1].resize(worker_num, 0);
+        } else if (cfg.format == ArchiveWalkOutputFormat) {
+            WalkArchiveHeader header;
+            memset(&header, 0, sizeof(header));
+            header.magic = WalkArchiveMagic;
+            header.version = WalkArchiveVersion;
+            header.vertex_id_size = sizeof(vertex_id_t);
+            header.walk_len = walk_len;
+            pwrite_all(out_fd, (const char*) &header, sizeof(header), 0);
+            out_size = sizeof(header);
+            barrier.reset(new WorkerBarrier(worker_num));
+            archive_bucket_counts.resize(worker_num, std::vector<walker_id_t>((uint64_t) worker_num * 16));
+            archive_walker_num = 0;
+            archive_epoch_num = 0;
+        }
+        jobs.resize(worker_num);
+        for (int w_i = 0; w_i < worker_num; w_i++) {
+            if (cfg.format == CorpusWalkOutputFormat) {
+                threads.push_back(std::thread(&WalkWriter::corpus_loop, this, w_i));
+            } else if (cfg.format == ArchiveWalkOutputFormat) {
+                threads.push_back(std::thread(&WalkWriter::archive_loop, this, w_i));
+            } else {
+                threads.push_back(std::thread(&WalkWriter::shard_loop, this, w_i));
+            }
+        }
+    }
+
+    ~WalkWriter() {
+        finish();
+    }
+
+    /**
+     * Get the buffer to walk into, waiting until its previous content is written.
+     */
+    vertex_id_t* get_buffer() {
+        Timer timer;
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return buffer_pending[curr_buffer] == 0; });
+        wait_time += timer.duration();
+        return buffers[curr_buffer];
+    }
+
+    /**
+     * Hand the current buffer, with walker_num paths, to the writer threads
+     * and switch to the other buffer.
+     */
+    void submit(walker_id_t walker_num) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            buffer_pending[curr_buffer] = worker_num;
+            buffer_sized[curr_buffer] = 0;
+            for (int w_i = 0; w_i < worker_num; w_i++) {
+                WriteJob job;
+                job.buffer = curr_buffer;
+                job.walker_num = walker_num;
+                jobs[w_i].push_back(job);
+            }
+            curr_buffer ^= 1;
+        }
+        cv.notify_all();
+    }
+
+    // Wait for all the writes, then close the files
+    void finish() {
+        if (threads.empty()) {
+            return;
+        }
+        Timer timer;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto &t : threads) {
+            t.join();
+        }
+        threads.clear();
+        if (cfg.format == ArchiveWalkOutputFormat) {
+            finish_archive();
+        }
+        if (out_fd >= 0) {
+            close(out_fd);
+            out_fd = -1;
+        }
+        wait_time += timer.duration();
+        LOG(WARNING) << block_mid_str() << "Time waiting for walk output: " << wait_time << " seconds";
+    }
+};
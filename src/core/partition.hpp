@@ -8,6 +8,7 @@
 #include "graph.hpp"
 #include "sampler.hpp"
 #include "mini_bmk.hpp"
+#include "snapshot.hpp"
 
 /**
  * Produce partition hint for a graph.
@@ -56,7 +57,7 @@ void dp(
     #pragma omp parallel for
     for (vertex_id_t g_i = 0; g_i < group_num; g_i++) {
         vertex_id_t group_vertex_begin = g_i << group_bits;
-        vertex_id_t group_vertex_end = std::min(graph->v_num, (g_i + 1) << group_bits);
+        vertex_id_t group_vertex_end = std::min(graph->dead_end_begin, (g_i + 1) << group_bits);
 
         for (vertex_id_t partition_vertex_bits = min_partition_vertex_bit; partition_vertex_bits <= max_partition_vertex_bit; partition_vertex_bits ++ ){
             CHECK(partition_vertex_bits <= group_bits) << partition_vertex_bits << " " << group_bits;
@@ -118,7 +119,7 @@ void dp(
                 double partition_val = -1;
                 for (auto &method : partition_methods) {
                     double val = method.step_time * partition_walker_num;
-                    if (method.sampler_class != ClassExclusiveBufferSampler) {
+                    if (method.sampler_class != ClassExclusiveBufferSampler && method.sampler_class != ClassWeightedBufferSampler) {
                         val *= ds_penalty;
                     }
                     val *= sync_penalty;
@@ -213,35 +214,104 @@ void dp(
     LOG(WARNING) << block_end_str(1) << "MCKP in " << timer.duration() << " seconds";
 }
 
+/**
+ * Select the partitions whose node2vec walks are sampled with second-order
+ * alias tables, which take at most mem_budget bytes in total.
+ *
+ * Only the partitions whose degrees are at most SecondOrderAliasMaxDegree are
+ * considered. The payoff of a partition is the rejection trials it saves.
+ * At a vertex of degree d, rejection sampling takes 1 / a trials per step,
+ * where a = (1 / p + (d - 1) / q) / (d * max(1, 1 / p, 1 / q)) if the previous
+ * vertex shares no neighbors with it, and a vertex gets walkers in proportion
+ * to d. The partitions that save too few trials per step are skipped, and the
+ * rest are taken greedily by the payoff per byte, as a knapsack problem.
+ */
+std::vector<bool> select_second_order_partitions(Graph *graph, real_t p, real_t q, size_t mem_budget, size_t &mem_size)
+{
+    // The trials saved per step for the tables to pay off
+    const double min_saved_trial_num = 0.25;
+    const double upperbound = std::max((real_t) 1.0, std::max(1 / p, 1 / q));
+    std::vector<double> payoffs(graph->partition_num, 0);
+    std::vector<size_t> sizes(graph->partition_num, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int p_i = 0; p_i < graph->partition_num; p_i++) {
+        if (graph->partition_max_degree[p_i] > SecondOrderAliasMaxDegree) {
+            continue;
+        }
+        edge_id_t edge_num = 0;
+        for (vertex_id_t v_i = graph->partition_begin[p_i]; v_i < graph->partition_end[p_i]; v_i++) {
+            vertex_id_t degree = graph->adjlists[0][v_i].degree;
+            double accept_rate = (1 / p + (degree - 1) / q) / (degree * upperbound);
+            payoffs[p_i] += degree * (1 / accept_rate - 1);
+            edge_num += degree;
+        }
+        if (payoffs[p_i] < edge_num * min_saved_trial_num) {
+            payoffs[p_i] = 0;
+            continue;
+        }
+        sizes[p_i] = SecondOrderAliasSampler::get_size(graph->partition_begin[p_i], graph->partition_end[p_i], graph->adjlists[0]);
+    }
+    std::vector<int> candidates;
+    for (int p_i = 0; p_i < graph->partition_num; p_i++) {
+        if (payoffs[p_i] > 0) {
+            candidates.push_back(p_i);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&] (int a, int b) {
+        return payoffs[a] * sizes[b] > payoffs[b] * sizes[a];
+    });
+    std::vector<bool> selected(graph->partition_num, false);
+    int selected_num = 0;
+    mem_size = 0;
+    for (auto p_i : candidates) {
+        if (mem_size + sizes[p_i] <= mem_budget) {
+            selected[p_i] = true;
+            selected_num++;
+            mem_size += sizes[p_i];
+        }
+    }
+    LOG(WARNING) << block_mid_str() << "Second-order alias tables: " << selected_num << " out of " << candidates.size() << " paying partitions, " << size_string(mem_size);
+    return selected;
+}
+
+/**
+ * Benchmark the samplers for the graph, weighted or not, on degrees up to
+ * max_benchmark_degree, and partition the groups of graph_hint by dp().
+ */
+void get_benchmark_partition_hint(double walker_per_edge, vertex_id_t max_benchmark_degree, Graph *graph, MultiThreadConfig mtcfg, GraphHint *graph_hint) {
+    auto &group_bits = graph_hint->group_bits;
+    vertex_id_t min_partition_vertex_bit = std::min((vertex_id_t) min_partition_bits, group_bits);
+    vertex_id_t max_partition_vertex_bit = std::min((vertex_id_t) 24, group_bits);
+    std::map<vertex_id_t, std::map<vertex_id_t, std::vector<SampleEstimation> > > costs;
+    LOG(INFO) << block_mid_str() << "Max benchmark degree: " << max_benchmark_degree;
+    mini_benchmark(walker_per_edge, max_benchmark_degree, min_partition_vertex_bit, max_partition_vertex_bit, graph->weighted, mtcfg, costs);
+
+    dp(walker_per_edge, min_partition_vertex_bit, max_partition_vertex_bit, mtcfg.thread_num, costs, graph, graph_hint);
+}
+
 void get_partition_hint(double walker_per_edge, Graph *graph, MultiThreadConfig mtcfg, GraphHint *graph_hint) {
     auto &group_bits = graph_hint->group_bits;
     auto &group_hints = graph_hint->group_hints;
     auto &partition_sampler_class = graph_hint->partition_sampler_class;
     auto &group_num = graph_hint->group_num;
 
+    // Dead ends are never walked from, so only the vertices before them are partitioned
     group_bits = 0;
-    while ((graph->v_num >> group_bits) > max_group_num) {
+    while ((graph->dead_end_begin >> group_bits) > max_group_num) {
         group_bits ++;
     }
-    group_num = (graph->v_num + (1u << group_bits) - 1) / (1u << group_bits);
+    group_num = (graph->dead_end_begin + ((vertex_id_t) 1 << group_bits) - 1) >> group_bits;
 #ifndef UNIT_TEST
     _unused(group_hints);
     _unused(partition_sampler_class);
-    vertex_id_t min_partition_vertex_bit = std::min((uint32_t)min_partition_bits, group_bits);
-    vertex_id_t max_partition_vertex_bit = std::min(24u, group_bits);
-    std::map<vertex_id_t, std::map<vertex_id_t, std::vector<SampleEstimation> > > costs;
-    vertex_id_t max_benchmark_degree = 2048;
-    LOG(INFO) << block_mid_str() << "Max benchmark degree: " << max_benchmark_degree;
-    mini_benchmark(walker_per_edge, max_benchmark_degree, min_partition_vertex_bit, max_partition_vertex_bit, mtcfg, costs);
-
-    dp(walker_per_edge, min_partition_vertex_bit, max_partition_vertex_bit, mtcfg.thread_num, costs, graph, graph_hint);
+    get_benchmark_partition_hint(walker_per_edge, 2048, graph, mtcfg, graph_hint);
 #else
     group_hints.resize(group_num);
     vertex_id_t partition_num = 0;
     for (vertex_id_t g_i = 0; g_i < group_hints.size(); g_i++) {
         auto &hint = group_hints[g_i];
         hint.vertex_begin = g_i << group_bits;
-        hint.vertex_end = std::min((g_i + 1u) << group_bits, graph->v_num);
+        hint.vertex_end = std::min((g_i + 1u) << group_bits, graph->dead_end_begin);
         hint.partition_bits = group_bits;
         hint.total_time = 0;
         partition_num++;
@@ -258,7 +328,11 @@ void get_partition_hint(double walker_per_edge, Graph *graph, MultiThreadConfig
         }
     }
     for (vertex_id_t p_i = 0; p_i < partition_num; p_i++) {
-        partition_sampler_class.push_back(static_cast<SamplerClass>(rand() % ClassSamplerHintNum));
+        if (graph->weighted) {
+            partition_sampler_class.push_back(rand() % 2 == 0 ? ClassWeightedBufferSampler : ClassAliasSampler);
+        } else {
+            partition_sampler_class.push_back(static_cast<SamplerClass>(rand() % ClassSamplerHintNum));
+        }
     }
 #endif
 }
@@ -271,7 +345,9 @@ uint64_t estimate_epoch_walker(
     int walk_len,
     int socket_num,
     uint64_t mem_quota,
-    size_t other_size = 0
+    size_t other_size = 0,
+    int output_buffer_num = 1,
+    int extra_walker_array_num = 0
 )
 {
     #ifdef UNIT_TEST
@@ -280,10 +356,12 @@ uint64_t estimate_epoch_walker(
     size_t graph_memory_size = sizeof(AdjList) * vertex_num * (size_t) socket_num + sizeof(AdjUnit) * edge_num;
     size_t buffer_memory_size = sizeof(vertex_id_t) * buffer_edge_num;
     size_t per_walker_cost = sizeof(vertex_id_t) * (
-    // walk paths
-    (walk_len * 2) \
+    // walk paths and output paths
+    (walk_len * (1 + output_buffer_num)) \
     // messages + starting vertices
-    + 2 + 1);
+    + 2 + 1 \
+    // walker states, live walkers and their vertices, which are as wide as the vertex IDs
+    + extra_walker_array_num);
     // LOG(WARNING) << block_mid_str() << "Estimated memory size for graph data: " << size_string(graph_memory_size + buffer_memory_size + other_size);
     CHECK(mem_quota > graph_memory_size + buffer_memory_size + other_size) << "Assigned memory is too small to continue the computation";
     auto cal_max_active_walker_num = [&] (size_t memory_size) {
@@ -304,13 +382,16 @@ uint64_t estimate_epoch_walker(
 
     uint64_t temp_max_epoch_walker_num = cal_max_epoch_walker_num(mem_quota);
     #endif
-    temp_max_epoch_walker_num = std::min(temp_max_epoch_walker_num, (1ul << sizeof(walker_id_t) * 8ul) - 2ul);
+    temp_max_epoch_walker_num = std::min(temp_max_epoch_walker_num, (uint64_t) std::numeric_limits<walker_id_t>::max() - 1);
     return temp_max_epoch_walker_num;
 }
 
 /**
  * Load graph from the file. Next produce partition hints by mini-benchmark and MCKP.
  * Then partition the graph and make edge lists.
+ *
+ * If use_snapshot is set, the graph is loaded from a matching snapshot if any,
+ * otherwise a snapshot is saved after the graph is made.
  */
 void make_graph(
     const char* path,
@@ -321,21 +402,40 @@ void make_graph(
     MultiThreadConfig mtcfg,
     uint64_t mem_quota,
     bool is_node2vec,
-    Graph &graph
+    Graph &graph,
+    bool use_snapshot = false
 )
 {
 
     Timer timer;
     LOG(WARNING) << block_begin_str() << "Initialize graph";
+    std::string snapshot_path;
+    if (use_snapshot) {
+        snapshot_path = get_graph_snapshot_path(path, graph_format, as_undirected, graph.clean_edges, graph.weighted, graph.temporal, mtcfg);
+        if (load_graph_snapshot(snapshot_path.c_str(), path, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, is_node2vec, graph)) {
+            LOG(WARNING) << block_end_str() << "Initialize graph in " << timer.duration() << " seconds";
+            return;
+        }
+    }
     graph.load(path, graph_format, as_undirected);
 
     uint64_t total_walker = walker_num_func(graph.v_num, graph.e_num);
-    uint64_t epoch_walker = estimate_epoch_walker(graph.v_num, graph.e_num, graph.e_num, total_walker, walk_len, mtcfg.socket_num, mem_quota, is_node2vec ? BloomFilter::cal_hash_table_size(as_undirected ? graph.e_num / 2 : graph.e_num): 0);
+    size_t other_size = is_node2vec ? BloomFilter::cal_hash_table_size(graph.get_neighbor_query_item_num()) : 0;
+    if (graph.weighted) {
+        other_size += get_weighted_graph_extra_size(graph.e_num);
+    }
+    if (graph.temporal) {
+        other_size += sizeof(edge_time_t) * graph.e_num;
+    }
+    uint64_t epoch_walker = estimate_epoch_walker(graph.v_num, graph.e_num, graph.e_num, total_walker, walk_len, mtcfg.socket_num, mem_quota, other_size);
     double walker_per_edge = (double)epoch_walker / graph.e_num;
 
     GraphHint graph_hint;
     get_partition_hint(walker_per_edge, &graph, mtcfg, &graph_hint);
 
     graph.make(&graph_hint);
+    if (use_snapshot) {
+        save_graph_snapshot(snapshot_path.c_str(), path, total_walker, walk_len, mtcfg, mem_quota, is_node2vec, graph);
+    }
     LOG(WARNING) << block_end_str() << "Initialize graph in " << timer.duration() << " seconds";
 }
@@ -84,10 +84,16 @@ public:
     }
 
     vertex_id_t sample(const vertex_id_t vertex, default_rand_t *rd) {
+        return sample_buffer(vertex, rd, this);
+    }
+
+    // Take the next edge from the buffer, which is refilled by sampler->fill()
+    template<typename sampler_t>
+    vertex_id_t sample_buffer(const vertex_id_t vertex, default_rand_t *rd, sampler_t *sampler) {
         const vertex_id_t v_idx = vertex - vertex_begin;
         auto &h = headers[v_idx];
         if (h.head == h.end) {
-            fill(vertex, rd);
+            sampler->fill(vertex, rd);
         }
         uint32_t edge_idx = h.head++;
         vertex_id_t ret = units[edge_idx];
@@ -333,6 +339,303 @@ public:
     }
 };
 
+/**
+ * Samples the edges of weighted graphs in O(1) time with alias tables.
+ *
+ * Each edge of the partition has an AliasUnit, in the same order as the edges.
+ * A sample picks a unit of the vertex uniformly, then takes its neighbor with
+ * probability threshold / 2^32, or its alias otherwise. The threshold is
+ * compared with a 32-bit random integer, as gen_float has only 16 random bits,
+ * and the units of probability 1 have themselves as the aliases. The neighbors are kept in the
+ * units, so a sample reads one unit and does not touch the edges.
+ * The edges of a vertex whose weights sum up to 0 are sampled uniformly.
+ *
+ */
+class AliasSampler: public Sampler {
+public:
+    struct AliasUnit {
+        uint32_t threshold;
+        vertex_id_t neighbor;
+        vertex_id_t alias;
+    };
+    AliasUnit *units;
+    AdjUnit *edge_begin;
+    edge_id_t edge_num;
+
+    AliasSampler() {
+        units = nullptr;
+        edge_begin = nullptr;
+        edge_num = 0;
+        sampler_class = ClassAliasSampler;
+    }
+
+    virtual ~AliasSampler() {
+    }
+
+    AliasUnit* get_table(vertex_id_t vertex) {
+        return units + (adjlists[vertex].begin - edge_begin);
+    }
+
+    static vertex_id_t sample_table(const AliasUnit *table, vertex_id_t degree, default_rand_t *rd) {
+        const AliasUnit &unit = table[rd->gen(degree)];
+        return rd->gen_uint32() < unit.threshold ? unit.neighbor : unit.alias;
+    }
+
+    vertex_id_t sample(vertex_id_t vertex, default_rand_t *rd) {
+        return sample_table(get_table(vertex), adjlists[vertex].degree, rd);
+    }
+
+    // Build the alias table of the vertex
+    void build(vertex_id_t vertex, const real_t* weights, std::vector<double> &probs, std::vector<vertex_id_t> &small, std::vector<vertex_id_t> &large) {
+        build_table(adjlists[vertex], weights, get_table(vertex), probs, small, large);
+    }
+
+    // Build the alias table of the edges with Vose's method
+    static void build_table(const AdjList &adj, const real_t* weights, AliasUnit *table, std::vector<double> &probs, std::vector<vertex_id_t> &small, std::vector<vertex_id_t> &large) {
+        double sum = 0;
+        for (vertex_id_t e_i = 0; e_i < adj.degree; e_i++) {
+            sum += weights[e_i];
+        }
+        probs.resize(adj.degree);
+        small.clear();
+        large.clear();
+        for (vertex_id_t e_i = 0; e_i < adj.degree; e_i++) {
+            table[e_i].neighbor = adj.begin[e_i].neighbor;
+            table[e_i].alias = adj.begin[e_i].neighbor;
+            probs[e_i] = sum > 0 ? weights[e_i] * adj.degree / sum : 1.0;
+            if (probs[e_i] < 1.0) {
+                small.push_back(e_i);
+            } else {
+                large.push_back(e_i);
+            }
+        }
+        while (!small.empty() && !large.empty()) {
+            vertex_id_t s = small.back();
+            vertex_id_t l = large.back();
+            small.pop_back();
+            table[s].alias = adj.begin[l].neighbor;
+            probs[l] -= 1.0 - probs[s];
+            if (probs[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // The rest are left by rounding errors, whose probabilities should be 1
+        for (auto e_i : small) {
+            probs[e_i] = 1.0;
+        }
+        for (auto e_i : large) {
+            probs[e_i] = 1.0;
+        }
+        for (vertex_id_t e_i = 0; e_i < adj.degree; e_i++) {
+            // The threshold of probability 1 is rounded down, which is fine as the alias is the neighbor itself
+            table[e_i].threshold = (uint32_t) std::min(probs[e_i] * 4294967296.0, 4294967295.0);
+        }
+    }
+
+    /**
+     * The weights are in the same layout as the edges of the partition,
+     * starting from the weight of the first edge of vertex_begin.
+     */
+    void init(vertex_id_t _vertex_begin, vertex_id_t _vertex_end, AdjList *_adjlists, const real_t *weights, MemoryPool *mpool, int socket) {
+        vertex_begin = _vertex_begin;
+        vertex_end = _vertex_end;
+        adjlists = _adjlists;
+        edge_begin = adjlists[vertex_begin].begin;
+        edge_num = 0;
+        for (vertex_id_t v_i = vertex_begin; v_i < vertex_end; v_i++) {
+            edge_num += adjlists[v_i].degree;
+        }
+        units = mpool->alloc<AliasUnit>(edge_num, socket);
+
+        std::vector<double> probs;
+        std::vector<vertex_id_t> small;
+        std::vector<vertex_id_t> large;
+        for (vertex_id_t v_i = vertex_begin; v_i < vertex_end; v_i++) {
+            build(v_i, weights + (adjlists[v_i].begin - edge_begin), probs, small, large);
+        }
+    }
+
+    /**
+     * Flushes all the data out of cache.
+     *
+     * This function is only used in performance profiling where the data will be repeatedly
+     * accessed to measure the average sampling overhead. Allowing data residing in the cache
+     * may affect the accuracy of the measurement.
+     *
+     */
+    void reset(vertex_id_t _vertex_begin, vertex_id_t _vertex_end, AdjList *_adjlists) {
+        for (edge_id_t e_i = 0; e_i < edge_num; e_i += CacheLineSize / sizeof(AliasUnit)) {
+            _mm_clflush(&units[e_i]);
+        }
+        for (vertex_id_t v_i = vertex_begin; v_i < vertex_end; v_i += CacheLineSize / sizeof(AdjList)) {
+            _mm_clflush(&adjlists[v_i]);
+        }
+        vertex_begin = _vertex_begin;
+        vertex_end = _vertex_end;
+        adjlists = _adjlists;
+    }
+};
+
+/**
+ * The weighted ExclusiveBufferSampler for weighted graphs.
+ *
+ * The edge buffer of each vertex is refilled in batch from the alias table of
+ * the vertex, which is flushed out of cache afterwards like the edges in
+ * ExclusiveBufferSampler::fill.
+ *
+ */
+class WeightedBufferSampler: public ExclusiveBufferSampler {
+public:
+    AliasSampler alias;
+
+    WeightedBufferSampler() {
+        sampler_class = ClassWeightedBufferSampler;
+    }
+
+    virtual ~WeightedBufferSampler() {
+    }
+
+    vertex_id_t sample(const vertex_id_t vertex, default_rand_t *rd) {
+        return sample_buffer(vertex, rd, this);
+    }
+
+    void fill(vertex_id_t vertex, default_rand_t *rd) {
+        auto &h = headers[vertex - vertex_begin];
+        const AliasSampler::AliasUnit *table = alias.get_table(vertex);
+        vertex_id_t degree = adjlists[vertex].degree;
+
+        vertex_id_t *p_begin = units + (h.end - get_edge_buffer_length(vertex));
+        vertex_id_t *p_end = units + h.head;
+        vertex_id_t fill_edge_num = p_end - p_begin;
+
+        for (vertex_id_t e_i = 0; e_i < fill_edge_num; e_i ++) {
+            p_begin[e_i] = AliasSampler::sample_table(table, degree, rd);
+        }
+        for (vertex_id_t e_i = 0; e_i < degree; e_i += CacheLineSize / sizeof(AliasSampler::AliasUnit)) {
+            _mm_clflush(&table[e_i]);
+        }
+        h.head = h.end - get_edge_buffer_length(vertex);
+    }
+
+    void init(vertex_id_t _vertex_begin, vertex_id_t _vertex_end, AdjList *_adjlists, const real_t *weights, MemoryPool *mpool, int socket) {
+        ExclusiveBufferSampler::init(_vertex_begin, _vertex_end, _adjlists, mpool, socket);
+        alias.init(_vertex_begin, _vertex_end, _adjlists, weights, mpool, socket);
+    }
+
+    // Flushes all the data out of cache, only used in performance profiling.
+    void reset(vertex_id_t _vertex_begin, vertex_id_t _vertex_end, AdjList *_adjlists) {
+        alias.reset(_vertex_begin, _vertex_end, _adjlists);
+        ExclusiveBufferSampler::reset(_vertex_begin, _vertex_end, _adjlists);
+    }
+};
+
+// The memory of the edge weights and the alias tables of a weighted graph
+size_t get_weighted_graph_extra_size(edge_id_t e_num) {
+    return (sizeof(real_t) + sizeof(AliasSampler::AliasUnit)) * e_num;
+}
+
+/**
+ * Samples the node2vec edges of low-degree partitions in O(1) time with
+ * second-order alias tables, without rejection or neighbor queries.
+ *
+ * Each vertex has an alias table for each of its neighbors as the previous
+ * vertex, whose weights are the node2vec biases, multiplied by the edge
+ * weights on weighted graphs. So a vertex of degree d has d * d AliasUnits.
+ * The previous vertex is found in the sorted neighbors of the current one.
+ *
+ */
+class SecondOrderAliasSampler {
+public:
+    vertex_id_t vertex_begin;
+    vertex_id_t vertex_end;
+    AdjList *adjlists;
+    // The first AliasUnit of the tables of each vertex
+    edge_id_t *table_offsets;
+    AliasSampler::AliasUnit *units;
+
+    SecondOrderAliasSampler() {
+        vertex_begin = 0;
+        vertex_end = 0;
+        adjlists = nullptr;
+        table_offsets = nullptr;
+        units = nullptr;
+    }
+
+    static size_t get_size(vertex_id_t _vertex_begin, vertex_id_t _vertex_end, const AdjList *_adjlists) {
+        size_t size = sizeof(edge_id_t) * (_vertex_end - _vertex_begin);
+        for (vertex_id_t v_i = _vertex_begin; v_i < _vertex_end; v_i++) {
+            size += sizeof(AliasSampler::AliasUnit) * _adjlists[v_i].degree * _adjlists[v_i].degree;
+        }
+        return size;
+    }
+
+    // Return MaxVertexId if the previous vertex is not a neighbor of the current one
+    vertex_id_t sample(vertex_id_t previous, vertex_id_t current, default_rand_t *rd) {
+        const AdjList &adj = adjlists[current];
+        // The neighbors are counted without early exits, which is vectorized
+        vertex_id_t idx = 0;
+        for (vertex_id_t e_i = 0; e_i < adj.degree; e_i++) {
+            idx += adj.begin[e_i].neighbor < previous;
+        }
+        if (idx == adj.degree || adj.begin[idx].neighbor != previous) {
+            return MaxVertexId;
+        }
+        const AliasSampler::AliasUnit *table = units + table_offsets[current - vertex_begin] + (edge_id_t) idx * adj.degree;
+        return AliasSampler::sample_table(table, adj.degree, rd);
+    }
+
+    // The neighbors must be sorted and queryable, i.e. after Graph::prepare_neighbor_query
+    void init(vertex_id_t _vertex_begin, vertex_id_t _vertex_end, Graph *graph, real_t p, real_t q, MemoryPool *mpool, int socket) {
+        vertex_begin = _vertex_begin;
+        vertex_end = _vertex_end;
+        adjlists = graph->adjlists[socket];
+        table_offsets = mpool->alloc<edge_id_t>(vertex_end - vertex_begin, socket);
+        edge_id_t unit_num = 0;
+        for (vertex_id_t v_i = vertex_begin; v_i < vertex_end; v_i++) {
+            table_offsets[v_i - vertex_begin] = unit_num;
+            unit_num += (edge_id_t) adjlists[v_i].degree * adjlists[v_i].degree;
+        }
+        units = mpool->alloc<AliasSampler::AliasUnit>(unit_num, socket);
+
+        std::vector<real_t> biases;
+        std::vector<double> probs;
+        std::vector<vertex_id_t> small;
+        std::vector<vertex_id_t> large;
+        for (vertex_id_t v_i = vertex_begin; v_i < vertex_end; v_i++) {
+            const AdjList &adj = adjlists[v_i];
+            const real_t *weights = graph->weighted ? graph->get_edge_weights(v_i) : nullptr;
+            biases.resize(adj.degree);
+            for (vertex_id_t prev_i = 0; prev_i < adj.degree; prev_i++) {
+                vertex_id_t previous = adj.begin[prev_i].neighbor;
+                for (vertex_id_t e_i = 0; e_i < adj.degree; e_i++) {
+                    vertex_id_t next = adj.begin[e_i].neighbor;
+                    real_t bias = next == previous ? 1 / p : (graph->has_neighbor(previous, next, socket) ? 1 : 1 / q);
+                    biases[e_i] = weights != nullptr ? bias * weights[e_i] : bias;
+                }
+                AliasSampler::build_table(adj, biases.data(), units + table_offsets[v_i - vertex_begin] + (edge_id_t) prev_i * adj.degree, probs, small, large);
+            }
+        }
+    }
+};
+
+/**
+ * TemporalSampler samples the edges of temporal graphs for time-respecting
+ * walks. The edges of each vertex are sorted by time, so the edges no earlier
+ * than the current time are a suffix, which is found by binary search and
+ * sampled uniformly. It keeps no state, so it is shared by all the partitions.
+ */
+struct TemporalSampler {
+    // Return the index of the sampled edge, or degree if no edge is valid
+    static vertex_id_t sample(const edge_time_t* times, vertex_id_t degree, edge_time_t time, default_rand_t *rd) {
+        vertex_id_t begin = std::lower_bound(times, times + degree, time) - times;
+        if (begin == degree) {
+            return degree;
+        }
+        return begin + rd->gen(degree - begin);
+    }
+};
+
 /**
  * Manages all the samplers.
  *
@@ -351,6 +654,8 @@ protected:
     MultiThreadConfig mtcfg;
 public:
     std::vector<Sampler*> samplers;
+    // The second-order alias samplers of node2vec, or nullptr for the partitions without
+    std::vector<SecondOrderAliasSampler*> second_order_samplers;
 
     void clear() {
         #pragma omp parallel for
@@ -360,6 +665,9 @@ public:
                 case ClassExclusiveBufferSampler: static_cast<ExclusiveBufferSampler*>(sampler)->clear(); break;
                 case ClassDirectSampler: break;
                 case ClassUniformDegreeDirectSampler: break;
+                case ClassSimilarDegreeDirectSampler: break;
+                case ClassAliasSampler: break;
+                case ClassWeightedBufferSampler: static_cast<WeightedBufferSampler*>(sampler)->clear(); break;
                 default: CHECK(false);
             }
         }
@@ -380,13 +688,23 @@ public:
         profiler = _profiler;
 
         samplers.resize(graph->partition_num);
+        second_order_samplers.assign(graph->partition_num, nullptr);
 
         auto &edge_buffer_data_size = profiler->edge_buffer_data_size;
         edge_buffer_data_size = 0;
 #pragma omp parallel for reduction (+: edge_buffer_data_size)
         for (int p_i = 0; p_i < graph->partition_num; p_i++) {
             auto &sampler_class = graph->partition_sampler_class[p_i];
-            if (sampler_class == ClassExclusiveBufferSampler) {
+            if (graph->weighted && sampler_class == ClassWeightedBufferSampler) {
+                auto* sampler = mpool.alloc_new<WeightedBufferSampler>(1, graph->partition_socket[p_i]);
+                sampler->init(graph->partition_begin[p_i], graph->partition_end[p_i], graph->adjlists[graph->partition_socket[p_i]], graph->get_edge_weights(graph->partition_begin[p_i]), &mpool, graph->partition_socket[p_i]);
+                samplers[p_i] = sampler;
+                edge_buffer_data_size += sampler->buffer_unit_num;
+            } else if (graph->weighted) {
+                auto* sampler = mpool.alloc_new<AliasSampler>(1, graph->partition_socket[p_i]);
+                sampler->init(graph->partition_begin[p_i], graph->partition_end[p_i], graph->adjlists[graph->partition_socket[p_i]], graph->get_edge_weights(graph->partition_begin[p_i]), &mpool, graph->partition_socket[p_i]);
+                samplers[p_i] = sampler;
+            } else if (sampler_class == ClassExclusiveBufferSampler) {
                 auto* sampler = mpool.alloc_new<ExclusiveBufferSampler>(1, graph->partition_socket[p_i]);
                 sampler->init(graph->partition_begin[p_i], graph->partition_end[p_i], graph->adjlists[graph->partition_socket[p_i]], &mpool, graph->partition_socket[p_i]);
                 samplers[p_i] = sampler;
@@ -424,4 +742,18 @@ public:
         }
         LOG(WARNING) << block_mid_str() << "Initialize samplers in " << timer.duration() << " seconds";
     }
+
+    // Build the second-order alias samplers of the selected partitions for node2vec after init()
+    void init_second_order(const std::vector<bool> &selected_partitions, real_t p, real_t q) {
+        Timer timer;
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int p_i = 0; p_i < graph->partition_num; p_i++) {
+            if (selected_partitions[p_i]) {
+                auto* sampler = mpool.alloc_new<SecondOrderAliasSampler>(1, graph->partition_socket[p_i]);
+                sampler->init(graph->partition_begin[p_i], graph->partition_end[p_i], graph, p, q, &mpool, graph->partition_socket[p_i]);
+                second_order_samplers[p_i] = sampler;
+            }
+        }
+        LOG(WARNING) << block_mid_str() << "Initialize second-order alias samplers in " << timer.duration() << " seconds";
+    }
 };
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <sstream>
+#include <functional>
+
+#include <omp.h>
+
+#include "type.hpp"
+#include "constants.hpp"
+#include "timer.hpp"
+#include "log.hpp"
+#include "io.hpp"
+#include "graph.hpp"
+
+/**
+ * A graph snapshot stores a preprocessed graph under FMobDir: the relabeled
+ * CSR, id2name, the GraphHint and the partition tables. Later runs on the same
+ * graph file could map the snapshot instead of loading, sorting, partitioning
+ * and making the graph again. As the partition hint depends on the walk
+ * configuration, a snapshot is only reused under the same thread number, socket
+ * number, walker number, walk length, memory quota and algorithm.
+ *
+ * The file starts with a GraphSnapshotHeader, followed by the sections in the
+ * order they are written in save_graph_snapshot. Each section is aligned to PageSize.
+ * The edges are stored per socket, in the same layout as Graph::edges, and so
+ * are the edge weights of weighted graphs and the edge times of temporal graphs.
+ */
+#define GraphSnapshotMagic 0x50414e53424f4d46ull // "FMOBSNAP"
+#define GraphSnapshotVersion 5
+
+struct GraphSnapshotHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t vertex_id_size;
+    uint32_t adj_unit_size;
+    int32_t socket_num;
+    int32_t thread_num;
+    int32_t as_undirected;
+    int32_t clean_edges;
+    int32_t is_node2vec;
+    int32_t walk_len;
+    int32_t weighted;
+    int32_t temporal;
+    int32_t reserved;
+    uint64_t mem_quota;
+    uint64_t total_walker;
+    // To detect changes of the graph file
+    uint64_t graph_size;
+    int64_t graph_mtime;
+    uint64_t v_num;
+    uint64_t e_num;
+    uint64_t dead_end_begin;
+    uint64_t group_bits;
+    uint64_t group_num;
+    uint64_t group_hint_num;
+    uint64_t sampler_class_num;
+    uint64_t partition_num;
+};
+
+size_t get_snapshot_aligned_size(size_t size) {
+    return (size + PageSize - 1) / PageSize * PageSize;
+}
+
+// The total size and the latest mtime of the graph shards
+void get_graph_file_stat(const char* graph_path, uint64_t &size, int64_t &mtime) {
+    std::vector<std::string> shards;
+    get_graph_shard_paths(graph_path, shards);
+    size = 0;
+    mtime = 0;
+    for (auto &shard : shards) {
+        struct stat st;
+        CHECK(stat(shard.c_str(), &st) == 0) << "Cannot stat " << shard;
+        size += st.st_size;
+        mtime = std::max(mtime, (int64_t) st.st_mtime);
+    }
+}
+
+/**
+ * The snapshot name is decided by the graph path, the graph format and the way
+ * it's loaded, as well as the concurrency settings.
+ */
+std::string get_graph_snapshot_path(const char* graph_path, GraphFormat graph_format, bool as_undirected, bool clean_edges, bool weighted, bool temporal, MultiThreadConfig mtcfg) {
+    char real_path[PATH_MAX];
+    if (realpath(graph_path, real_path) == NULL) {
+        strncpy(real_path, graph_path, PATH_MAX - 1);
+        real_path[PATH_MAX - 1] = 0;
+    }
+    std::stringstream key_ss;
+    key_ss << real_path << "|" << graph_format << "|" << as_undirected << "|" << clean_edges << "|" << weighted << "|" << temporal;
+    std::stringstream path_ss;
+    path_ss << FMobDir << "/snapshot_" << std::hex << std::hash<std::string>()(key_ss.str()) << std::dec \
+        << "_" << mtcfg.socket_num << "_" << mtcfg.thread_num << ".bin";
+    return path_ss.str();
+}
+
+/**
+ * Writes sections to a snapshot file, padding each of them to PageSize.
+ */
+class GraphSnapshotWriter {
+    FILE *f;
+    size_t offset;
+public:
+    GraphSnapshotWriter(const char* path) {
+        f = fopen(path, "w");
+        CHECK(f != NULL) << "Cannot create " << path;
+        offset = 0;
+    }
+
+    ~GraphSnapshotWriter() {
+        fclose(f);
+    }
+
+    void write(const void* data, size_t size) {
+        if (size != 0) {
+            CHECK(fwrite(data, 1, size, f) == size);
+        }
+        size_t aligned_size = get_snapshot_aligned_size(size);
+        for (size_t p_i = size; p_i < aligned_size; p_i++) {
+            fputc(0, f);
+        }
+        offset += aligned_size;
+    }
+};
+
+/**
+ * Reads sections from a mapped snapshot file in the same order as they are written.
+ */
+class GraphSnapshotReader {
+    const char *data;
+    size_t size;
+    size_t offset;
+public:
+    GraphSnapshotReader(const char* _data, size_t _size) {
+        data = _data;
+        size = _size;
+        offset = 0;
+    }
+
+    template<typename T>
+    const T* read(size_t num) {
+        const T* p = reinterpret_cast<const T*>(data + offset);
+        offset += get_snapshot_aligned_size(sizeof(T) * num);
+        CHECK(offset <= size) << "Broken graph snapshot";
+        return p;
+    }
+};
+
+void save_graph_snapshot(
+    const char* snapshot_path,
+    const char* graph_path,
+    uint64_t total_walker,
+    int walk_len,
+    MultiThreadConfig mtcfg,
+    uint64_t mem_quota,
+    bool is_node2vec,
+    Graph &graph
+)
+{
+    Timer timer;
+    std::string cmd = std::string("mkdir -p ") + FMobDir;
+    CHECK(0 == system(cmd.c_str()));
+
+    GraphSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = GraphSnapshotMagic;
+    header.version = GraphSnapshotVersion;
+    header.vertex_id_size = sizeof(vertex_id_t);
+    header.adj_unit_size = sizeof(AdjUnit);
+    header.socket_num = mtcfg.socket_num;
+    header.thread_num = mtcfg.thread_num;
+    header.as_undirected = graph.as_undirected;
+    header.clean_edges = graph.clean_edges;
+    header.is_node2vec = is_node2vec;
+    header.walk_len = walk_len;
+    header.weighted = graph.weighted;
+    header.temporal = graph.temporal;
+    header.mem_quota = mem_quota;
+    header.total_walker = total_walker;
+    get_graph_file_stat(graph_path, header.graph_size, header.graph_mtime);
+    header.v_num = graph.v_num;
+    header.e_num = graph.e_num;
+    header.dead_end_begin = graph.dead_end_begin;
+    header.group_bits = graph.group_bits;
+    header.group_num = graph.group_num;
+    header.group_hint_num = graph.group_hints.size();
+    header.sampler_class_num = graph.partition_sampler_class.size();
+    header.partition_num = graph.partition_num;
+
+    // Write to a temporary file first, so that a broken snapshot is never visible.
+    std::string temp_path = std::string(snapshot_path) + ".tmp";
+    {
+        GraphSnapshotWriter writer(temp_path.c_str());
+        writer.write(&header, sizeof(header));
+        writer.write(graph.group_hints.data(), sizeof(GroupHint) * graph.group_hints.size());
+        std::vector<int32_t> sampler_class(graph.partition_sampler_class.begin(), graph.partition_sampler_class.end());
+        writer.write(sampler_class.data(), sizeof(int32_t) * sampler_class.size());
+        writer.write(graph.partition_begin.data(), sizeof(vertex_id_t) * graph.partition_num);
+        writer.write(graph.partition_end.data(), sizeof(vertex_id_t) * graph.partition_num);
+        writer.write(graph.partition_edge_num.data(), sizeof(edge_id_t) * graph.partition_num);
+        writer.write(graph.partition_max_degree.data(), sizeof(vertex_id_t) * graph.partition_num);
+        writer.write(graph.partition_min_degree.data(), sizeof(vertex_id_t) * graph.partition_num);
+        writer.write(graph.id2name, sizeof(vertex_id_t) * graph.v_num);
+        std::vector<vertex_id_t> degrees(graph.v_num);
+        #pragma omp parallel for
+        for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+            degrees[v_i] = graph.adjlists[0][v_i].degree;
+        }
+        writer.write(degrees.data(), sizeof(vertex_id_t) * graph.v_num);
+        writer.write(graph.socket_edge_num.data(), sizeof(edge_id_t) * mtcfg.socket_num);
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            writer.write(graph.edges[s_i], sizeof(AdjUnit) * graph.socket_edge_num[s_i]);
+        }
+        if (graph.weighted) {
+            for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+                writer.write(graph.edge_weights[s_i], sizeof(real_t) * graph.socket_edge_num[s_i]);
+            }
+        }
+        if (graph.temporal) {
+            for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+                writer.write(graph.edge_times[s_i], sizeof(edge_time_t) * graph.socket_edge_num[s_i]);
+            }
+        }
+    }
+    CHECK(0 == rename(temp_path.c_str(), snapshot_path));
+    LOG(WARNING) << block_mid_str() << "Save graph snapshot " << snapshot_path << " in " << timer.duration() << " seconds";
+}
+
+/**
+ * Copy a socket-owned array from the snapshot with the threads of that socket,
+ * so that the pages are first touched on the owning socket.
+ */
+template<typename T>
+void copy_snapshot_socket_arrays(T** dst, const T** src, const edge_id_t* len, MultiThreadConfig mtcfg) {
+    #pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        int socket = mtcfg.socket_id(thread);
+        edge_id_t thread_len = (len[socket] + mtcfg.socket_thread_num() - 1) / mtcfg.socket_thread_num();
+        edge_id_t begin = std::min(len[socket], thread_len * mtcfg.socket_offset(thread));
+        edge_id_t end = std::min(len[socket], begin + thread_len);
+        if (end > begin) {
+            memcpy(dst[socket] + begin, src[socket] + begin, sizeof(T) * (end - begin));
+        }
+    }
+}
+
+/**
+ * Load a graph from the snapshot. Return false if the snapshot does not exist
+ * or does not match the graph file and the configuration.
+ */
+bool load_graph_snapshot(
+    const char* snapshot_path,
+    const char* graph_path,
+    bool as_undirected,
+    std::function<uint64_t(vertex_id_t, edge_id_t)> walker_num_func,
+    int walk_len,
+    MultiThreadConfig mtcfg,
+    uint64_t mem_quota,
+    bool is_node2vec,
+    Graph &graph
+)
+{
+    if (access(snapshot_path, R_OK) != 0) {
+        LOG(WARNING) << block_mid_str() << "No graph snapshot found: " << snapshot_path;
+        return false;
+    }
+    Timer timer;
+    MappedFile f(snapshot_path);
+    if (f.size < sizeof(GraphSnapshotHeader)) {
+        LOG(WARNING) << block_mid_str() << "Ignore broken graph snapshot: " << snapshot_path;
+        return false;
+    }
+    GraphSnapshotReader reader(f.data, f.size);
+    const GraphSnapshotHeader &header = *reader.read<GraphSnapshotHeader>(1);
+    uint64_t graph_size;
+    int64_t graph_mtime;
+    get_graph_file_stat(graph_path, graph_size, graph_mtime);
+    if (header.magic != GraphSnapshotMagic || header.version != GraphSnapshotVersion \
+        || header.vertex_id_size != sizeof(vertex_id_t) || header.adj_unit_size != sizeof(AdjUnit) \
+        || header.socket_num != mtcfg.socket_num || header.thread_num != mtcfg.thread_num \
+        || header.as_undirected != as_undirected || header.clean_edges != graph.clean_edges \
+        || header.is_node2vec != is_node2vec || header.weighted != graph.weighted || header.temporal != graph.temporal \
+        || header.walk_len != walk_len || header.mem_quota != mem_quota \
+        || header.total_walker != walker_num_func(header.v_num, header.e_num) \
+        || header.graph_size != graph_size || header.graph_mtime != graph_mtime) {
+        LOG(WARNING) << block_mid_str() << "Ignore outdated graph snapshot: " << snapshot_path;
+        return false;
+    }
+
+    LOG(WARNING) << block_begin_str(1) << "Load graph snapshot " << snapshot_path;
+    graph.as_undirected = header.as_undirected;
+    graph.v_num = header.v_num;
+    graph.e_num = header.e_num;
+    graph.dead_end_begin = header.dead_end_begin;
+
+    GraphHint graph_hint;
+    graph_hint.group_bits = header.group_bits;
+    graph_hint.group_num = header.group_num;
+    const GroupHint* group_hints = reader.read<GroupHint>(header.group_hint_num);
+    graph_hint.group_hints.assign(group_hints, group_hints + header.group_hint_num);
+    const int32_t* sampler_class = reader.read<int32_t>(header.sampler_class_num);
+    for (uint64_t p_i = 0; p_i < header.sampler_class_num; p_i++) {
+        graph_hint.partition_sampler_class.push_back(static_cast<SamplerClass>(sampler_class[p_i]));
+    }
+    graph.make_partitions(&graph_hint);
+    CHECK((uint64_t) graph.partition_num == header.partition_num);
+
+    const vertex_id_t* partition_begin = reader.read<vertex_id_t>(header.partition_num);
+    const vertex_id_t* partition_end = reader.read<vertex_id_t>(header.partition_num);
+    const edge_id_t* partition_edge_num = reader.read<edge_id_t>(header.partition_num);
+    const vertex_id_t* partition_max_degree = reader.read<vertex_id_t>(header.partition_num);
+    const vertex_id_t* partition_min_degree = reader.read<vertex_id_t>(header.partition_num);
+    for (int p_i = 0; p_i < graph.partition_num; p_i++) {
+        CHECK(graph.partition_begin[p_i] == partition_begin[p_i] && graph.partition_end[p_i] == partition_end[p_i]) << "Broken graph snapshot";
+    }
+    graph.partition_edge_num.assign(partition_edge_num, partition_edge_num + header.partition_num);
+    graph.partition_max_degree.assign(partition_max_degree, partition_max_degree + header.partition_num);
+    graph.partition_min_degree.assign(partition_min_degree, partition_min_degree + header.partition_num);
+
+    const vertex_id_t* id2name = reader.read<vertex_id_t>(graph.v_num);
+    graph.alloc_id2name();
+    #pragma omp parallel for
+    for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+        graph.id2name[v_i] = id2name[v_i];
+    }
+
+    const vertex_id_t* degrees = reader.read<vertex_id_t>(graph.v_num);
+    graph.alloc_adjlists();
+    #pragma omp parallel for
+    for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+        graph.adjlists[0][v_i].degree = degrees[v_i];
+    }
+    graph.alloc_edges();
+
+    const edge_id_t* socket_edge_num = reader.read<edge_id_t>(mtcfg.socket_num);
+    std::vector<const AdjUnit*> socket_edges(mtcfg.socket_num);
+    for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+        CHECK(socket_edge_num[s_i] == graph.socket_edge_num[s_i]) << "Broken graph snapshot";
+        socket_edges[s_i] = reader.read<AdjUnit>(socket_edge_num[s_i]);
+    }
+    copy_snapshot_socket_arrays(graph.edges.get(), socket_edges.data(), socket_edge_num, mtcfg);
+    if (graph.weighted) {
+        std::vector<const real_t*> socket_weights(mtcfg.socket_num);
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            socket_weights[s_i] = reader.read<real_t>(socket_edge_num[s_i]);
+        }
+        copy_snapshot_socket_arrays(graph.edge_weights.get(), socket_weights.data(), socket_edge_num, mtcfg);
+    }
+    if (graph.temporal) {
+        std::vector<const edge_time_t*> socket_times(mtcfg.socket_num);
+        for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+            socket_times[s_i] = reader.read<edge_time_t>(socket_edge_num[s_i]);
+        }
+        copy_snapshot_socket_arrays(graph.edge_times.get(), socket_times.data(), socket_edge_num, mtcfg);
+    }
+    graph.sync_adjlists();
+
+    LOG(WARNING) << block_mid_str(1) << "Vertices number: " << graph.v_num;
+    LOG(WARNING) << block_mid_str(1) << "Edges number: " << graph.e_num;
+    LOG(WARNING) << block_mid_str(1) << "Partition number: " << graph.partition_num;
+    LOG(WARNING) << block_mid_str(1) << "Total graph size: " << size_string(graph.get_memory_size());
+    LOG(WARNING) << block_end_str(1) << "Load graph snapshot in " << timer.duration() << " seconds";
+    return true;
+}
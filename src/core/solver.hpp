@@ -5,6 +5,8 @@
 
 #include <iomanip>
 #include <map>
+#include <vector>
+#include <functional>
 
 #include <omp.h>
 
@@ -22,6 +24,35 @@
 #include "profiler.hpp"
 #include "partition.hpp"
 #include "perf_helper.hpp"
+#include "output.hpp"
+
+/**
+ * The paths of an epoch that reside on one socket, in the layout of the
+ * output arrays: vertex_id_t [walker_num][walk_len].
+ */
+struct SocketWalkSpan {
+    int socket;
+    const vertex_id_t* paths;
+    // The index of the first walker in the epoch
+    walker_id_t first_walker;
+    walker_id_t walker_num;
+};
+
+/**
+ * A read-only view of the paths of an epoch, which is only valid during the
+ * consumer callback. The spans point into the NUMA-local output buffer,
+ * so nothing is copied.
+ */
+struct EpochWalkView {
+    uint64_t epoch;
+    // The index of the first walker of the epoch among all walkers
+    uint64_t first_walker;
+    walker_id_t walker_num;
+    int walk_len;
+    std::vector<SocketWalkSpan> sockets;
+};
+
+typedef std::function<void(const EpochWalkView&)> WalkConsumer;
 
 /**
  * FMobSolver manages the whole random walk processing.
@@ -42,6 +73,23 @@ class FMobSolver{
     walker_id_t walker_start_vertices_num;
 
     bool is_node2vec;
+    real_t n2v_p;
+    real_t n2v_q;
+    // The memory budget of the second-order alias tables of node2vec, or 0 for none
+    size_t second_order_alias_mem;
+    bool is_metapath;
+    std::vector<vertex_type_t> metapath;
+    // The metapath positions or the edge times of the walkers
+    walker_state_t *walker_states;
+    // The probability that a walk ends at each step, or 0 for walks of walk_len
+    real_t termination_prob;
+    // The live walkers of terminating walks, compacted between the steps
+    walker_id_t *live_walkers;
+    // The current, next and previous vertices of the live walkers
+    vertex_id_t *live_vertices[3];
+    uint64_t terminated_walk_step;
+    DeadEndMode dead_end_mode;
+    int output_buffer_num;
 
     MessageManager msgm;
     SamplerManager sm;
@@ -50,6 +98,11 @@ class FMobSolver{
 
     std::vector<vertex_id_t*> walks;
 
+    // The metapath and temporal walkers carry states and walk without samplers
+    bool has_walker_states() {
+        return is_metapath || graph->temporal;
+    }
+
     bool is_hdv_thread (int t_id) {
         return (int)t_id < (mtcfg.thread_num + 1) / 2;
     }
@@ -60,10 +113,9 @@ class FMobSolver{
         if ((int) walks.size() < walk_len) {
             Timer timer;
             int old_num = walks.size();
-            int new_num = walk_len - old_num;
             walks.resize(walk_len);
-            #pragma omp parallel for
-            for (int w_i = old_num; w_i < new_num; w_i++) {
+            // Each array is touched in parallel by the threads of its walkers
+            for (int w_i = old_num; w_i < walk_len; w_i++) {
                 walks[w_i] = wkrm.alloc_walker_array<vertex_id_t>();
             }
             LOG(WARNING) << block_mid_str() << "Initialize walk arrays in " << timer.duration() << " seconds";
@@ -71,7 +123,6 @@ class FMobSolver{
     }
 
     vertex_id_t* get_walker_start_vertices(walker_id_t epoch_walker_num) {
-        const vertex_id_t v_num = graph->v_num;
         if (walker_start_vertices_num < epoch_walker_num) {
             if (walker_start_vertices != nullptr) {
                 wkrm.dealloc_walker_array(walker_start_vertices);
@@ -80,7 +131,8 @@ class FMobSolver{
         }
         walker_start_vertices_num = epoch_walker_num;
         wkrm.process_walkers([&](walker_id_t w_i) {
-            walker_start_vertices[w_i] = rands[omp_get_thread_num()]->gen(v_num);
+            auto *rd = rands[omp_get_thread_num()];
+            walker_start_vertices[w_i] = wm.gen_start_vertex(rd);
         }, epoch_walker_num);
         return walker_start_vertices;
     }
@@ -91,6 +143,17 @@ public:
     FMobSolver(Graph* _graph, MultiThreadConfig _mtcfg) : mtcfg (_mtcfg), mpool(_mtcfg), msgm(_mtcfg), sm(_mtcfg), wm(_mtcfg), wkrm(_mtcfg), profiler(_graph->partition_num, _graph->group_num) {
         graph = _graph;
         is_node2vec = false;
+        n2v_p = 1;
+        n2v_q = 1;
+        second_order_alias_mem = 0;
+        is_metapath = false;
+        walker_states = nullptr;
+        termination_prob = 0;
+        live_walkers = nullptr;
+        std::fill(live_vertices, live_vertices + 3, nullptr);
+        terminated_walk_step = 0;
+        dead_end_mode = DeadEndStop;
+        output_buffer_num = 1;
         rands = nullptr;
     }
 
@@ -104,14 +167,70 @@ public:
         if (walker_start_vertices != nullptr) {
             wkrm.dealloc_walker_array(walker_start_vertices);
         }
+        if (walker_states != nullptr) {
+            wkrm.dealloc_walker_array(walker_states);
+        }
+        if (live_walkers != nullptr) {
+            wkrm.dealloc_walker_array(live_walkers);
+        }
+        for (auto vertices : live_vertices) {
+            if (vertices != nullptr) {
+                wkrm.dealloc_walker_array(vertices);
+            }
+        }
     }
 
     // Set node2vec, but don't prepare or initialize related data structure now.
     void set_node2vec(real_t _p, real_t _q) {
         is_node2vec = true;
+        n2v_p = _p;
+        n2v_q = _q;
         wm.set_node2vec(_p, _q);
     }
 
+    /**
+     * Let node2vec sample the low-degree partitions that pay off with
+     * second-order alias tables, which take at most mem bytes.
+     */
+    void set_second_order_alias_mem(size_t mem) {
+        second_order_alias_mem = mem;
+    }
+
+    /**
+     * Set the metapath of the vertex types, which the walks follow repeatedly.
+     * The vertex types of the graph must be loaded before prepare().
+     */
+    void set_metapath(const std::vector<vertex_type_t> &_metapath) {
+        CHECK(_metapath.size() != 0);
+        is_metapath = true;
+        metapath = _metapath;
+        wm.set_metapath(_metapath);
+    }
+
+    /**
+     * Set what walkers do at dead ends. With stop, the steps after a dead end
+     * are written as WalkEndVertex.
+     */
+    void set_dead_end_mode(DeadEndMode mode) {
+        dead_end_mode = mode;
+        wm.set_dead_end_mode(mode);
+    }
+
+    /**
+     * Let each walk end with the probability before each step, as random
+     * walks with restart do, so walk_len becomes the max length. The steps
+     * after the end are written as WalkEndVertex.
+     */
+    void set_termination_prob(real_t prob) {
+        CHECK(prob >= 0 && prob < 1) << "The termination probability must be in [0, 1)";
+        termination_prob = prob;
+    }
+
+    // Set how many output arrays will be allocated, which is taken into account when estimating epoch size.
+    void set_output_buffer_num(int num) {
+        output_buffer_num = num;
+    }
+
     std::string name() {
         return std::string("FlashMob solver");
     }
@@ -130,6 +249,7 @@ public:
 
         rest_walker_num = 0;
         terminated_walker_num = 0;
+        terminated_walk_step = 0;
         total_walk_time = 0;
         walk_len = 0;
         max_epoch_walker_num = 0;
@@ -144,18 +264,53 @@ public:
         if (is_node2vec) {
             graph->prepare_neighbor_query();
         }
+        if (is_metapath) {
+            CHECK(!is_node2vec) << "Metapath walks are not node2vec walks";
+            CHECK(graph->vertex_types != nullptr) << "Metapath walks need the vertex types";
+            for (auto type : metapath) {
+                CHECK(type < graph->type_num) << "Unknown vertex type in the metapath: " << (int) type;
+            }
+            graph->prepare_type_segments();
+        }
+        if (graph->temporal) {
+            CHECK(!is_node2vec && !is_metapath) << "Temporal walks are neither node2vec nor metapath walks";
+        }
 
         edge_id_t buffer_edge_num = 0;
 #pragma omp parallel for reduction (+: buffer_edge_num)
         for (int p_i = 0; p_i < graph->partition_num; p_i++) {
-            if (graph->partition_sampler_class[p_i] == ClassExclusiveBufferSampler) {
+            if (graph->partition_sampler_class[p_i] == ClassExclusiveBufferSampler || graph->partition_sampler_class[p_i] == ClassWeightedBufferSampler) {
                 for (vertex_id_t v_i = graph->partition_begin[p_i]; v_i < graph->partition_end[p_i]; v_i++) {
                     buffer_edge_num += graph->adjlists[0][v_i].degree;
                 }
             }
         }
-        size_t ht_size = is_node2vec ? graph->bf->size() : 0;
-        uint64_t temp_max_epoch_walker_num = estimate_epoch_walker(graph->v_num, graph->e_num, buffer_edge_num, _walker_num, walk_len, mtcfg.socket_num, mem_quota, ht_size);
+        size_t other_size = is_node2vec ? graph->bf->size() + graph->get_neighbor_index_size() : 0;
+        if (graph->weighted) {
+            other_size += get_weighted_graph_extra_size(graph->e_num);
+        }
+        if (has_walker_states()) {
+            // The metapath and temporal walks sample the adjacency lists without samplers
+            buffer_edge_num = 0;
+        }
+        if (is_metapath) {
+            other_size += graph->get_vertex_type_size();
+        }
+        if (graph->temporal) {
+            other_size += sizeof(edge_time_t) * graph->e_num;
+        }
+        std::vector<bool> second_order_partitions;
+        if (is_node2vec && second_order_alias_mem > 0) {
+            size_t second_order_size;
+            second_order_partitions = select_second_order_partitions(graph, n2v_p, n2v_q, second_order_alias_mem, second_order_size);
+            other_size += second_order_size;
+        }
+        int extra_walker_array_num = has_walker_states() ? 1 : 0;
+        if (termination_prob > 0) {
+            // live_walkers and live_vertices
+            extra_walker_array_num += 1 + (is_node2vec ? 3 : 2);
+        }
+        uint64_t temp_max_epoch_walker_num = estimate_epoch_walker(graph->v_num, graph->e_num, buffer_edge_num, _walker_num, walk_len, mtcfg.socket_num, mem_quota, other_size, output_buffer_num, extra_walker_array_num);
         std::stringstream epoch_walker_ss;
         int epoch_num = 0;
         for (uint64_t w_i = 0; w_i < _walker_num;) {
@@ -171,12 +326,30 @@ public:
         #endif
         max_epoch_walker_num = temp_max_epoch_walker_num;
 
-        sm.init(graph, temp_max_epoch_walker_num, &profiler);
+        if (!has_walker_states()) {
+            sm.init(graph, temp_max_epoch_walker_num, &profiler);
+        }
+        if (!second_order_partitions.empty()) {
+            sm.init_second_order(second_order_partitions, n2v_p, n2v_q);
+        }
         wm.init(graph, &sm, &msgm, rands, &profiler);
         wkrm.init(temp_max_epoch_walker_num);
-        msgm.init(graph, &wkrm, &profiler, is_node2vec);
+        // The metapath and temporal walkers stop at WalkEndVertex, which needs the extra bucket
+        msgm.init(graph, &wkrm, &profiler, is_node2vec || has_walker_states(), has_walker_states() && dead_end_mode == DeadEndStop);
+        if (has_walker_states()) {
+            walker_states = wkrm.alloc_walker_array<walker_state_t>();
+        }
+        if (termination_prob > 0) {
+            live_walkers = wkrm.alloc_walker_array<walker_id_t>();
+            for (int i = 0; i < (is_node2vec ? 3 : 2); i++) {
+                live_vertices[i] = wkrm.alloc_walker_array<vertex_id_t>();
+            }
+        }
         init_walks(temp_max_epoch_walker_num, _walk_len);
 
+        if (mtcfg.hugepage_mode != HugePageOff) {
+            LOG(WARNING) << block_mid_str() << "Memory backed by huge pages: " << size_string(get_huge_page_mem());
+        }
         LOG(WARNING) << block_end_str() << "Solver initialized in " << timer.duration() << " seconds";
     }
 
@@ -190,6 +363,66 @@ public:
         init_walks(epoch_walker_num, _walk_len);
 
         auto *start_vertices = get_walker_start_vertices(_walker_num);
+        if (has_walker_states()) {
+            // The walks start from the first type of the metapath, or from time 0
+            wkrm.process_walkers([&](walker_id_t w_i) {
+                walker_states[w_i] = 0;
+            }, _walker_num);
+        }
+
+        if (termination_prob > 0) {
+            walk_terminating(start_vertices, _walker_num, _walk_len, timer);
+        } else {
+            walk_lock_step(start_vertices, _walker_num, _walk_len, timer);
+        }
+
+        // Shuffle the paths to correct order
+        #if PROFILE_IF_BRIEF
+        Timer shuffle_timer;
+        #endif
+        if (termination_prob > 0 || (dead_end_mode == DeadEndStop && (graph->has_dead_end() || has_walker_states()))) {
+            // The walkers stayed at the dead ends, or moved to WalkEndVertex
+            // on metapaths and temporal graphs, so cut the paths there.
+            // The terminating walks end at WalkEndVertex as well.
+            const vertex_id_t cut_begin = dead_end_mode == DeadEndStop ? graph->dead_end_begin : WalkEndVertex;
+            wkrm.process_walkers([&](walker_id_t w_i) {
+                vertex_id_t *path = output + (uint64_t)w_i * _walk_len;
+                int step_i = 0;
+                while (step_i < _walk_len) {
+                    vertex_id_t v = walks[step_i][w_i];
+                    path[step_i++] = v;
+                    if (v >= cut_begin) {
+                        break;
+                    }
+                }
+                for (; step_i < _walk_len; step_i++) {
+                    path[step_i] = WalkEndVertex;
+                }
+            }, _walker_num);
+        } else {
+            wkrm.process_walkers([&](walker_id_t w_i) {
+                for (int step_i = 0; step_i < _walk_len; step_i++) {
+                    output[(uint64_t)w_i * _walk_len + step_i] = walks[step_i][w_i];
+                }
+            }, _walker_num);
+        }
+        #if PROFILE_IF_BRIEF
+        profiler.sub_step_sync_times["5-Path"] += shuffle_timer.duration();
+        #endif
+
+        #if PROFILE_IF_DETAIL
+        LOG(INFO) << "final shuffle: " << shuffle_timer.duration() << " (" << timer.duration() << ") seconds, " << get_step_cost(shuffle_timer.duration(), (uint64_t) _walker_num * _walk_len, mtcfg.thread_num) << " ns/step";
+        #endif
+
+        CHECK(rest_walker_num >= epoch_walker_num);
+        terminated_walker_num += epoch_walker_num;
+        rest_walker_num -= epoch_walker_num;
+        total_walk_time += timer.duration();
+    }
+
+private:
+    // All walkers walk in lock step, and walks[l_i][w_i] is the l_i-th vertex of walker w_i
+    void walk_lock_step(vertex_id_t *start_vertices, walker_id_t _walker_num, int _walk_len, Timer &timer) {
         vertex_id_t *current_vertices = walks[0];
         vertex_id_t *previous_vertices = nullptr;
 
@@ -202,7 +435,6 @@ public:
         profiler.sub_step_sync_times["0-Init"] += timer.duration();
         #endif
 
-        // All walkers walk in lock step
         for (int l_i = 1; l_i < _walk_len; l_i++) {
             bool node2vec_walk = (is_node2vec && l_i != 0);
 
@@ -211,12 +443,12 @@ public:
             LOG(INFO) << "step " << l_i << ":";
             #endif
 
-            msgm.shuffle(current_vertices, node2vec_walk ? previous_vertices : nullptr, _walker_num);
+            msgm.shuffle(current_vertices, node2vec_walk ? previous_vertices : walker_states, _walker_num);
 
             wm.walk(node2vec_walk, _walker_num);
 
             vertex_id_t *next_vertices = walks[l_i];
-            msgm.update(next_vertices, _walker_num);
+            msgm.update(next_vertices, _walker_num, walker_states);
 
             previous_vertices = current_vertices;
             current_vertices = next_vertices;
@@ -224,32 +456,87 @@ public:
             LOG(INFO) << "\tstep time: " << step_timer.duration() << "(" << timer.duration() << ") seconds, " << get_step_cost(step_timer.duration(), _walker_num, mtcfg.thread_num) << " ns/step";
             #endif
         }
+        terminated_walk_step += (uint64_t) _walker_num * _walk_len;
+    }
 
-        // Shuffle the paths to correct order
-        #if PROFILE_IF_BRIEF
-        Timer shuffle_timer;
-        #endif
+    /**
+     * The walks end with termination_prob before each step, at dead ends in
+     * the stop mode, or at WalkEndVertex. Before each step, the finished
+     * walkers are dropped from the message tasks, and the live ones are
+     * compacted to the front of the tasks, so that the cost of the steps
+     * falls with the live walkers. The walkers are identified by
+     * live_walkers, and the vertices they reach are written to walks.
+     */
+    void walk_terminating(vertex_id_t *start_vertices, walker_id_t _walker_num, int _walk_len, Timer &timer) {
+        vertex_id_t *current_vertices = live_vertices[0];
+        vertex_id_t *next_vertices = live_vertices[1];
+        vertex_id_t *previous_vertices = live_vertices[2];
         wkrm.process_walkers([&](walker_id_t w_i) {
-            for (int step_i = 0; step_i < _walk_len; step_i++) {
-                output[(uint64_t)w_i * _walk_len + step_i] = walks[step_i][w_i];
-            }
+            live_walkers[w_i] = w_i;
+            current_vertices[w_i] = start_vertices[w_i];
         }, _walker_num);
+        msgm.set_active_messages(_walker_num);
+
         #if PROFILE_IF_BRIEF
-        profiler.sub_step_sync_times["5-Path"] += shuffle_timer.duration();
+        profiler.sub_step_sync_times["0-Init"] += timer.duration();
         #endif
 
-        #if PROFILE_IF_DETAIL
-        LOG(INFO) << "final shuffle: " << shuffle_timer.duration() << " (" << timer.duration() << ") seconds, " << get_step_cost(shuffle_timer.duration(), (uint64_t) _walker_num * _walk_len, mtcfg.thread_num) << " ns/step";
-        #endif
+        const vertex_id_t end_begin = dead_end_mode == DeadEndStop ? graph->dead_end_begin : WalkEndVertex;
+        // Each round writes the vertices of the live walkers to the path, and
+        // the last round only writes
+        for (int l_i = 1; l_i <= _walk_len; l_i++) {
+            #if PROFILE_IF_DETAIL
+            Timer step_timer;
+            LOG(INFO) << "step " << l_i << ":";
+            #endif
 
-        CHECK(rest_walker_num >= epoch_walker_num);
-        terminated_walker_num += epoch_walker_num;
-        rest_walker_num -= epoch_walker_num;
-        total_walk_time += timer.duration();
+            vertex_id_t *path_step = walks[l_i - 1];
+            vertex_id_t *end_step = l_i < _walk_len ? walks[l_i] : nullptr;
+            terminated_walk_step += msgm.active_message_num;
+            walker_id_t live_num = msgm.compact([&] (walker_id_t m_i, walker_id_t live_i) {
+                walker_id_t w_i = live_walkers[m_i];
+                vertex_id_t v = current_vertices[m_i];
+                path_step[w_i] = v;
+                if (end_step == nullptr) {
+                    return false;
+                }
+                if (v >= end_begin || rands[omp_get_thread_num()]->gen_float(1.0) < termination_prob) {
+                    end_step[w_i] = WalkEndVertex;
+                    return false;
+                }
+                live_walkers[live_i] = w_i;
+                current_vertices[live_i] = v;
+                if (previous_vertices != nullptr) {
+                    previous_vertices[live_i] = previous_vertices[m_i];
+                }
+                if (walker_states != nullptr) {
+                    walker_states[live_i] = walker_states[m_i];
+                }
+                return true;
+            });
+            if (live_num == 0) {
+                break;
+            }
+
+            msgm.shuffle(current_vertices, is_node2vec ? (l_i == 1 ? nullptr : previous_vertices) : walker_states);
+
+            wm.walk(is_node2vec, live_num);
+
+            msgm.update(next_vertices, live_num, walker_states);
+
+            if (is_node2vec) {
+                std::swap(previous_vertices, current_vertices);
+            }
+            std::swap(current_vertices, next_vertices);
+            #if PROFILE_IF_DETAIL
+            LOG(INFO) << "\tstep time: " << step_timer.duration() << "(" << timer.duration() << ") seconds, " << get_step_cost(step_timer.duration(), live_num, mtcfg.thread_num) << " ns/step";
+            #endif
+        }
     }
 
+public:
+
     void walk_info() {
-        uint64_t terminated_walk_step = (uint64_t) walk_len * terminated_walker_num;
         #if PROFILE_IF_BRIEF
         // LOG(INFO) << "edges sampled vs edges used: " << (double) profiler.total_refilled_edge_num / profiler.total_used_edge_num;
         // LOG(INFO) << "edges buffer size vs edges used: " << (double) profiler.edge_buffer_data_size / profiler.total_used_edge_num;
@@ -310,6 +597,10 @@ public:
                 pt_ss << "\t" << "UDS";
             } else if (profiler.partition_sampler_class[p_i] == ClassSimilarDegreeDirectSampler) {
                 pt_ss << "\t" << "SDS";
+            } else if (profiler.partition_sampler_class[p_i] == ClassAliasSampler) {
+                pt_ss << "\t" << "AS";
+            } else if (profiler.partition_sampler_class[p_i] == ClassWeightedBufferSampler) {
+                pt_ss << "\t" << "WPS";
             } else {
                 pt_ss << "\t" << "DS";
             }
@@ -348,24 +639,92 @@ public:
     bool has_next_walk() {
         return (rest_walker_num != 0);
     }
+
+    Graph* get_graph() {
+        return graph;
+    }
+
+    MultiThreadConfig get_mtcfg() {
+        return mtcfg;
+    }
+
+    // Get the range of walkers in the output arrays that resides on each socket
+    void get_socket_walker_ranges(std::vector<walker_id_t> &begin, std::vector<walker_id_t> &end) {
+        begin = wkrm.socket_walker_begin;
+        end = wkrm.socket_walker_end;
+    }
+
+    /**
+     * Walk all the walkers epoch by epoch, and pass the paths of each epoch
+     * to consumer in place. The consumer is called in the calling thread
+     * after each epoch, and the next epoch starts after it returns.
+     */
+    void walk_epochs(uint64_t walker_num, int _walk_len, uint64_t mem_quota, WalkConsumer consumer) {
+        set_output_buffer_num(1);
+        prepare(walker_num, _walk_len, mem_quota);
+        vertex_id_t *output = alloc_output_array();
+        EpochWalkView view;
+        view.epoch = 0;
+        view.walk_len = _walk_len;
+        while (has_next_walk()) {
+            view.first_walker = terminated_walker_num;
+            walk(output, view.walker_num);
+            view.sockets.clear();
+            for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+                walker_id_t begin = std::min(wkrm.socket_walker_begin[s_i], view.walker_num);
+                walker_id_t end = std::min(wkrm.socket_walker_end[s_i], view.walker_num);
+                if (begin < end) {
+                    view.sockets.push_back({s_i, output + (uint64_t) begin * _walk_len, begin, end - begin});
+                }
+            }
+            consumer(view);
+            view.epoch++;
+        }
+        CHECK(terminated_walker_num == walker_num);
+        walk_info();
+        dealloc_output_array(output);
+    }
 };
 
-void walk(FMobSolver * solver, uint64_t walker_num, int walk_len, uint64_t mem_quota) {
+/**
+ * Walk all the walkers epoch by epoch. If output_cfg is given, the paths of
+ * each epoch are written by a WalkWriter in background, while the next epoch
+ * walks into the other output buffer.
+ */
+void walk(FMobSolver * solver, uint64_t walker_num, int walk_len, uint64_t mem_quota, const WalkOutputConfig* output_cfg = nullptr) {
     LOG(WARNING) << split_line_string();
 
+    solver->set_output_buffer_num(output_cfg == nullptr ? 1 : 2);
     solver->prepare(walker_num, walk_len, mem_quota);
     // LOG(WARNING) << "Sampler: " << solver->name();
     vertex_id_t *walks = solver->alloc_output_array();
+    vertex_id_t *next_walks = nullptr;
+    std::unique_ptr<WalkWriter> writer;
+    if (output_cfg != nullptr) {
+        next_walks = solver->alloc_output_array();
+        std::vector<walker_id_t> socket_walker_begin;
+        std::vector<walker_id_t> socket_walker_end;
+        solver->get_socket_walker_ranges(socket_walker_begin, socket_walker_end);
+        writer.reset(new WalkWriter(solver->get_mtcfg(), *output_cfg, walk_len, socket_walker_begin, socket_walker_end, walks, next_walks, solver->get_graph()->id2name, solver->get_graph()->v_num));
+    }
 
     System::profile("sample", [&]() {
         uint64_t terminated_walker_num = 0;
         while (solver->has_next_walk()) {
             walker_id_t epoch_walker_num;
-            solver->walk(walks, epoch_walker_num);
+            vertex_id_t *epoch_walks = writer != nullptr ? writer->get_buffer() : walks;
+            solver->walk(epoch_walks, epoch_walker_num);
+            if (writer != nullptr) {
+                writer->submit(epoch_walker_num);
+            }
             terminated_walker_num += epoch_walker_num;
         }
         CHECK(terminated_walker_num == walker_num);
         solver->walk_info();
     });
+    if (writer != nullptr) {
+        writer->finish();
+        solver->dealloc_output_array(next_walks);
+    }
     solver->dealloc_output_array(walks);
 }
@@ -33,10 +33,24 @@ class WalkManager {
     real_t div_q;
     bool is_node2vec;
 
+    // Variables for metapath walks
+    std::vector<vertex_type_t> metapath;
+    // The vertices of the first type of the metapath, where the walkers start
+    std::vector<vertex_id_t> metapath_start_vertices;
+    bool is_metapath;
+
+    // The walks on temporal graphs are time-respecting
+    bool is_temporal;
+
+    DeadEndMode dead_end_mode;
+
 public:
     WalkManager (MultiThreadConfig _mtcfg) {
         mtcfg = _mtcfg;
         is_node2vec = false;
+        is_metapath = false;
+        is_temporal = false;
+        dead_end_mode = DeadEndStop;
     }
 
     void init(Graph *_graph, SamplerManager *_sm, MessageManager *_msgm, default_rand_t** _rands, SampleProfiler *_profiler) {
@@ -45,6 +59,16 @@ public:
         msgm = _msgm;
         rands = _rands;
         profiler = _profiler;
+        is_temporal = graph->temporal;
+        if (is_metapath) {
+            metapath_start_vertices.clear();
+            for (vertex_id_t v_i = 0; v_i < graph->v_num; v_i++) {
+                if (graph->vertex_types[v_i] == metapath[0]) {
+                    metapath_start_vertices.push_back(v_i);
+                }
+            }
+            CHECK(metapath_start_vertices.size() != 0) << "No vertex has the first type of the metapath";
+        }
     }
 
     /**
@@ -62,6 +86,63 @@ public:
         is_node2vec = true;
     }
 
+    /**
+     * set_metapath: Mark the walk to follow the metapath, which is repeated
+     * until the walk ends, e.g. 0,1 for 0-1-0-1-... The walkers start from
+     * the vertices of the first type.
+     */
+    void set_metapath(const std::vector<vertex_type_t> &_metapath) {
+        metapath = _metapath;
+        is_metapath = true;
+    }
+
+    // Draw a vertex uniformly at random, or from the first type of the metapath
+    vertex_id_t gen_start_vertex(default_rand_t *rd) {
+        if (is_metapath) {
+            return metapath_start_vertices[rd->gen(metapath_start_vertices.size())];
+        }
+        return rd->gen(graph->v_num);
+    }
+
+    /**
+     * set_dead_end_mode: Decide what walkers do at dead ends. Only restart needs
+     * work, while the walkers of stop and self-loop stay where they are, and the
+     * paths of stop are cut when they are written out.
+     */
+    void set_dead_end_mode(DeadEndMode mode) {
+        dead_end_mode = mode;
+    }
+
+    /**
+     * restart_walkers: The walkers at dead ends of the task jump to vertices
+     * drawn the same way as the start vertices. The metapath and temporal
+     * walkers start over from state 0, i.e. the first type or the earliest time.
+     */
+    void restart_walkers(MessageTask *mt) {
+        auto *rd = this->rands[omp_get_thread_num()];
+        const vertex_id_t p_i = mt->partition_num;
+        const bool reset_state = is_metapath || is_temporal;
+        for (walker_id_t m_i = mt->shuffled_message_begin[p_i]; m_i < mt->shuffled_message_end[p_i]; m_i++) {
+            mt->shuffled_messages[m_i] = gen_start_vertex(rd);
+            if (reset_state) {
+                mt->shuffled_states[m_i] = 0;
+            }
+        }
+    }
+
+    /**
+     * stop_walker: A metapath or temporal walker without valid edges stops
+     * at WalkEndVertex, restarts, or stays, as it does at a dead end.
+     */
+    void stop_walker(vertex_id_t &vertex, walker_state_t &state, default_rand_t *rd) {
+        if (dead_end_mode == DeadEndStop) {
+            vertex = WalkEndVertex;
+        } else if (dead_end_mode == DeadEndRestart) {
+            vertex = gen_start_vertex(rd);
+            state = 0;
+        }
+    }
+
     /**
      * walk_message: Do static walks for a group of walkers that are currently at the same partition.
      */
@@ -93,30 +174,135 @@ public:
         return prob <= val;
     }
 
+    /**
+     * node2vec_alias_walk_message: Do node2vec walks for a group of walkers with the second-order alias tables of
+     * their partition. The walkers whose previous vertices are not neighbors of their current ones, e.g. on directed
+     * graphs, fall back to rejection sampling.
+     */
+    template<typename sampler_t>
+    void node2vec_alias_walk_message(sampler_t *sampler, SecondOrderAliasSampler *second_order_sampler, vertex_id_t *message_begin, vertex_id_t *state_begin, walker_id_t walker_num, int socket) {
+        auto *rd = this->rands[omp_get_thread_num()];
+        for (walker_id_t w_i = 0; w_i < walker_num; w_i++) {
+            vertex_id_t &current_vertex = message_begin[w_i];
+            vertex_id_t previous_vertex = state_begin[w_i];
+            vertex_id_t next_vertex = second_order_sampler->sample(previous_vertex, current_vertex, rd);
+            if (next_vertex == MaxVertexId) {
+                real_t prob;
+                do {
+                    next_vertex = sampler->sample(current_vertex, rd);
+                    prob = rd->gen_float(n2v_upperbound);
+                } while (!node2vec_accept(previous_vertex, current_vertex, next_vertex, prob, socket));
+            }
+            assert(next_vertex < graph->v_num);
+            current_vertex = next_vertex;
+        }
+    }
+
     /**
      * node2vec_walk_message: Do node2vec walks for a group of walkers that are currently at the same partition.
      *
-     * TODO: Large amount of random memory access dependency found here. Mitigating this will greatly improve the
-     * performance.
+     * The neighbor queries of the walkers are random memory accesses that depend on the sampled edges. They are
+     * software pipelined: the index of the previous vertex of the walker w_i + 2 * Node2vecPrefetchDistance is
+     * prefetched, and the first edge of the walker w_i + Node2vecPrefetchDistance is sampled with its query
+     * prefetched, while the walker w_i finishes its rejection sampling. So the cache misses of the walkers overlap.
+     *
+     * The partitions with second-order alias tables are sampled from the tables instead.
      */
     template<typename sampler_t>
-    void node2vec_walk_message(sampler_t *sampler, vertex_id_t *message_begin, vertex_id_t *state_begin, walker_id_t walker_num, int socket) {
+    void node2vec_walk_message(sampler_t *sampler, SecondOrderAliasSampler *second_order_sampler, vertex_id_t *message_begin, vertex_id_t *state_begin, walker_id_t walker_num, int socket) {
+        if (second_order_sampler != nullptr) {
+            node2vec_alias_walk_message(sampler, second_order_sampler, message_begin, state_begin, walker_num, socket);
+            return;
+        }
         auto *rd = this->rands[omp_get_thread_num()];
+        const walker_id_t distance = Node2vecPrefetchDistance;
+        vertex_id_t sampled_vertices[Node2vecPrefetchDistance];
+        real_t sampled_probs[Node2vecPrefetchDistance];
+        auto sample_ahead = [&] (walker_id_t w_i) {
+            vertex_id_t previous_vertex = state_begin[w_i];
+            vertex_id_t next_vertex = sampler->sample(message_begin[w_i], rd);
+            real_t prob = rd->gen_float(n2v_upperbound);
+            if (previous_vertex != next_vertex && prob > n2v_min_1_q) {
+                graph->prefetch_neighbor(previous_vertex, next_vertex, socket);
+            }
+            sampled_vertices[w_i % distance] = next_vertex;
+            sampled_probs[w_i % distance] = prob;
+        };
+        for (walker_id_t w_i = 0; w_i < std::min(walker_num, distance * 2); w_i++) {
+            graph->prefetch_neighbor_index(state_begin[w_i], socket);
+        }
+        for (walker_id_t w_i = 0; w_i < std::min(walker_num, distance); w_i++) {
+            sample_ahead(w_i);
+        }
         for (walker_id_t w_i = 0; w_i < walker_num; w_i++) {
             vertex_id_t &current_vertex = message_begin[w_i];
             vertex_id_t previous_vertex = state_begin[w_i];
-            vertex_id_t next_vertex;
-            real_t prob;
-            do {
+            vertex_id_t next_vertex = sampled_vertices[w_i % distance];
+            real_t prob = sampled_probs[w_i % distance];
+            if (w_i + distance * 2 < walker_num) {
+                graph->prefetch_neighbor_index(state_begin[w_i + distance * 2], socket);
+            }
+            if (w_i + distance < walker_num) {
+                sample_ahead(w_i + distance);
+            }
+            while (!node2vec_accept(previous_vertex, current_vertex, next_vertex, prob, socket)) {
                 next_vertex = sampler->sample(current_vertex, rd);
-                assert(next_vertex < graph->v_num);
                 prob = rd->gen_float(n2v_upperbound);
-            } while (!node2vec_accept(previous_vertex, current_vertex, next_vertex, prob, socket));
+            }
+            assert(next_vertex < graph->v_num);
             assert(current_vertex != next_vertex);
             current_vertex = next_vertex;
         }
     }
 
+    /**
+     * metapath_walk_message: Do metapath walks for a group of walkers that are
+     * currently at the same partition. The state of a walker is the position
+     * of its current vertex in the metapath, and the next vertex is drawn
+     * uniformly from the neighbors of the next type.
+     */
+    void metapath_walk_message(vertex_id_t *message_begin, walker_state_t *state_begin, walker_id_t walker_num, int socket) {
+        auto *rd = this->rands[omp_get_thread_num()];
+        const walker_state_t metapath_len = metapath.size();
+        for (walker_id_t w_i = 0; w_i < walker_num; w_i++) {
+            vertex_id_t &current_vertex = message_begin[w_i];
+            walker_state_t &state = state_begin[w_i];
+            walker_state_t next_state = state + 1 == metapath_len ? 0 : state + 1;
+            AdjList adj = graph->get_type_adjlist(current_vertex, metapath[next_state], socket);
+            if (adj.degree != 0) {
+                current_vertex = adj.begin[rd->gen(adj.degree)].neighbor;
+                state = next_state;
+            } else {
+                stop_walker(current_vertex, state, rd);
+            }
+            assert(current_vertex < graph->v_num || current_vertex == WalkEndVertex);
+        }
+    }
+
+    /**
+     * temporal_walk_message: Do temporal walks for a group of walkers that are
+     * currently at the same partition. The state of a walker is the time of
+     * its last edge, and the next edge is drawn uniformly from the edges no
+     * earlier than that.
+     */
+    void temporal_walk_message(vertex_id_t *message_begin, walker_state_t *state_begin, walker_id_t walker_num, int socket) {
+        auto *rd = this->rands[omp_get_thread_num()];
+        for (walker_id_t w_i = 0; w_i < walker_num; w_i++) {
+            vertex_id_t &current_vertex = message_begin[w_i];
+            walker_state_t &time = state_begin[w_i];
+            const AdjList &adj = graph->adjlists[socket][current_vertex];
+            const edge_time_t* times = graph->get_edge_times(current_vertex, socket);
+            vertex_id_t e_i = TemporalSampler::sample(times, adj.degree, time, rd);
+            if (e_i != adj.degree) {
+                current_vertex = adj.begin[e_i].neighbor;
+                time = times[e_i];
+            } else {
+                stop_walker(current_vertex, time, rd);
+            }
+            assert(current_vertex < graph->v_num || current_vertex == WalkEndVertex);
+        }
+    }
+
     /**
      * walk_message_dispatch: Find out correct sampler class for the static walk task.
      */
@@ -130,6 +316,10 @@ public:
             walk_message(static_cast<UniformDegreeDirectSampler*>(sampler), message_begin, message_end);
         } else if (sampler->sampler_class == ClassSimilarDegreeDirectSampler) {
             walk_message(static_cast<SimilarDegreeDirectSampler*>(sampler), message_begin, message_end);
+        } else if (sampler->sampler_class == ClassAliasSampler) {
+            walk_message(static_cast<AliasSampler*>(sampler), message_begin, message_end);
+        } else if (sampler->sampler_class == ClassWeightedBufferSampler) {
+            walk_message(static_cast<WeightedBufferSampler*>(sampler), message_begin, message_end);
         } else {
             CHECK(false);
         }
@@ -141,14 +331,19 @@ public:
     void node2vec_walk_message_dispatch(int p_i, vertex_id_t *message_begin, vertex_id_t *state_begin, walker_id_t message_num) {
         auto socket = graph->partition_socket[p_i];
         auto *sampler = sm->samplers[p_i];
+        auto *second_order_sampler = sm->second_order_samplers[p_i];
         if (sampler->sampler_class == ClassExclusiveBufferSampler) {
-            node2vec_walk_message(static_cast<ExclusiveBufferSampler*>(sampler), message_begin, state_begin, message_num, socket);
+            node2vec_walk_message(static_cast<ExclusiveBufferSampler*>(sampler), second_order_sampler, message_begin, state_begin, message_num, socket);
         } else if (sampler->sampler_class == ClassDirectSampler) {
-            node2vec_walk_message(static_cast<DirectSampler*>(sampler), message_begin, state_begin, message_num, socket);
+            node2vec_walk_message(static_cast<DirectSampler*>(sampler), second_order_sampler, message_begin, state_begin, message_num, socket);
         } else if (sampler->sampler_class == ClassUniformDegreeDirectSampler) {
-            node2vec_walk_message(static_cast<UniformDegreeDirectSampler*>(sampler), message_begin, state_begin, message_num, socket);
+            node2vec_walk_message(static_cast<UniformDegreeDirectSampler*>(sampler), second_order_sampler, message_begin, state_begin, message_num, socket);
         } else if (sampler->sampler_class == ClassSimilarDegreeDirectSampler) {
-            node2vec_walk_message(static_cast<SimilarDegreeDirectSampler*>(sampler), message_begin, state_begin, message_num, socket);
+            node2vec_walk_message(static_cast<SimilarDegreeDirectSampler*>(sampler), second_order_sampler, message_begin, state_begin, message_num, socket);
+        } else if (sampler->sampler_class == ClassAliasSampler) {
+            node2vec_walk_message(static_cast<AliasSampler*>(sampler), second_order_sampler, message_begin, state_begin, message_num, socket);
+        } else if (sampler->sampler_class == ClassWeightedBufferSampler) {
+            node2vec_walk_message(static_cast<WeightedBufferSampler*>(sampler), second_order_sampler, message_begin, state_begin, message_num, socket);
         } else {
             CHECK(false);
         }
@@ -159,7 +354,8 @@ public:
      * be node2vec, the first step is just static walk. Thus the
      * first parameter is neccessary. When do walk tasks, half threads
      * do walks from high degree partitions to low degree partitions,
-     * and the other half threads works at opposite order.
+     * and the other half threads works at opposite order. The walkers at
+     * dead ends are handled by the thread that shuffled them.
      */
     void walk(bool node2vec_walk, walker_id_t walker_num) {
         _unused(walker_num);
@@ -171,6 +367,7 @@ public:
         std::vector<int> partittion_progress(mtcfg.socket_num, 0);
         std::vector<int> hdv_partition_progress(mtcfg.socket_num, 0);
         std::vector<int> ldv_partition_progress(mtcfg.socket_num, 0);
+        const bool restart_dead_end = dead_end_mode == DeadEndRestart && graph->has_dead_end();
 
         #pragma omp parallel reduction(+: thread_time)
         {
@@ -198,11 +395,17 @@ public:
                         auto messages = mt->shuffled_messages + mt->shuffled_message_begin[p_i];
                         walker_id_t block_msg_num = mt->shuffled_message_end[p_i] - mt->shuffled_message_begin[p_i];
                         task_message_num += block_msg_num;
-                        if (!node2vec_walk) {
-                            walk_message_dispatch(p_i, messages, messages + block_msg_num);
-                        } else {
+                        if (node2vec_walk) {
                             auto states = mt->shuffled_states + mt->shuffled_message_begin[p_i];
                             node2vec_walk_message_dispatch(p_i, messages, states, block_msg_num);
+                        } else if (is_metapath) {
+                            auto states = mt->shuffled_states + mt->shuffled_message_begin[p_i];
+                            metapath_walk_message(messages, states, block_msg_num, graph->partition_socket[p_i]);
+                        } else if (is_temporal) {
+                            auto states = mt->shuffled_states + mt->shuffled_message_begin[p_i];
+                            temporal_walk_message(messages, states, block_msg_num, graph->partition_socket[p_i]);
+                        } else {
+                            walk_message_dispatch(p_i, messages, messages + block_msg_num);
                         }
                         /*
                         for (walker_id_t i = 0; i < block_msg_num; i++) {
@@ -224,6 +427,9 @@ public:
                 __sync_fetch_and_add(&profiler->partition_walker_num[p_i], task_message_num);
                 #endif
             }
+            if (restart_dead_end) {
+                restart_walkers(msgm->mtasks[socket][mtcfg.socket_offset(worker_id)]);
+            }
             thread_time += thread_timer.duration();
         }
 
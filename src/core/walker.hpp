@@ -86,22 +86,31 @@ public:
 
     template<typename T>
     T * alloc_walker_array(size_t len = 1) {
-        char * array = (char *)mmap(NULL, sizeof(T) * len * max_epoch_walker_num, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-        CHECK(array!=NULL);
+        size_t size = sizeof(T) * len * max_epoch_walker_num;
+        char * array = map_pages(size, mtcfg.hugepage_mode);
         for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
             if (socket_walker_end[s_i] > socket_walker_begin[s_i]) {
                 CHECK(sizeof(T) * len * socket_walker_begin[s_i] % PageSize == 0) << std::setbase(10) << ": socket_walker_begin[" << s_i << "] " << socket_walker_begin[s_i];
-                numa_tonode_memory(array + sizeof(T) * len * socket_walker_begin[s_i], sizeof(T) * len * (socket_walker_end[s_i] - socket_walker_begin[s_i]), mtcfg.get_socket_mapping(s_i));
+                numa_tonode_pages(array, size, mtcfg.hugepage_mode, sizeof(T) * len * socket_walker_begin[s_i], sizeof(T) * len * socket_walker_end[s_i], mtcfg.get_socket_mapping(s_i));
             }
         }
-        // Initialize the array to ensure it's really allocated
-        memset(array, 0, sizeof(T) * len * max_epoch_walker_num);
+        // The array is zeroed by the kernel. Each thread touches the pages of
+        // its own walkers, so the array is faulted in with all the cores.
+        #pragma omp parallel
+        {
+            int thread_id = omp_get_thread_num();
+            int local_socket = mtcfg.socket_id(thread_id);
+            int local_thread = mtcfg.socket_offset(thread_id);
+            char* begin = array + sizeof(T) * len * thread_walker_begin[local_socket][local_thread];
+            char* end = array + sizeof(T) * len * thread_walker_end[local_socket][local_thread];
+            touch_pages(begin, end);
+        }
         return (T*)array;
     }
 
     template<typename T>
     void dealloc_walker_array(T* array, size_t len = 1) {
-        CHECK(0 == munmap(array, max_epoch_walker_num * sizeof(T) * len));
+        unmap_pages(array, sizeof(T) * len * max_epoch_walker_num, mtcfg.hugepage_mode);
     }
 
     void process_walkers(std::function<void(walker_id_t)> process, walker_id_t active_walker_num) {
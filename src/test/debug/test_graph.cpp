@@ -7,12 +7,15 @@
 #include <map>
 #include <set>
 #include <type_traits>
+#include <tuple>
 
 #include <gtest/gtest.h>
 
 #include "io.hpp"
 #include "log.hpp"
 #include "../../core/partition.hpp"
+#include "../../core/walker.hpp"
+#include "../../tools/convert.hpp"
 #include "../test.hpp"
 #include "test_graph.hpp"
 
@@ -41,11 +44,15 @@ void test_partitions(Graph* graph, int socket_num)
     for (int p_i = 1; p_i < graph->partition_num; p_i++) {
         ASSERT_EQ(graph->partition_begin[p_i], graph->partition_end[p_i - 1]);
     }
-    ASSERT_EQ(graph->partition_end.back(), graph->v_num);
-    for (vertex_id_t v_i = 0; v_i < graph->v_num; v_i++) {
+    ASSERT_EQ(graph->partition_end.back(), graph->dead_end_begin);
+    for (vertex_id_t v_i = 0; v_i < graph->dead_end_begin; v_i++) {
         int p = graph->get_vertex_partition_id(v_i); 
         ASSERT_LE(graph->partition_begin[p], v_i);
         ASSERT_LT(v_i, graph->partition_end[p]);
+        ASSERT_GT(graph->adjlists[0][v_i].degree, 0u);
+    }
+    for (vertex_id_t v_i = graph->dead_end_begin; v_i < graph->v_num; v_i++) {
+        ASSERT_EQ(graph->adjlists[0][v_i].degree, 0u);
     }
 
     ASSERT_EQ(std::accumulate(graph->socket_partition_nums.get(), graph->socket_partition_nums.get() + socket_num, 0), graph->partition_num);
@@ -62,7 +69,7 @@ void test_partitions(Graph* graph, int socket_num)
     }
 }
 
-void test_load_graph(std::vector<Edge> &_std_edges, GraphFormat graph_format, bool as_undirected, MultiThreadConfig mtcfg)
+void test_load_graph(std::vector<Edge> &_std_edges, GraphFormat graph_format, bool as_undirected, MultiThreadConfig mtcfg, bool streaming)
 {
     uint64_t mem_quota = 0; // mem_quota is not really used when UNIT_TEST is defined
     auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
@@ -75,14 +82,48 @@ void test_load_graph(std::vector<Edge> &_std_edges, GraphFormat graph_format, bo
         return walker_num;
     };
     GraphMocker graph(mtcfg);
+    graph.set_streaming(streaming);
     make_graph(test_graph_path, graph_format, as_undirected, walker_num_func, rand() % 80 + 10, mtcfg, mem_quota, false, graph);
+    if (streaming) {
+        ASSERT_EQ(graph.raw_edges.capacity(), 0u);
+    }
 
     test_edges(&graph, _std_edges, as_undirected);
 
     test_partitions(&graph, mtcfg.socket_num);
 }
 
-void test_task(GraphFormat graph_format, bool as_undirected, MultiThreadConfig mtcfg) {
+// The vertices should be sorted by degree in descending order after loading
+void test_degree_order(std::vector<Edge> &std_edges, GraphFormat graph_format, bool as_undirected, MultiThreadConfig mtcfg)
+{
+    GraphMocker graph(mtcfg);
+    graph.load(test_graph_path, graph_format, as_undirected);
+    std::map<vertex_id_t, vertex_id_t> std_degrees;
+    for (auto &e : std_edges) {
+        std_degrees[e.src]++;
+        if (as_undirected) {
+            std_degrees[e.dst]++;
+        }
+    }
+    std::vector<vertex_id_t> id2name(graph.v_num);
+    for (size_t n_i = 0; n_i < graph.name2id.size(); n_i++) {
+        if (graph.name2id[n_i] != MaxVertexId) {
+            id2name[graph.name2id[n_i]] = n_i;
+        }
+    }
+    ASSERT_EQ(graph.degree_prefix_sum[0], 0u);
+    for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+        if (v_i > 0) {
+            ASSERT_GE(graph.degrees[v_i - 1], graph.degrees[v_i]);
+        }
+        ASSERT_EQ(graph.degrees[v_i], graph.vertex_units[v_i].degree);
+        ASSERT_EQ(graph.degrees[v_i], std_degrees[id2name[graph.vertex_units[v_i].vertex]]);
+        ASSERT_EQ(graph.degree_prefix_sum[v_i + 1], graph.degree_prefix_sum[v_i] + graph.degrees[v_i]);
+    }
+    ASSERT_EQ(graph.degree_prefix_sum[graph.v_num], graph.e_num);
+}
+
+void test_task(GraphFormat graph_format, bool as_undirected, MultiThreadConfig mtcfg, bool streaming = false) {
     edge_id_t e_nums_arr[] = {3, 9, 64, 128, 1234, 6553};
     std::vector<edge_id_t> e_nums(e_nums_arr, e_nums_arr + 6);
     for (auto &e_num : e_nums_arr)
@@ -95,7 +136,8 @@ void test_task(GraphFormat graph_format, bool as_undirected, MultiThreadConfig m
         } else {
             write_text_graph(test_graph_path, edges);
         }
-        test_load_graph(edges, graph_format, as_undirected, mtcfg);
+        test_load_graph(edges, graph_format, as_undirected, mtcfg, streaming);
+        test_degree_order(edges, graph_format, as_undirected, mtcfg);
     }
     rm_test_graph_file();
     if (graph_format == BinaryGraphFormat) {
@@ -163,6 +205,996 @@ TEST(TextGraph, NUMAUndirected)
     NUMA_TEST(test_task(TextGraphFormat, true, mtcfg));
 }
 
+void test_text_parser() {
+    std::vector<Edge> std_edges;
+    std::stringstream ss;
+    ss << "# comment line 0 1\n";
+    ss << "\n";
+    for (vertex_id_t e_i = 0; e_i < 1000; e_i++) {
+        Edge e(rand() % 100000, rand() % 100000);
+        std_edges.push_back(e);
+        switch (e_i % 4) {
+            case 0: ss << e.src << " " << e.dst << "\n"; break;
+            case 1: ss << "  " << e.src << "\t" << e.dst << "\r\n"; break;
+            case 2: ss << e.src << " " << e.dst << " 17\n# " << e_i << "\n"; break;
+            default: ss << e.src << "  " << e.dst << "\n" << e.src << "\n"; break;
+        }
+    }
+    ss << "42 24";
+    std_edges.push_back(Edge(42, 24));
+    FILE *f = fopen(test_graph_path, "w");
+    fprintf(f, "%s", ss.str().c_str());
+    fclose(f);
+
+    std::vector<Edge> edges;
+    read_text_graph(test_graph_path, edges);
+    ASSERT_EQ(edges.size(), std_edges.size());
+    for (size_t e_i = 0; e_i < edges.size(); e_i++) {
+        EXPECT_EQ(edges[e_i], std_edges[e_i]);
+    }
+    rm_test_graph_file();
+}
+
+// Load the graph from shards in a directory, or matched by a glob pattern
+void test_sharded_graph(GraphFormat graph_format, bool streaming, MultiThreadConfig mtcfg)
+{
+    const char* shard_dir = "./.flashmobtest.shards";
+    const int shard_num = 3;
+    std::vector<Edge> edges;
+    gen_graph(300, 3000, edges);
+    mkdir(shard_dir, 0755);
+    std::vector<std::string> shard_paths;
+    for (int s_i = 0; s_i < shard_num; s_i++) {
+        std::vector<Edge> shard(edges.begin() + edges.size() * s_i / shard_num, edges.begin() + edges.size() * (s_i + 1) / shard_num);
+        shard_paths.push_back(std::string(shard_dir) + "/part-" + std::to_string(s_i));
+        if (graph_format == BinaryGraphFormat) {
+            std::stringstream ss;
+            write_binary_graph(shard_paths.back().c_str(), shard, ss);
+        } else {
+            write_text_graph(shard_paths.back().c_str(), shard);
+        }
+    }
+    std::vector<std::string> paths = {shard_dir, std::string(shard_dir) + "/part-*"};
+    for (auto &path : paths) {
+        std::vector<std::string> shards;
+        get_graph_shard_paths(path.c_str(), shards);
+        ASSERT_TRUE(shards == shard_paths);
+
+        uint64_t mem_quota = 0;
+        auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+            return (uint64_t) edge_num;
+        };
+        GraphMocker graph(mtcfg);
+        graph.set_streaming(streaming);
+        make_graph(path.c_str(), graph_format, true, walker_num_func, 10, mtcfg, mem_quota, false, graph);
+        test_edges(&graph, edges, true);
+    }
+    for (auto &shard : shard_paths) {
+        std::remove(shard.c_str());
+        std::remove(get_info_graph_path(shard).c_str());
+    }
+    rmdir(shard_dir);
+}
+
+// The vertices without out-edges are kept out of the partitions
+void test_dead_end_graph(bool streaming, MultiThreadConfig mtcfg)
+{
+    const vertex_id_t dead_end_num = 20;
+    std::vector<Edge> edges;
+    gen_dead_end_graph(200, dead_end_num, 2000, edges);
+    write_text_graph(test_graph_path, edges);
+
+    uint64_t mem_quota = 0;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num;
+    };
+    GraphMocker graph(mtcfg);
+    graph.set_streaming(streaming);
+    make_graph(test_graph_path, TextGraphFormat, false, walker_num_func, 10, mtcfg, mem_quota, false, graph);
+    ASSERT_EQ(graph.v_num - graph.dead_end_begin, dead_end_num);
+    for (vertex_id_t v_i = graph.dead_end_begin; v_i < graph.v_num; v_i++) {
+        ASSERT_GE(graph.id2name[v_i], 200u);
+    }
+    test_edges(&graph, edges, false);
+    test_partitions(&graph, mtcfg.socket_num);
+    rm_test_graph_file();
+}
+
+TEST(TextGraph, SingleThreadDeadEnds)
+{
+    SINGLE_THREAD_TEST(test_dead_end_graph(false, mtcfg));
+}
+
+TEST(TextGraph, MultiThreadStreamingDeadEnds)
+{
+    MULTI_THREAD_TEST(test_dead_end_graph(true, mtcfg));
+}
+
+// Self-loops and duplicate edges are removed while loading
+void test_clean_edges(bool as_undirected, MultiThreadConfig mtcfg)
+{
+    std::vector<Edge> edges;
+    gen_graph(200, 2000, edges);
+    for (int i = 0; i < 500; i++) {
+        Edge e = edges[rand() % edges.size()];
+        if (rand() % 2 == 0) {
+            e.transpose();
+        }
+        edges.push_back(e);
+        vertex_id_t v = rand() % 220;
+        edges.push_back(Edge(v, v));
+    }
+    write_text_graph(test_graph_path, edges);
+
+    std::set<std::pair<vertex_id_t, vertex_id_t> > edge_set;
+    for (auto e : edges) {
+        if (e.src != e.dst) {
+            edge_set.insert(std::make_pair(e.src, e.dst));
+            if (as_undirected) {
+                edge_set.insert(std::make_pair(e.dst, e.src));
+            }
+        }
+    }
+    std::vector<Edge> std_edges;
+    for (auto &e : edge_set) {
+        std_edges.push_back(Edge(e.first, e.second));
+    }
+
+    uint64_t mem_quota = 0;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num;
+    };
+    GraphMocker graph(mtcfg);
+    graph.set_clean_edges(true);
+    make_graph(test_graph_path, TextGraphFormat, as_undirected, walker_num_func, 10, mtcfg, mem_quota, false, graph);
+    ASSERT_EQ(graph.e_num, std_edges.size());
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_name(graph_edges);
+    compare_edges(std_edges, graph_edges);
+    test_partitions(&graph, mtcfg.socket_num);
+    rm_test_graph_file();
+}
+
+TEST(TextGraph, SingleThreadCleanDirected)
+{
+    SINGLE_THREAD_TEST(test_clean_edges(false, mtcfg));
+}
+
+TEST(TextGraph, SingleThreadCleanUndirected)
+{
+    SINGLE_THREAD_TEST(test_clean_edges(true, mtcfg));
+}
+
+TEST(TextGraph, MultiThreadCleanUndirected)
+{
+    MULTI_THREAD_TEST(test_clean_edges(true, mtcfg));
+}
+
+TEST(BinaryGraph, MultiThreadShards)
+{
+    MULTI_THREAD_TEST(test_sharded_graph(BinaryGraphFormat, false, mtcfg));
+}
+
+TEST(TextGraph, SingleThreadShards)
+{
+    SINGLE_THREAD_TEST(test_sharded_graph(TextGraphFormat, false, mtcfg));
+}
+
+TEST(TextGraph, MultiThreadStreamingShards)
+{
+    MULTI_THREAD_TEST(test_sharded_graph(TextGraphFormat, true, mtcfg));
+}
+
+TEST(BinaryGraph, MultiThreadStreaming)
+{
+    MULTI_THREAD_TEST(test_task(BinaryGraphFormat, true, mtcfg, true));
+}
+
+TEST(TextGraph, SingleThreadStreaming)
+{
+    SINGLE_THREAD_TEST(test_task(TextGraphFormat, false, mtcfg, true));
+}
+
+TEST(TextGraph, MultiThreadStreaming)
+{
+    MULTI_THREAD_TEST(test_task(TextGraphFormat, true, mtcfg, true));
+}
+
+TEST(TextGraph, SingleThreadParser)
+{
+    SINGLE_THREAD_TEST(test_text_parser());
+}
+
+TEST(TextGraph, MultiThreadParser)
+{
+    MULTI_THREAD_TEST(test_text_parser());
+}
+
+void test_snapshot(bool as_undirected, MultiThreadConfig mtcfg)
+{
+    uint64_t mem_quota = 0;
+    int walk_len = 40;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num * 2;
+    };
+    std::vector<Edge> edges;
+    gen_graph(150, 1234, edges);
+    write_text_graph(test_graph_path, edges);
+    std::string snapshot_path = get_graph_snapshot_path(test_graph_path, TextGraphFormat, as_undirected, false, false, false, mtcfg);
+    std::remove(snapshot_path.c_str());
+
+    GraphMocker graph(mtcfg);
+    make_graph(test_graph_path, TextGraphFormat, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, graph, true);
+    ASSERT_EQ(access(snapshot_path.c_str(), R_OK), 0);
+
+    GraphMocker snapshot_graph(mtcfg);
+    ASSERT_TRUE(load_graph_snapshot(snapshot_path.c_str(), test_graph_path, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, snapshot_graph));
+    test_edges(&snapshot_graph, edges, as_undirected);
+    test_partitions(&snapshot_graph, mtcfg.socket_num);
+    ASSERT_EQ(snapshot_graph.v_num, graph.v_num);
+    ASSERT_EQ(snapshot_graph.e_num, graph.e_num);
+    ASSERT_EQ(snapshot_graph.partition_num, graph.partition_num);
+    ASSERT_EQ(snapshot_graph.partition_edge_num, graph.partition_edge_num);
+    ASSERT_EQ(snapshot_graph.partition_sampler_class, graph.partition_sampler_class);
+    for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+        ASSERT_EQ(snapshot_graph.id2name[v_i], graph.id2name[v_i]);
+    }
+
+    // A snapshot made under another configuration must not be used
+    GraphMocker other_graph(mtcfg);
+    ASSERT_FALSE(load_graph_snapshot(snapshot_path.c_str(), test_graph_path, as_undirected, walker_num_func, walk_len + 1, mtcfg, mem_quota, false, other_graph));
+
+    std::remove(snapshot_path.c_str());
+    rm_test_graph_file();
+}
+
+TEST(GraphSnapshot, SingleThread)
+{
+    SINGLE_THREAD_TEST(test_snapshot(true, mtcfg));
+}
+
+TEST(GraphSnapshot, MultiThreadDirected)
+{
+    MULTI_THREAD_TEST(test_snapshot(false, mtcfg));
+}
+
+TEST(GraphSnapshot, NUMA)
+{
+    NUMA_TEST(test_snapshot(true, mtcfg));
+}
+
+void test_weighted_text_parser() {
+    std::stringstream ss;
+    ss << "# comment line 0 1 2\n";
+    ss << "0 1 0.5\n";
+    ss << "  2\t3\t1e-1\r\n";
+    ss << "4 5 7\n";
+    ss << "\n";
+    ss << "6 7 .25 extra\n";
+    ss << "8 9 0";
+    FILE *f = fopen(test_graph_path, "w");
+    fprintf(f, "%s", ss.str().c_str());
+    fclose(f);
+
+    std::vector<WeightedEdge> edges;
+    read_text_graph(std::vector<std::string>(1, test_graph_path), edges);
+    ASSERT_EQ(edges.size(), 5u);
+    real_t std_weights[] = {0.5, 0.1, 7, 0.25, 0};
+    for (size_t e_i = 0; e_i < edges.size(); e_i++) {
+        EXPECT_EQ(edges[e_i].src, e_i * 2);
+        EXPECT_EQ(edges[e_i].dst, e_i * 2 + 1);
+        EXPECT_FLOAT_EQ(edges[e_i].weight, std_weights[e_i]);
+    }
+    rm_test_graph_file();
+}
+
+TEST(WeightedGraph, SingleThreadParser)
+{
+    SINGLE_THREAD_TEST(test_weighted_text_parser());
+}
+
+/**
+ * Load a weighted graph, and check the weights of the edges, as well as the
+ * weights loaded from the snapshot. With clean_edges, the weights of the
+ * duplicate edges are summed up.
+ */
+void test_weighted_graph(GraphFormat graph_format, bool as_undirected, bool clean_edges, MultiThreadConfig mtcfg)
+{
+    std::vector<Edge> edges;
+    gen_graph(300, 3000, edges);
+    std::vector<WeightedEdge> weighted_edges;
+    for (auto &e : edges) {
+        // Multiples of 1/8, whose sums are exact
+        weighted_edges.push_back(WeightedEdge(e.src, e.dst, (rand() % 1000 + 1) / 8.0));
+    }
+    if (clean_edges) {
+        for (int i = 0; i < 300; i++) {
+            WeightedEdge e = weighted_edges[rand() % weighted_edges.size()];
+            if (rand() % 2 == 0) {
+                e = WeightedEdge(e.dst, e.src, e.weight);
+            }
+            e.weight = (rand() % 1000 + 1) / 8.0;
+            weighted_edges.push_back(e);
+            vertex_id_t v = rand() % 300;
+            weighted_edges.push_back(WeightedEdge(v, v, 1));
+        }
+    }
+    if (graph_format == BinaryGraphFormat) {
+        write_binary_graph(test_graph_path, weighted_edges);
+    } else {
+        write_text_graph(test_graph_path, weighted_edges);
+    }
+
+    typedef std::tuple<vertex_id_t, vertex_id_t, real_t> EdgeTuple;
+    std::map<std::pair<vertex_id_t, vertex_id_t>, real_t> weight_sums;
+    std::vector<EdgeTuple> std_edges;
+    for (auto &e : weighted_edges) {
+        vertex_id_t src = e.src;
+        vertex_id_t dst = e.dst;
+        real_t weight = e.weight;
+        if (clean_edges) {
+            if (src != dst) {
+                weight_sums[as_undirected ? std::make_pair(std::min(src, dst), std::max(src, dst)) : std::make_pair(src, dst)] += weight;
+            }
+            continue;
+        }
+        std_edges.push_back(EdgeTuple(src, dst, weight));
+        if (as_undirected) {
+            std_edges.push_back(EdgeTuple(dst, src, weight));
+        }
+    }
+    for (auto &w : weight_sums) {
+        std_edges.push_back(EdgeTuple(w.first.first, w.first.second, w.second));
+        if (as_undirected) {
+            std_edges.push_back(EdgeTuple(w.first.second, w.first.first, w.second));
+        }
+    }
+    std::sort(std_edges.begin(), std_edges.end());
+
+    auto check_weighted_edges = [&] (GraphMocker &graph) {
+        graph.check_edge_consistency();
+        std::vector<WeightedEdge> graph_edges;
+        graph.get_weighted_edges_with_name(graph_edges);
+        std::vector<EdgeTuple> cmp_edges;
+        for (auto &e : graph_edges) {
+            vertex_id_t src = e.src;
+            vertex_id_t dst = e.dst;
+            real_t weight = e.weight;
+            cmp_edges.push_back(EdgeTuple(src, dst, weight));
+        }
+        std::sort(cmp_edges.begin(), cmp_edges.end());
+        ASSERT_EQ(cmp_edges.size(), std_edges.size());
+        for (size_t e_i = 0; e_i < std_edges.size(); e_i++) {
+            ASSERT_TRUE(cmp_edges[e_i] == std_edges[e_i]);
+        }
+    };
+
+    uint64_t mem_quota = 0;
+    int walk_len = 10;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num;
+    };
+    std::string snapshot_path = get_graph_snapshot_path(test_graph_path, graph_format, as_undirected, clean_edges, true, false, mtcfg);
+    std::remove(snapshot_path.c_str());
+    GraphMocker graph(mtcfg);
+    graph.set_weighted(true);
+    graph.set_clean_edges(clean_edges);
+    make_graph(test_graph_path, graph_format, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, graph, true);
+    ASSERT_EQ(graph.e_num, std_edges.size());
+    check_weighted_edges(graph);
+    test_partitions(&graph, mtcfg.socket_num);
+    // The weights are sorted along with the neighbors
+    graph.prepare_neighbor_query();
+    check_weighted_edges(graph);
+
+    GraphMocker snapshot_graph(mtcfg);
+    snapshot_graph.set_weighted(true);
+    snapshot_graph.set_clean_edges(clean_edges);
+    ASSERT_TRUE(load_graph_snapshot(snapshot_path.c_str(), test_graph_path, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, snapshot_graph));
+    check_weighted_edges(snapshot_graph);
+    // The weights must be loaded as well
+    GraphMocker unweighted_graph(mtcfg);
+    unweighted_graph.set_clean_edges(clean_edges);
+    ASSERT_FALSE(load_graph_snapshot(snapshot_path.c_str(), test_graph_path, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, unweighted_graph));
+
+    std::remove(snapshot_path.c_str());
+    rm_test_graph_file();
+}
+
+TEST(WeightedGraph, SingleThreadText)
+{
+    SINGLE_THREAD_TEST(test_weighted_graph(TextGraphFormat, true, false, mtcfg));
+}
+
+TEST(WeightedGraph, MultiThreadBinaryDirected)
+{
+    MULTI_THREAD_TEST(test_weighted_graph(BinaryGraphFormat, false, false, mtcfg));
+}
+
+TEST(WeightedGraph, MultiThreadCleanUndirected)
+{
+    MULTI_THREAD_TEST(test_weighted_graph(TextGraphFormat, true, true, mtcfg));
+}
+
+TEST(WeightedGraph, NUMA)
+{
+    NUMA_TEST(test_weighted_graph(BinaryGraphFormat, true, true, mtcfg));
+}
+
+/**
+ * Run the mini benchmarks of weighted and unweighted graphs of the same
+ * walker density and threads, and check that the partitions only get the
+ * samplers benchmarked for their own kind of graphs.
+ */
+void test_benchmark_catalogue(MultiThreadConfig mtcfg)
+{
+    std::vector<Edge> edges;
+    gen_graph(200, 2000, edges);
+    std::vector<WeightedEdge> weighted_edges;
+    for (auto &e : edges) {
+        weighted_edges.push_back(WeightedEdge(e.src, e.dst, (rand() % 1000 + 1) / 8.0));
+    }
+    const double walker_per_edge = 1;
+    const vertex_id_t max_benchmark_degree = 5;
+    for (bool weighted : {false, true}) {
+        std::remove(MiniBMKCatManager::get_cfg_file(walker_per_edge, weighted, mtcfg).c_str());
+    }
+    // The second round reads the benchmarks cached by both kinds of graphs
+    for (int round = 0; round < 2; round++) {
+        for (bool weighted : {false, true}) {
+            if (weighted) {
+                write_text_graph(test_graph_path, weighted_edges);
+            } else {
+                write_text_graph(test_graph_path, edges);
+            }
+            GraphMocker graph(mtcfg);
+            graph.set_weighted(weighted);
+            graph.load(test_graph_path, TextGraphFormat, false);
+            GraphHint random_hint;
+            get_partition_hint(walker_per_edge, &graph, mtcfg, &random_hint);
+            GraphHint graph_hint;
+            graph_hint.group_bits = random_hint.group_bits;
+            graph_hint.group_num = random_hint.group_num;
+            get_benchmark_partition_hint(walker_per_edge, max_benchmark_degree, &graph, mtcfg, &graph_hint);
+            ASSERT_FALSE(graph_hint.partition_sampler_class.empty());
+            for (auto sc : graph_hint.partition_sampler_class) {
+                if (weighted) {
+                    ASSERT_TRUE(sc == ClassAliasSampler || sc == ClassWeightedBufferSampler);
+                } else {
+                    ASSERT_TRUE(sc == ClassUniformDegreeDirectSampler || sc == ClassExclusiveBufferSampler);
+                }
+            }
+            graph.make(&graph_hint);
+            test_partitions(&graph, mtcfg.socket_num);
+            rm_test_graph_file();
+        }
+    }
+    for (bool weighted : {false, true}) {
+        std::remove(MiniBMKCatManager::get_cfg_file(walker_per_edge, weighted, mtcfg).c_str());
+    }
+}
+
+TEST(WeightedGraph, SingleThreadBenchmarkCatalogue)
+{
+    SINGLE_THREAD_TEST(test_benchmark_catalogue(mtcfg));
+}
+
+void test_temporal_text_parser() {
+    std::stringstream ss;
+    ss << "# comment line 0 1 2\n";
+    ss << "0 1 5\n";
+    ss << "  2\t3\t0\r\n";
+    ss << "\n";
+    ss << "4 5 123 extra\n";
+    ss << "6 7 42\n";
+    const edge_time_t max_time = std::numeric_limits<edge_time_t>::max();
+    ss << "8 9 " << (uint64_t) max_time;
+    FILE *f = fopen(test_graph_path, "w");
+    fprintf(f, "%s", ss.str().c_str());
+    fclose(f);
+
+    std::vector<TemporalEdge> edges;
+    read_text_graph(std::vector<std::string>(1, test_graph_path), edges);
+    ASSERT_EQ(edges.size(), 5u);
+    edge_time_t std_times[] = {5, 0, 123, 42, max_time};
+    for (size_t e_i = 0; e_i < edges.size(); e_i++) {
+        EXPECT_EQ(edges[e_i].src, e_i * 2);
+        EXPECT_EQ(edges[e_i].dst, e_i * 2 + 1);
+        EXPECT_EQ(edges[e_i].time, std_times[e_i]);
+    }
+
+    // The times larger than edge_time_t fail instead of wrapping. Both max
+    // times end with 5, so the next integer ends with 6.
+    std::string overflow_time = std::to_string((uint64_t) max_time);
+    overflow_time.back() = '6';
+    f = fopen(test_graph_path, "w");
+    fprintf(f, "0 1 %s\n", overflow_time.c_str());
+    fclose(f);
+    EXPECT_DEATH(read_text_graph(std::vector<std::string>(1, test_graph_path), edges), "larger than");
+    rm_test_graph_file();
+}
+
+TEST(TemporalGraph, SingleThreadParser)
+{
+    SINGLE_THREAD_TEST(test_temporal_text_parser());
+}
+
+/**
+ * Load a temporal graph, and check that the edges of each vertex are sorted
+ * by time and keep their times, as well as the times loaded from the snapshot.
+ */
+void test_temporal_graph(GraphFormat graph_format, bool as_undirected, MultiThreadConfig mtcfg)
+{
+    std::vector<Edge> edges;
+    gen_graph(300, 3000, edges);
+    std::vector<TemporalEdge> temporal_edges;
+    for (auto &e : edges) {
+        // Few distinct times, so that many edges share their times
+        temporal_edges.push_back(TemporalEdge(e.src, e.dst, rand() % 50));
+    }
+    if (graph_format == BinaryGraphFormat) {
+        write_binary_graph(test_graph_path, temporal_edges);
+    } else {
+        write_text_graph(test_graph_path, temporal_edges);
+    }
+
+    typedef std::tuple<vertex_id_t, vertex_id_t, edge_time_t> EdgeTuple;
+    std::vector<EdgeTuple> std_edges;
+    for (auto &e : temporal_edges) {
+        std_edges.push_back(EdgeTuple(e.src, e.dst, e.time));
+        if (as_undirected) {
+            std_edges.push_back(EdgeTuple(e.dst, e.src, e.time));
+        }
+    }
+    std::sort(std_edges.begin(), std_edges.end());
+
+    auto check_temporal_edges = [&] (GraphMocker &graph) {
+        graph.check_edge_consistency();
+        std::vector<TemporalEdge> graph_edges;
+        graph.get_temporal_edges_with_name(graph_edges);
+        std::vector<EdgeTuple> cmp_edges;
+        for (size_t e_i = 0; e_i < graph_edges.size(); e_i++) {
+            auto &e = graph_edges[e_i];
+            if (e_i != 0 && graph_edges[e_i - 1].src == e.src) {
+                ASSERT_LE(graph_edges[e_i - 1].time, e.time);
+            }
+            cmp_edges.push_back(EdgeTuple(e.src, e.dst, e.time));
+        }
+        std::sort(cmp_edges.begin(), cmp_edges.end());
+        ASSERT_EQ(cmp_edges.size(), std_edges.size());
+        for (size_t e_i = 0; e_i < std_edges.size(); e_i++) {
+            ASSERT_TRUE(cmp_edges[e_i] == std_edges[e_i]);
+        }
+    };
+
+    uint64_t mem_quota = 0;
+    int walk_len = 10;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num;
+    };
+    std::string snapshot_path = get_graph_snapshot_path(test_graph_path, graph_format, as_undirected, false, false, true, mtcfg);
+    std::remove(snapshot_path.c_str());
+    GraphMocker graph(mtcfg);
+    graph.set_temporal(true);
+    make_graph(test_graph_path, graph_format, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, graph, true);
+    ASSERT_EQ(graph.e_num, std_edges.size());
+    check_temporal_edges(graph);
+    test_partitions(&graph, mtcfg.socket_num);
+
+    GraphMocker snapshot_graph(mtcfg);
+    snapshot_graph.set_temporal(true);
+    ASSERT_TRUE(load_graph_snapshot(snapshot_path.c_str(), test_graph_path, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, snapshot_graph));
+    check_temporal_edges(snapshot_graph);
+    // The times must be loaded as well
+    GraphMocker static_graph(mtcfg);
+    ASSERT_FALSE(load_graph_snapshot(snapshot_path.c_str(), test_graph_path, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, static_graph));
+
+    std::remove(snapshot_path.c_str());
+    rm_test_graph_file();
+}
+
+TEST(TemporalGraph, SingleThreadText)
+{
+    SINGLE_THREAD_TEST(test_temporal_graph(TextGraphFormat, true, mtcfg));
+}
+
+TEST(TemporalGraph, MultiThreadBinaryDirected)
+{
+    MULTI_THREAD_TEST(test_temporal_graph(BinaryGraphFormat, false, mtcfg));
+}
+
+TEST(TemporalGraph, NUMA)
+{
+    NUMA_TEST(test_temporal_graph(TextGraphFormat, true, mtcfg));
+}
+
+/**
+ * Load the vertex types of a graph, and check that the type segments hold
+ * the neighbors of each type in order.
+ */
+void test_typed_graph(bool as_undirected, MultiThreadConfig mtcfg)
+{
+    const vertex_id_t v_num = 300;
+    auto get_type = [] (vertex_id_t name) {
+        return (vertex_type_t) (name % 5 == 0 ? 2 : name % 2);
+    };
+    std::vector<Edge> edges;
+    gen_graph(v_num, 3000, edges);
+    write_text_graph(test_graph_path, edges);
+    write_test_vertex_types(v_num, get_type);
+
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num;
+    };
+    GraphMocker graph(mtcfg);
+    make_graph(test_graph_path, TextGraphFormat, as_undirected, walker_num_func, 10, mtcfg, 0, false, graph);
+    graph.load_vertex_types(test_vertex_type_path);
+    ASSERT_EQ(graph.type_num, 3u);
+    for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+        ASSERT_EQ(graph.vertex_types[v_i], get_type(graph.id2name[v_i]));
+    }
+
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_id(graph_edges);
+    graph.prepare_type_segments();
+    std::vector<std::vector<std::vector<vertex_id_t> > > type_neighbors(graph.v_num, std::vector<std::vector<vertex_id_t> >(graph.type_num));
+    for (auto &e : graph_edges) {
+        type_neighbors[e.src][graph.vertex_types[e.dst]].push_back(e.dst);
+    }
+    for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+        for (vertex_type_t t_i = 0; t_i < graph.type_num; t_i++) {
+            auto &std_neighbors = type_neighbors[v_i][t_i];
+            std::sort(std_neighbors.begin(), std_neighbors.end());
+            for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+                AdjList adj = graph.get_type_adjlist(v_i, t_i, s_i);
+                ASSERT_EQ(adj.degree, std_neighbors.size());
+                for (vertex_id_t e_i = 0; e_i < adj.degree; e_i++) {
+                    ASSERT_EQ(adj.begin[e_i].neighbor, std_neighbors[e_i]);
+                }
+            }
+        }
+    }
+    rm_test_vertex_type_file();
+    rm_test_graph_file();
+}
+
+TEST(TypedGraph, SingleThread)
+{
+    SINGLE_THREAD_TEST(test_typed_graph(true, mtcfg));
+}
+
+TEST(TypedGraph, MultiThreadDirected)
+{
+    MULTI_THREAD_TEST(test_typed_graph(false, mtcfg));
+}
+
+TEST(TypedGraph, NUMA)
+{
+    NUMA_TEST(test_typed_graph(true, mtcfg));
+}
+
+// The neighbors of the vertices are queried with NeighborSets, scans and binary searches
+void test_neighbor_query(MultiThreadConfig mtcfg)
+{
+    // The bitmap of v_num / 8 bytes is smaller than the hash set of the first hubs,
+    // and larger than the 16 buckets of the next ones, for both ID widths
+    const vertex_id_t v_num = 2500 * NeighborBucketSlotNum;
+    // Bitmaps for the first hubs, hash sets for the next ones, then searched and scanned vertices
+    const vertex_id_t degrees[] = {6000, 8 * NeighborBucketSlotNum, 30, 3};
+    const vertex_id_t vertex_ends[] = {2, 10, 100, v_num};
+    MTRandGen rd;
+    std::vector<Edge> edges;
+    for (vertex_id_t v_i = 0, level = 0; v_i < v_num; v_i++) {
+        if (v_i == vertex_ends[level]) {
+            level++;
+        }
+        for (vertex_id_t e_i = 0; e_i < degrees[level]; e_i++) {
+            edges.push_back(Edge(v_i, rd.gen(v_num)));
+        }
+    }
+    write_text_graph(test_graph_path, edges);
+
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num;
+    };
+    GraphMocker graph(mtcfg);
+    make_graph(test_graph_path, TextGraphFormat, false, walker_num_func, 10, mtcfg, 0, false, graph);
+    graph.prepare_neighbor_query();
+    ASSERT_GE(graph.neighbor_set_end, 10u);
+    ASSERT_LT(graph.neighbor_scan_begin, graph.dead_end_begin);
+    ASSERT_GT(graph.get_neighbor_index_size(), 0u);
+    bool has_bitmap = false;
+    bool has_buckets = false;
+    for (vertex_id_t v_i = 0; v_i < graph.neighbor_set_end; v_i++) {
+        has_bitmap |= graph.neighbor_sets[v_i].bitmap != nullptr;
+        has_buckets |= graph.neighbor_sets[v_i].buckets != nullptr;
+    }
+    ASSERT_TRUE(has_bitmap);
+    ASSERT_TRUE(has_buckets);
+
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_id(graph_edges);
+    std::vector<std::set<vertex_id_t> > neighbors(graph.v_num);
+    for (auto &e : graph_edges) {
+        neighbors[e.src].insert(e.dst);
+    }
+    for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+        uint64_t error_num = 0;
+        #pragma omp parallel reduction (+: error_num)
+        {
+            MTRandGen thread_rd;
+            #pragma omp for
+            for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+                for (auto neighbor : neighbors[v_i]) {
+                    error_num += !graph.has_neighbor(v_i, neighbor, s_i);
+                }
+                for (int q_i = 0; q_i < 100; q_i++) {
+                    vertex_id_t vertex = thread_rd.gen(graph.v_num);
+                    error_num += graph.has_neighbor(v_i, vertex, s_i) != (neighbors[v_i].count(vertex) != 0);
+                }
+            }
+        }
+        ASSERT_EQ(error_num, 0u);
+    }
+    rm_test_graph_file();
+}
+
+TEST(NeighborQuery, SingleThread)
+{
+    SINGLE_THREAD_TEST(test_neighbor_query(mtcfg));
+}
+
+TEST(NeighborQuery, MultiThread)
+{
+    MULTI_THREAD_TEST(test_neighbor_query(mtcfg));
+}
+
+TEST(NeighborQuery, NUMA)
+{
+    NUMA_TEST(test_neighbor_query(mtcfg));
+}
+
+void test_prefix_sum_and_bitmap()
+{
+    size_t nums[] = {0, 1, 7, 64, 65, 1000, 12345};
+    for (auto num : nums) {
+        std::vector<vertex_id_t> data(num);
+        for (auto &d : data) {
+            d = rand() % 1000;
+        }
+        std::vector<edge_id_t> prefix_sum(num + 1);
+        parallel_prefix_sum(data.data(), prefix_sum.data(), num);
+        edge_id_t sum = 0;
+        for (size_t i = 0; i < num; i++) {
+            ASSERT_EQ(prefix_sum[i], sum);
+            sum += data[i];
+        }
+        ASSERT_EQ(prefix_sum[num], sum);
+
+        ConcurrentBitmap bitmap;
+        bitmap.resize(num);
+        #pragma omp parallel for
+        for (size_t i = 0; i < num; i++) {
+            if (data[i] % 3 == 0) {
+                bitmap.set(i);
+            }
+        }
+        std::vector<size_t> word_ranks;
+        bitmap.get_word_ranks(word_ranks);
+        size_t rank = 0;
+        for (size_t i = 0; i < num; i++) {
+            ASSERT_EQ(bitmap.get(i), data[i] % 3 == 0);
+            if (bitmap.get(i)) {
+                ASSERT_EQ(bitmap.rank(word_ranks, i), rank);
+                rank++;
+            }
+        }
+        ASSERT_EQ(word_ranks.back(), rank);
+    }
+}
+
+TEST(Parallel, SingleThreadPrefixSum)
+{
+    SINGLE_THREAD_TEST(test_prefix_sum_and_bitmap());
+}
+
+TEST(Parallel, MultiThreadPrefixSum)
+{
+    MULTI_THREAD_TEST(test_prefix_sum_and_bitmap());
+}
+
+void test_huge_pages(HugePageMode mode, MultiThreadConfig mtcfg)
+{
+    mtcfg.hugepage_mode = mode;
+    // Small memory is mapped with 4 KiB pages
+    ASSERT_EQ(get_map_size(100, mode), (size_t) PageSize);
+    size_t huge_size = mode == HugePage1G ? (1ull << 30) : (1ull << 21);
+    if (mode != HugePageOff) {
+        ASSERT_EQ(get_map_size(huge_size + 1, mode), huge_size * 2);
+        // Medium memory is mapped with 2 MiB pages, even with HugePage1G
+        ASSERT_EQ(get_page_size((1ull << 21) + 1, mode), 1ull << 21);
+        ASSERT_EQ(get_map_size((1ull << 21) + 1, mode), 1ull << 22);
+    }
+
+    MemoryPool mpool(mtcfg);
+    int* small = mpool.alloc<int>(16, 0);
+    small[15] = 1;
+    size_t num = (5ull << 20) / sizeof(uint64_t);
+    uint64_t* array = mpool.alloc<uint64_t>(num, 0);
+    if (mode != HugePageOff) {
+        ASSERT_EQ((uintptr_t) array % (1ull << 21), 0u);
+    }
+    #pragma omp parallel for
+    for (size_t i = 0; i < num; i++) {
+        array[i] += i;
+    }
+    for (size_t i = 0; i < num; i++) {
+        ASSERT_EQ(array[i], i);
+    }
+
+    WalkerManager wkrm(mtcfg);
+    walker_id_t walker_num = (3u << 20) + 12345;
+    wkrm.init(walker_num);
+    vertex_id_t* walkers = wkrm.alloc_walker_array<vertex_id_t>();
+    wkrm.process_walkers([&](walker_id_t w_i) {
+        CHECK(walkers[w_i] == 0);
+        walkers[w_i] = w_i;
+    }, walker_num);
+    for (walker_id_t w_i = 0; w_i < walker_num; w_i++) {
+        ASSERT_EQ(walkers[w_i], w_i);
+    }
+    wkrm.dealloc_walker_array(walkers);
+}
+
+TEST(HugePages, MultiThreadOff)
+{
+    MULTI_THREAD_TEST(test_huge_pages(HugePageOff, mtcfg));
+}
+
+TEST(HugePages, SingleThreadTHP)
+{
+    SINGLE_THREAD_TEST(test_huge_pages(HugePageTHP, mtcfg));
+}
+
+// The hugetlbfs modes fall back to transparent huge pages without reserved pages
+TEST(HugePages, SingleThread2M)
+{
+    SINGLE_THREAD_TEST(test_huge_pages(HugePage2M, mtcfg));
+}
+
+TEST(HugePages, SingleThread1G)
+{
+    SINGLE_THREAD_TEST(test_huge_pages(HugePage1G, mtcfg));
+}
+
+TEST(HugePages, MultiThreadTHP)
+{
+    MULTI_THREAD_TEST(test_huge_pages(HugePageTHP, mtcfg));
+}
+
+TEST(HugePages, NUMA)
+{
+    NUMA_TEST(test_huge_pages(HugePageTHP, mtcfg));
+}
+
+void test_convert()
+{
+    // Two adjacency list files of "src degree dst_0 ... dst_{degree - 1}"
+    std::vector<std::string> paths = {test_graph_path, std::string(test_graph_path) + ".1"};
+    std::vector<Edge> std_edges;
+    for (auto &path : paths) {
+        FILE *f = fopen(path.c_str(), "w");
+        fprintf(f, "# comment\n");
+        for (int v_i = 0; v_i < 500; v_i++) {
+            vertex_id_t src = rand() % 100000;
+            int degree = rand() % 10;
+            fprintf(f, "%llu %d", (unsigned long long) src, degree);
+            for (int d_i = 0; d_i < degree; d_i++) {
+                vertex_id_t dst = rand() % 100000;
+                fprintf(f, " %llu", (unsigned long long) dst);
+                std_edges.push_back(Edge(src, dst));
+            }
+            fprintf(f, "\n");
+        }
+        fclose(f);
+    }
+    std::vector<Edge> edges;
+    read_text_shards(paths, AdjacencyListParser(), edges);
+    ASSERT_EQ(edges.size(), std_edges.size());
+    for (size_t e_i = 0; e_i < edges.size(); e_i++) {
+        ASSERT_EQ(edges[e_i], std_edges[e_i]);
+    }
+
+    // Dense IDs in the order of the names
+    vertex_id_t v_num = relabel_edges(edges);
+    std::map<vertex_id_t, vertex_id_t> name2id;
+    for (auto &e : std_edges) {
+        name2id[e.src] = 0;
+        name2id[e.dst] = 0;
+    }
+    vertex_id_t id = 0;
+    for (auto &p : name2id) {
+        p.second = id++;
+    }
+    ASSERT_EQ(v_num, name2id.size());
+    for (size_t e_i = 0; e_i < edges.size(); e_i++) {
+        ASSERT_EQ(edges[e_i], Edge(name2id[std_edges[e_i].src], name2id[std_edges[e_i].dst]));
+    }
+
+    std::stringstream binary_ss, text_ss;
+    binary_ss << "# binary\n";
+    text_ss << "# text\n";
+    std::vector<Edge> binary_edges, text_edges;
+    write_binary_edges(paths[1].c_str(), edges, binary_ss);
+    read_binary_graph(paths[1].c_str(), binary_edges);
+    ASSERT_TRUE(binary_edges == edges);
+    write_text_edges(paths[0].c_str(), edges, text_ss);
+    read_text_graph(paths[0].c_str(), text_edges);
+    ASSERT_TRUE(text_edges == edges);
+
+
+    // A Matrix Market file, streamed to a binary graph
+    FILE *f = fopen(paths[0].c_str(), "w");
+    fprintf(f, "%%%%MatrixMarket matrix coordinate real general\n%% comment\n");
+    fprintf(f, "%llu %llu %zu\n", (unsigned long long) v_num, (unsigned long long) v_num, edges.size());
+    for (auto &e : edges) {
+        fprintf(f, "%llu %llu 0.5\n", (unsigned long long) e.src + 1, (unsigned long long) e.dst + 1);
+    }
+    fclose(f);
+    std::vector<Edge> stream_edges;
+    ASSERT_EQ(stream_binary_edges(std::vector<std::string>(1, paths[0]), MatrixMarketParser(), paths[1].c_str()), edges.size());
+    read_binary_graph(paths[1].c_str(), stream_edges);
+    auto edge_less = [] (const Edge &a, const Edge &b) {
+        return a.src < b.src || (a.src == b.src && a.dst < b.dst);
+    };
+    std::sort(stream_edges.begin(), stream_edges.end(), edge_less);
+    std::sort(edges.begin(), edges.end(), edge_less);
+    ASSERT_TRUE(stream_edges == edges);
+
+    // A symmetric Matrix Market file stores the lower triangle, whose
+    // off-diagonal entries are edges of both directions
+    f = fopen(paths[0].c_str(), "w");
+    fprintf(f, "%%%%MatrixMarket matrix coordinate pattern symmetric\n");
+    fprintf(f, "4 4 4\n2 1\n3 3\n4 1\n4 2\n");
+    fclose(f);
+    std::vector<Edge> symmetric_edges = {Edge(0, 1), Edge(0, 3), Edge(1, 0), Edge(1, 3), Edge(2, 2), Edge(3, 0), Edge(3, 1)};
+    ASSERT_EQ(stream_binary_edges(std::vector<std::string>(1, paths[0]), MatrixMarketParser(), paths[1].c_str()), symmetric_edges.size());
+    read_binary_graph(paths[1].c_str(), stream_edges);
+    std::sort(stream_edges.begin(), stream_edges.end(), edge_less);
+    ASSERT_TRUE(stream_edges == symmetric_edges);
+    read_text_shards(std::vector<std::string>(1, paths[0]), MatrixMarketParser(), stream_edges);
+    std::sort(stream_edges.begin(), stream_edges.end(), edge_less);
+    ASSERT_TRUE(stream_edges == symmetric_edges);
+
+    // Binary shards, streamed in pieces smaller than the shards
+    std::vector<Edge> binary_shard_edges;
+    for (auto &path : paths) {
+        std::vector<Edge> shard_edges;
+        gen_graph(100, 1000 + rand() % 100, shard_edges);
+        write_binary_graph(path.c_str(), shard_edges);
+        binary_shard_edges.insert(binary_shard_edges.end(), shard_edges.begin(), shard_edges.end());
+    }
+    std::string stream_path = std::string(test_graph_path) + ".out";
+    ASSERT_EQ(stream_binary_shards<Edge>(paths, stream_path.c_str(), 100 * sizeof(Edge) + 1), binary_shard_edges.size());
+    read_binary_graph(stream_path.c_str(), stream_edges);
+    ASSERT_TRUE(stream_edges == binary_shard_edges);
+    std::remove(stream_path.c_str());
+
+    std::remove(paths[1].c_str());
+    std::remove(get_info_graph_path(paths[1]).c_str());
+    rm_test_graph_file();
+}
+
+TEST(Convert, SingleThread)
+{
+    SINGLE_THREAD_TEST(test_convert());
+}
+
+TEST(Convert, MultiThread)
+{
+    MULTI_THREAD_TEST(test_convert());
+}
+
 GTEST_API_ int main(int argc, char *argv[])
 {
     init_glog(argv, google::FATAL);
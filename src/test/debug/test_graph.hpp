@@ -65,4 +65,40 @@ public:
             e.dst = id2name[e.dst];
         }
     }
+
+    // For weighted graphs
+    void get_weighted_edges_with_id(std::vector<WeightedEdge> &edges) {
+        for (vertex_id_t v_i = 0; v_i < dead_end_begin; v_i++) {
+            real_t* weights = get_edge_weights(v_i);
+            for (vertex_id_t e_i = 0; e_i < adjlists[0][v_i].degree; e_i++) {
+                edges.push_back(WeightedEdge(v_i, adjlists[0][v_i].begin[e_i].neighbor, weights[e_i]));
+            }
+        }
+    }
+
+    void get_weighted_edges_with_name(std::vector<WeightedEdge> &edges) {
+        get_weighted_edges_with_id(edges);
+        for (auto &e : edges) {
+            e.src = id2name[e.src];
+            e.dst = id2name[e.dst];
+        }
+    }
+
+    // For temporal graphs, in the order of the edges of each vertex
+    void get_temporal_edges_with_id(std::vector<TemporalEdge> &edges) {
+        for (vertex_id_t v_i = 0; v_i < dead_end_begin; v_i++) {
+            edge_time_t* times = get_edge_times(v_i, partition_socket[get_vertex_partition_id(v_i)]);
+            for (vertex_id_t e_i = 0; e_i < adjlists[0][v_i].degree; e_i++) {
+                edges.push_back(TemporalEdge(v_i, adjlists[0][v_i].begin[e_i].neighbor, times[e_i]));
+            }
+        }
+    }
+
+    void get_temporal_edges_with_name(std::vector<TemporalEdge> &edges) {
+        get_temporal_edges_with_id(edges);
+        for (auto &e : edges) {
+            e.src = id2name[e.src];
+            e.dst = id2name[e.dst];
+        }
+    }
 };
@@ -19,7 +19,7 @@
 #include "../../core/graph.hpp"
 #include "../../core/solver.hpp"
 
-void test_node2vec(real_t p, real_t q, GraphFormat graph_format, MultiThreadConfig mtcfg)
+void test_node2vec(real_t p, real_t q, GraphFormat graph_format, MultiThreadConfig mtcfg, size_t alias_mem = 0)
 {
     uint64_t mem_quota = 0; // mem_quota is not really used when UNIT_TEST is defined
     unsigned walk_len = 40 + rand() % 40;
@@ -34,6 +34,7 @@ void test_node2vec(real_t p, real_t q, GraphFormat graph_format, MultiThreadConf
     FMobSolver* solver = new FMobSolver(&graph, mtcfg);
 
     solver->set_node2vec(p, q);
+    solver->set_second_order_alias_mem(alias_mem);
     uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
     std::vector<vertex_id_t> walks((size_t) walk_len * walker_num);
     solver->prepare(walker_num, walk_len, mem_quota);
@@ -71,6 +72,35 @@ void test_task(MultiThreadConfig mtcfg) {
     rm_test_graph_file();
 }
 
+// Some partitions are sampled with second-order alias tables, within the memory budget
+void test_second_order_alias_task(MultiThreadConfig mtcfg) {
+    edge_id_t e_nums_arr[] = {64, 232, 800};
+    size_t selected_num = 0;
+    for (auto &e_num : e_nums_arr)
+    {
+        std::vector<Edge> edges;
+        vertex_id_t v_num = std::min((unsigned)(e_num / 2), (unsigned)(100 + rand() % ((e_num + 9) / 3)));
+        gen_undirected_graph(v_num, e_num, edges);
+        write_text_graph(test_graph_path, edges);
+        for (size_t alias_mem : {(size_t) 1 << 30, (size_t) 1 << 10}) {
+            GraphMocker graph(mtcfg);
+            auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+                return (uint64_t) edge_num;
+            };
+            make_graph(test_graph_path, TextGraphFormat, false, walker_num_func, 10, mtcfg, 0, true, graph);
+            graph.prepare_neighbor_query();
+            size_t mem_size;
+            auto selected = select_second_order_partitions(&graph, 10, 10, alias_mem, mem_size);
+            ASSERT_LE(mem_size, alias_mem);
+            selected_num += std::count(selected.begin(), selected.end(), true);
+        }
+        test_node2vec(0.5, 2.0, TextGraphFormat, mtcfg, (size_t) 1 << 30);
+        test_node2vec(10, 10, TextGraphFormat, mtcfg, (size_t) 1 << 10);
+    }
+    ASSERT_GT(selected_num, 0u);
+    rm_test_graph_file();
+}
+
 TEST(Node2vec, SingleThread)
 {
     SINGLE_THREAD_TEST(test_task(mtcfg));
@@ -86,6 +116,16 @@ TEST(Node2vec, NUMA)
     NUMA_TEST(test_task(mtcfg));
 }
 
+TEST(Node2vec, SingleThreadSecondOrderAlias)
+{
+    SINGLE_THREAD_TEST(test_second_order_alias_task(mtcfg));
+}
+
+TEST(Node2vec, MultiThreadSecondOrderAlias)
+{
+    MULTI_THREAD_TEST(test_second_order_alias_task(mtcfg));
+}
+
 GTEST_API_ int main(int argc, char *argv[])
 {
     init_glog(argv, google::FATAL);
@@ -8,6 +8,8 @@
 #include <set>
 #include <type_traits>
 #include <memory>
+#include <numeric>
+#include <cmath>
 
 #include <gtest/gtest.h>
 
@@ -19,17 +21,20 @@
 #include "../test.hpp"
 #include "test_graph.hpp"
 #include "knightking/test_walk.hpp"
+#include "knightking/test_node2vec.hpp"
 
-void test_solver(std::string solver_name, GraphFormat graph_format, MultiThreadConfig mtcfg)
+void test_solver(std::string solver_name, GraphFormat graph_format, bool as_undirected, MultiThreadConfig mtcfg)
 {
     uint64_t mem_quota = 0; // mem_quota is not really used when UNIT_TEST is defined
     unsigned walk_len = 40 + rand() % 40;
-    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
-        uint64_t walker_num = (edge_num + rand() % edge_num) * 10;
+    // Directed graphs have vertices rarely walked into, which need more walkers to be sampled enough
+    auto walker_num_func = [=] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        uint64_t walker_num = (edge_num + rand() % edge_num) * (as_undirected ? 10 : 40);
         return walker_num;
     };
     GraphMocker graph(mtcfg);
-    make_graph(test_graph_path, graph_format, true, walker_num_func, walk_len, mtcfg, mem_quota, false, graph);
+    make_graph(test_graph_path, graph_format, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, graph);
+    ASSERT_FALSE(graph.has_dead_end());
 
     FMobSolver* solver = new FMobSolver(&graph, mtcfg);
     uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
@@ -54,7 +59,7 @@ void test_solver(std::string solver_name, GraphFormat graph_format, MultiThreadC
     delete solver;
 }
 
-void test_task(const char* solver_name, MultiThreadConfig mtcfg) {
+void test_task(const char* solver_name, MultiThreadConfig mtcfg, bool as_undirected = true) {
     edge_id_t e_nums_arr[] = {3, 64, 1283, 2301, 6553, 8000};
     for (auto &e_num : e_nums_arr)
     {
@@ -62,11 +67,794 @@ void test_task(const char* solver_name, MultiThreadConfig mtcfg) {
         vertex_id_t v_num = std::min((unsigned)(e_num / 2), (unsigned)(100 + rand() % ((e_num + 9) / 3)));
         gen_graph(v_num, e_num, edges);
         write_text_graph(test_graph_path, edges);
-        test_solver(solver_name, TextGraphFormat, mtcfg);
+        test_solver(solver_name, TextGraphFormat, as_undirected, mtcfg);
+    }
+    rm_test_graph_file();
+}
+
+const char* test_walk_output_path = "./.flashmobtest.walks";
+
+void read_text_walks(const char* path, unsigned walk_len, std::vector<vertex_id_t> &walks)
+{
+    std::ifstream fin(path);
+    std::string line;
+    while (std::getline(fin, line)) {
+        std::stringstream ss(line);
+        vertex_id_t v;
+        unsigned step_num = 0;
+        while (ss >> v) {
+            walks.push_back(v);
+            step_num++;
+        }
+        ASSERT_EQ(step_num, walk_len);
+    }
+}
+
+void read_walk_archive(const Graph &graph, unsigned walk_len, std::vector<vertex_id_t> &walks)
+{
+    WalkArchiveReader reader(test_walk_output_path);
+    ASSERT_EQ(reader.get_walk_len(), (int) walk_len);
+    ASSERT_EQ(reader.footer.v_num, graph.v_num);
+    ASSERT_TRUE(reader.id2name != nullptr);
+    for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+        ASSERT_EQ(reader.id2name[v_i], graph.id2name[v_i]);
+    }
+    walks.resize(reader.get_walker_num() * walk_len);
+    reader.read_all(walks.data());
+
+    // Random access by walker
+    std::vector<vertex_id_t> path(walk_len);
+    for (int i = 0; i < 100; i++) {
+        uint64_t walker = rand() % reader.get_walker_num();
+        reader.read_walker(walker, path.data());
+        ASSERT_TRUE(std::equal(path.begin(), path.end(), walks.begin() + walker * walk_len));
+    }
+    // Random access by start vertex, which is given by its original ID
+    for (int i = 0; i < 20; i++) {
+        vertex_id_t vertex;
+        ASSERT_TRUE(reader.find_vertex(graph.id2name[rand() % graph.v_num], vertex));
+        std::vector<vertex_id_t> paths;
+        reader.read_start_vertex(vertex, paths);
+        std::multiset<std::vector<vertex_id_t> > expected, found;
+        for (size_t offset = 0; offset < walks.size(); offset += walk_len) {
+            if (walks[offset] == vertex) {
+                expected.insert(std::vector<vertex_id_t>(walks.begin() + offset, walks.begin() + offset + walk_len));
+            }
+        }
+        for (size_t offset = 0; offset < paths.size(); offset += walk_len) {
+            found.insert(std::vector<vertex_id_t>(paths.begin() + offset, paths.begin() + offset + walk_len));
+        }
+        ASSERT_TRUE(expected == found);
+    }
+}
+
+void read_walk_output(WalkOutputFormat format, const Graph &graph, int socket_num, unsigned walk_len, std::vector<vertex_id_t> &walks)
+{
+    if (format == ArchiveWalkOutputFormat) {
+        read_walk_archive(graph, walk_len, walks);
+        std::remove(test_walk_output_path);
+        return;
+    }
+    if (format == CorpusWalkOutputFormat) {
+        read_text_walks(test_walk_output_path, walk_len, walks);
+        std::remove(test_walk_output_path);
+        return;
+    }
+    for (int s_i = 0; s_i < socket_num; s_i++) {
+        std::string shard_path = std::string(test_walk_output_path) + "." + std::to_string(s_i);
+        if (format == BinaryWalkOutputFormat) {
+            std::vector<vertex_id_t> shard;
+            read_binary_graph(shard_path.c_str(), shard);
+            walks.insert(walks.end(), shard.begin(), shard.end());
+        } else {
+            read_text_walks(shard_path.c_str(), walk_len, walks);
+        }
+        std::remove(shard_path.c_str());
+    }
+}
+
+void test_walk_output(WalkOutputFormat format, bool direct_io, MultiThreadConfig mtcfg)
+{
+    uint64_t mem_quota = 0;
+    unsigned walk_len = 10 + rand() % 40;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num * 5;
+    };
+    std::vector<Edge> edges;
+    gen_graph(500, 4000, edges);
+    write_text_graph(test_graph_path, edges);
+
+    GraphMocker graph(mtcfg);
+    make_graph(test_graph_path, TextGraphFormat, true, walker_num_func, walk_len, mtcfg, mem_quota, false, graph);
+    FMobSolver solver(&graph, mtcfg);
+    uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
+    WalkOutputConfig output_cfg = {test_walk_output_path, format, direct_io};
+    walk(&solver, walker_num, walk_len, mem_quota, &output_cfg);
+
+    std::vector<vertex_id_t> walks;
+    read_walk_output(format, graph, mtcfg.socket_num, walk_len, walks);
+    ASSERT_EQ(walks.size(), (size_t) walker_num * walk_len);
+    if (format == CorpusWalkOutputFormat) {
+        // Translate the names back to vertex IDs
+        std::map<vertex_id_t, vertex_id_t> name2id;
+        for (vertex_id_t v_i = 0; v_i < graph.v_num; v_i++) {
+            name2id[graph.id2name[v_i]] = v_i;
+        }
+        for (auto &v : walks) {
+            ASSERT_TRUE(name2id.find(v) != name2id.end());
+            v = name2id[v];
+        }
+    }
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_id(graph_edges);
+    check_static_random_walk(graph.v_num, graph_edges.data(), graph_edges.size(), walks.data(), walker_num, walk_len);
+    rm_test_graph_file();
+}
+
+void test_walk_consumer(MultiThreadConfig mtcfg)
+{
+    uint64_t mem_quota = 0;
+    unsigned walk_len = 10 + rand() % 40;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num * 5;
+    };
+    std::vector<Edge> edges;
+    gen_graph(500, 4000, edges);
+    write_text_graph(test_graph_path, edges);
+
+    GraphMocker graph(mtcfg);
+    make_graph(test_graph_path, TextGraphFormat, true, walker_num_func, walk_len, mtcfg, mem_quota, false, graph);
+    FMobSolver solver(&graph, mtcfg);
+    uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
+    std::vector<vertex_id_t> walks(walker_num * walk_len);
+    uint64_t epoch_num = 0;
+    const vertex_id_t* buffer = nullptr;
+    solver.walk_epochs(walker_num, walk_len, mem_quota, [&] (const EpochWalkView &view) {
+        ASSERT_EQ(view.epoch, epoch_num++);
+        ASSERT_EQ(view.walk_len, (int) walk_len);
+        ASSERT_LE(view.sockets.size(), (size_t) mtcfg.socket_num);
+        walker_id_t first_walker = 0;
+        for (auto &span : view.sockets) {
+            // The spans are consecutive parts of the same output buffer across epochs
+            ASSERT_EQ(span.first_walker, first_walker);
+            if (buffer == nullptr) {
+                buffer = span.paths;
+            }
+            ASSERT_EQ(span.paths, buffer + (uint64_t) span.first_walker * walk_len);
+            first_walker += span.walker_num;
+            std::copy(span.paths, span.paths + (uint64_t) span.walker_num * walk_len, walks.begin() + (view.first_walker + span.first_walker) * walk_len);
+        }
+        ASSERT_EQ(first_walker, view.walker_num);
+    });
+    ASSERT_GT(epoch_num, 0u);
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_id(graph_edges);
+    check_static_random_walk(graph.v_num, graph_edges.data(), graph_edges.size(), walks.data(), walker_num, walk_len);
+    rm_test_graph_file();
+}
+
+// Check the paths of each dead-end mode from the text output
+void test_dead_end_walk(DeadEndMode mode, MultiThreadConfig mtcfg)
+{
+    uint64_t mem_quota = 0;
+    unsigned walk_len = 10 + rand() % 40;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num * 5;
+    };
+    std::vector<Edge> edges;
+    gen_dead_end_graph(300, 30, 3000, edges);
+    write_text_graph(test_graph_path, edges);
+
+    GraphMocker graph(mtcfg);
+    make_graph(test_graph_path, TextGraphFormat, false, walker_num_func, walk_len, mtcfg, mem_quota, false, graph);
+    ASSERT_TRUE(graph.has_dead_end());
+    FMobSolver solver(&graph, mtcfg);
+    solver.set_dead_end_mode(mode);
+    uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
+    WalkOutputConfig output_cfg = {test_walk_output_path, TextWalkOutputFormat, false};
+    walk(&solver, walker_num, walk_len, mem_quota, &output_cfg);
+
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_id(graph_edges);
+    std::set<std::pair<vertex_id_t, vertex_id_t> > edge_set;
+    for (auto &e : graph_edges) {
+        edge_set.insert(std::make_pair(e.src, e.dst));
+    }
+    uint64_t path_num = 0;
+    uint64_t dead_end_step_num = 0;
+    for (int s_i = 0; s_i < mtcfg.socket_num; s_i++) {
+        std::string shard_path = std::string(test_walk_output_path) + "." + std::to_string(s_i);
+        std::ifstream fin(shard_path);
+        std::string line;
+        while (std::getline(fin, line)) {
+            std::stringstream ss(line);
+            std::vector<vertex_id_t> path;
+            vertex_id_t v;
+            while (ss >> v) {
+                path.push_back(v);
+            }
+            ASSERT_GE(path.size(), 1u);
+            ASSERT_LE(path.size(), walk_len);
+            if (path.size() < walk_len) {
+                // Only the walks stopped at dead ends are shorter
+                ASSERT_EQ(mode, DeadEndStop);
+                ASSERT_GE(path.back(), graph.dead_end_begin);
+            }
+            for (size_t l_i = 1; l_i < path.size(); l_i++) {
+                ASSERT_LT(path[l_i], graph.v_num);
+                if (path[l_i - 1] < graph.dead_end_begin) {
+                    ASSERT_TRUE(edge_set.find(std::make_pair(path[l_i - 1], path[l_i])) != edge_set.end());
+                } else {
+                    ASSERT_NE(mode, DeadEndStop);
+                    if (mode == DeadEndSelfLoop) {
+                        ASSERT_EQ(path[l_i], path[l_i - 1]);
+                    }
+                    dead_end_step_num++;
+                }
+            }
+            path_num++;
+        }
+        std::remove(shard_path.c_str());
+    }
+    ASSERT_EQ(path_num, walker_num);
+    if (mode != DeadEndStop) {
+        ASSERT_GT(dead_end_step_num, 0u);
+    }
+    rm_test_graph_file();
+}
+
+/**
+ * Walk a weighted graph, and check that the transitions follow the weights.
+ * A few vertices have all their out-edges weighted 0, which are walked uniformly.
+ */
+void test_weighted_walk(bool as_undirected, MultiThreadConfig mtcfg)
+{
+    std::vector<Edge> edges;
+    gen_graph(200, 2000, edges);
+    std::vector<WeightedEdge> weighted_edges;
+    for (auto &e : edges) {
+        weighted_edges.push_back(WeightedEdge(e.src, e.dst, (e.src % 10 == 0 && !as_undirected) ? 0 : rand() % 100 + 1));
+    }
+    write_text_graph(test_graph_path, weighted_edges);
+
+    uint64_t mem_quota = 0;
+    unsigned walk_len = 40;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num * 20;
+    };
+    GraphMocker graph(mtcfg);
+    graph.set_weighted(true);
+    make_graph(test_graph_path, TextGraphFormat, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, graph);
+
+    FMobSolver solver(&graph, mtcfg);
+    solver.set_dead_end_mode(DeadEndSelfLoop);
+    uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
+    std::vector<vertex_id_t> walks((size_t) walk_len * walker_num);
+    solver.prepare(walker_num, walk_len, mem_quota);
+    auto* temp_walks = solver.alloc_output_array();
+    uint64_t terminated_walker_num = 0;
+    while (solver.has_next_walk()) {
+        walker_id_t epoch_walker_num;
+        solver.walk(temp_walks, epoch_walker_num);
+        memcpy(walks.data() + terminated_walker_num * walk_len, temp_walks, epoch_walker_num * sizeof(vertex_id_t) * walk_len);
+        terminated_walker_num += epoch_walker_num;
+    }
+    solver.dealloc_output_array(temp_walks);
+    ASSERT_EQ(terminated_walker_num, walker_num);
+
+    std::vector<WeightedEdge> graph_edges;
+    graph.get_weighted_edges_with_id(graph_edges);
+    std::vector<double> weight_sum(graph.v_num, 0.0);
+    std::vector<vertex_id_t> degrees(graph.v_num, 0);
+    for (auto &e : graph_edges) {
+        weight_sum[e.src] += e.weight;
+        degrees[e.src]++;
+    }
+    std::vector<std::vector<double> > trans_mat(graph.v_num, std::vector<double>(graph.v_num, 0.0));
+    for (auto &e : graph_edges) {
+        trans_mat[e.src][e.dst] += weight_sum[e.src] > 0 ? e.weight / weight_sum[e.src] : 1.0 / degrees[e.src];
+    }
+    // The dead ends loop on themselves
+    for (vertex_id_t v_i = graph.dead_end_begin; v_i < graph.v_num; v_i++) {
+        trans_mat[v_i][v_i] = 1.0;
+    }
+    std::vector<std::vector<double> > real_trans_mat(graph.v_num, std::vector<double>(graph.v_num, 0.0));
+    for (uint64_t w_i = 0; w_i < walker_num; w_i++) {
+        vertex_id_t *walk = walks.data() + w_i * walk_len;
+        for (unsigned l_i = 0; l_i + 1 < walk_len; l_i++) {
+            ASSERT_TRUE(trans_mat[walk[l_i]][walk[l_i + 1]] != 0);
+            real_trans_mat[walk[l_i]][walk[l_i + 1]] += 1;
+        }
+    }
+    mat_normalization(real_trans_mat);
+    cmp_trans_matrix(real_trans_mat, trans_mat);
+    rm_test_graph_file();
+}
+
+TEST(WeightedWalk, SingleThread)
+{
+    SINGLE_THREAD_TEST(test_weighted_walk(true, mtcfg));
+}
+
+TEST(WeightedWalk, MultiThreadDirected)
+{
+    MULTI_THREAD_TEST(test_weighted_walk(false, mtcfg));
+}
+
+TEST(WeightedWalk, NUMA)
+{
+    NUMA_TEST(test_weighted_walk(true, mtcfg));
+}
+
+// The alias tables keep the probabilities of the light edges far below 1 / 65536
+void test_skewed_alias_table()
+{
+    AdjUnit units[2];
+    units[0].neighbor = 0;
+    units[1].neighbor = 1;
+    AdjList adj;
+    adj.degree = 2;
+    adj.begin = units;
+    real_t weights[2] = {1, 1e6};
+    AliasSampler::AliasUnit table[2];
+    std::vector<double> probs;
+    std::vector<vertex_id_t> small;
+    std::vector<vertex_id_t> large;
+    AliasSampler::build_table(adj, weights, table, probs, small, large);
+
+    default_rand_t rd;
+    const uint64_t sample_num = 20000000;
+    uint64_t light_num = 0;
+    for (uint64_t s_i = 0; s_i < sample_num; s_i++) {
+        light_num += AliasSampler::sample_table(table, adj.degree, &rd) == 0;
+    }
+    // 20 light samples are expected, or about 150 with 16-bit probabilities
+    EXPECT_GE(light_num, 3u);
+    EXPECT_LE(light_num, 50u);
+}
+
+TEST(WeightedWalk, SkewedAliasTable)
+{
+    test_skewed_alias_table();
+}
+
+/**
+ * Walk a typed graph along a metapath, and check that each step goes to a
+ * uniformly drawn neighbor of the next type, or follows the dead-end mode if
+ * there is none. The vertices of type 1 with names divisible by 7 have no
+ * neighbors of type 2, and the directed graph has dead ends as well.
+ */
+void test_metapath_walk(bool as_undirected, DeadEndMode mode, MultiThreadConfig mtcfg)
+{
+    const vertex_id_t v_num = 200;
+    auto get_type = [] (vertex_id_t name) {
+        return (vertex_type_t) (name % 3);
+    };
+    auto is_blocked = [&] (vertex_id_t a, vertex_id_t b) {
+        return get_type(a) == 1 && a % 7 == 0 && get_type(b) == 2;
+    };
+    std::vector<Edge> edges;
+    if (as_undirected) {
+        gen_graph(v_num, 2000, edges);
+    } else {
+        gen_dead_end_graph(v_num - 20, 20, 2000, edges);
+    }
+    std::vector<Edge> typed_edges;
+    for (auto &e : edges) {
+        if (!is_blocked(e.src, e.dst) && !is_blocked(e.dst, e.src)) {
+            typed_edges.push_back(e);
+        }
+    }
+    write_text_graph(test_graph_path, typed_edges);
+    write_test_vertex_types(v_num, get_type);
+
+    uint64_t mem_quota = 0;
+    unsigned walk_len = 40;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num * 20;
+    };
+    GraphMocker graph(mtcfg);
+    make_graph(test_graph_path, TextGraphFormat, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, graph);
+    graph.load_vertex_types(test_vertex_type_path);
+    std::vector<vertex_type_t> metapath = {0, 1, 2, 1};
+
+    FMobSolver solver(&graph, mtcfg);
+    solver.set_dead_end_mode(mode);
+    solver.set_metapath(metapath);
+    uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
+    std::vector<vertex_id_t> walks((size_t) walk_len * walker_num);
+    solver.prepare(walker_num, walk_len, mem_quota);
+    auto* temp_walks = solver.alloc_output_array();
+    uint64_t terminated_walker_num = 0;
+    while (solver.has_next_walk()) {
+        walker_id_t epoch_walker_num;
+        solver.walk(temp_walks, epoch_walker_num);
+        memcpy(walks.data() + terminated_walker_num * walk_len, temp_walks, epoch_walker_num * sizeof(vertex_id_t) * walk_len);
+        terminated_walker_num += epoch_walker_num;
+    }
+    solver.dealloc_output_array(temp_walks);
+    ASSERT_EQ(terminated_walker_num, walker_num);
+
+    // The rows are the pairs of the current vertex and the next type
+    const vertex_id_t type_num = graph.type_num;
+    const vertex_type_t* types = graph.vertex_types;
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_id(graph_edges);
+    std::set<std::pair<vertex_id_t, vertex_id_t> > edge_set;
+    std::vector<std::vector<double> > trans_mat(graph.v_num * type_num, std::vector<double>(graph.v_num, 0.0));
+    for (auto &e : graph_edges) {
+        edge_set.insert(std::make_pair(e.src, e.dst));
+        trans_mat[e.src * type_num + types[e.dst]][e.dst] += 1;
+    }
+    std::vector<std::vector<double> > real_trans_mat(graph.v_num * type_num, std::vector<double>(graph.v_num, 0.0));
+    uint64_t stuck_step_num = 0;
+    for (uint64_t w_i = 0; w_i < walker_num; w_i++) {
+        vertex_id_t *walk = walks.data() + w_i * walk_len;
+        ASSERT_EQ(types[walk[0]], metapath[0]);
+        size_t pos = 0;
+        for (unsigned l_i = 1; l_i < walk_len; l_i++) {
+            vertex_id_t prev = walk[l_i - 1];
+            vertex_id_t cur = walk[l_i];
+            if (prev == WalkEndVertex) {
+                ASSERT_EQ(cur, WalkEndVertex);
+                continue;
+            }
+            size_t next_pos = (pos + 1) % metapath.size();
+            auto &row = trans_mat[prev * type_num + metapath[next_pos]];
+            if (std::accumulate(row.begin(), row.end(), 0.0) != 0) {
+                ASSERT_TRUE(edge_set.find(std::make_pair(prev, cur)) != edge_set.end());
+                ASSERT_EQ(types[cur], metapath[next_pos]);
+                real_trans_mat[prev * type_num + metapath[next_pos]][cur] += 1;
+                pos = next_pos;
+                continue;
+            }
+            stuck_step_num++;
+            if (mode == DeadEndStop) {
+                ASSERT_EQ(cur, WalkEndVertex);
+            } else if (mode == DeadEndRestart) {
+                ASSERT_LT(cur, graph.v_num);
+                ASSERT_EQ(types[cur], metapath[0]);
+                pos = 0;
+            } else {
+                ASSERT_EQ(cur, prev);
+            }
+        }
+    }
+    ASSERT_GT(stuck_step_num, 0u);
+    // Not all the rows are walked, e.g. the ones of the vertex and type pairs
+    // not on the metapath, or the vertices of type 1 without neighbors of type 2,
+    // which are only reached from type 0.
+    for (size_t r_i = 0; r_i < trans_mat.size(); r_i++) {
+        if (std::accumulate(real_trans_mat[r_i].begin(), real_trans_mat[r_i].end(), 0.0) == 0) {
+            std::fill(trans_mat[r_i].begin(), trans_mat[r_i].end(), 0.0);
+        }
+    }
+    mat_normalization(trans_mat);
+    mat_normalization(real_trans_mat);
+    cmp_trans_matrix(real_trans_mat, trans_mat);
+    rm_test_vertex_type_file();
+    rm_test_graph_file();
+}
+
+TEST(MetapathWalk, SingleThreadStop)
+{
+    SINGLE_THREAD_TEST(test_metapath_walk(true, DeadEndStop, mtcfg));
+}
+
+TEST(MetapathWalk, MultiThreadRestart)
+{
+    MULTI_THREAD_TEST(test_metapath_walk(false, DeadEndRestart, mtcfg));
+}
+
+TEST(MetapathWalk, MultiThreadSelfLoop)
+{
+    MULTI_THREAD_TEST(test_metapath_walk(true, DeadEndSelfLoop, mtcfg));
+}
+
+TEST(MetapathWalk, NUMA)
+{
+    NUMA_TEST(test_metapath_walk(false, DeadEndStop, mtcfg));
+}
+
+/**
+ * Do temporal walks, and check that each step takes an edge no earlier than
+ * the previous one, and that the walkers without such edges, which only occur
+ * on directed graphs, stop, restart, or stay. The first steps, which may take any edge, are sampled uniformly.
+ */
+void test_temporal_walk(bool as_undirected, DeadEndMode mode, MultiThreadConfig mtcfg)
+{
+    const vertex_id_t v_num = 200;
+    // Both directions of an edge, and the duplicate edges, have the same time
+    auto get_time = [] (vertex_id_t a, vertex_id_t b) {
+        return (edge_time_t) ((a * b + a + b) % 23);
+    };
+    std::vector<Edge> edges;
+    if (as_undirected) {
+        gen_graph(v_num, 2000, edges);
+    } else {
+        gen_dead_end_graph(v_num - 20, 20, 2000, edges);
+    }
+    std::vector<TemporalEdge> temporal_edges;
+    for (auto &e : edges) {
+        temporal_edges.push_back(TemporalEdge(e.src, e.dst, get_time(e.src, e.dst)));
+    }
+    write_text_graph(test_graph_path, temporal_edges);
+
+    uint64_t mem_quota = 0;
+    unsigned walk_len = 40;
+    auto walker_num_func = [] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num * 20;
+    };
+    GraphMocker graph(mtcfg);
+    graph.set_temporal(true);
+    make_graph(test_graph_path, TextGraphFormat, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, false, graph);
+
+    FMobSolver solver(&graph, mtcfg);
+    solver.set_dead_end_mode(mode);
+    uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
+    std::vector<vertex_id_t> walks((size_t) walk_len * walker_num);
+    solver.prepare(walker_num, walk_len, mem_quota);
+    auto* temp_walks = solver.alloc_output_array();
+    uint64_t terminated_walker_num = 0;
+    while (solver.has_next_walk()) {
+        walker_id_t epoch_walker_num;
+        solver.walk(temp_walks, epoch_walker_num);
+        memcpy(walks.data() + terminated_walker_num * walk_len, temp_walks, epoch_walker_num * sizeof(vertex_id_t) * walk_len);
+        terminated_walker_num += epoch_walker_num;
     }
+    solver.dealloc_output_array(temp_walks);
+    ASSERT_EQ(terminated_walker_num, walker_num);
+
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_id(graph_edges);
+    std::set<std::pair<vertex_id_t, vertex_id_t> > edge_set;
+    std::vector<edge_time_t> latest_times(graph.v_num, 0);
+    std::vector<bool> has_edges(graph.v_num, false);
+    std::vector<std::vector<double> > trans_mat(graph.v_num, std::vector<double>(graph.v_num, 0.0));
+    for (auto &e : graph_edges) {
+        edge_set.insert(std::make_pair(e.src, e.dst));
+        edge_time_t time = get_time(graph.id2name[e.src], graph.id2name[e.dst]);
+        latest_times[e.src] = std::max(latest_times[e.src], time);
+        has_edges[e.src] = true;
+        trans_mat[e.src][e.dst] += 1;
+    }
+    std::vector<std::vector<double> > real_trans_mat(graph.v_num, std::vector<double>(graph.v_num, 0.0));
+    uint64_t stuck_step_num = 0;
+    for (uint64_t w_i = 0; w_i < walker_num; w_i++) {
+        vertex_id_t *walk = walks.data() + w_i * walk_len;
+        edge_time_t time = 0;
+        bool first_step = true;
+        for (unsigned l_i = 1; l_i < walk_len; l_i++) {
+            vertex_id_t prev = walk[l_i - 1];
+            vertex_id_t cur = walk[l_i];
+            if (prev == WalkEndVertex) {
+                ASSERT_EQ(cur, WalkEndVertex);
+                continue;
+            }
+            if (has_edges[prev] && latest_times[prev] >= time) {
+                ASSERT_TRUE(edge_set.find(std::make_pair(prev, cur)) != edge_set.end());
+                edge_time_t next_time = get_time(graph.id2name[prev], graph.id2name[cur]);
+                ASSERT_GE(next_time, time);
+                if (first_step) {
+                    real_trans_mat[prev][cur] += 1;
+                }
+                time = next_time;
+                first_step = false;
+                continue;
+            }
+            stuck_step_num++;
+            if (mode == DeadEndStop) {
+                ASSERT_EQ(cur, WalkEndVertex);
+            } else if (mode == DeadEndRestart) {
+                ASSERT_LT(cur, graph.v_num);
+                time = 0;
+            } else {
+                ASSERT_EQ(cur, prev);
+            }
+        }
+    }
+    if (as_undirected) {
+        // The walkers could always go back along the edges they have taken
+        ASSERT_EQ(stuck_step_num, 0u);
+    } else {
+        ASSERT_GT(stuck_step_num, 0u);
+    }
+    mat_normalization(trans_mat);
+    mat_normalization(real_trans_mat);
+    cmp_trans_matrix(real_trans_mat, trans_mat);
     rm_test_graph_file();
 }
 
+TEST(TemporalWalk, SingleThreadStop)
+{
+    SINGLE_THREAD_TEST(test_temporal_walk(true, DeadEndStop, mtcfg));
+}
+
+TEST(TemporalWalk, MultiThreadRestart)
+{
+    MULTI_THREAD_TEST(test_temporal_walk(false, DeadEndRestart, mtcfg));
+}
+
+TEST(TemporalWalk, MultiThreadSelfLoop)
+{
+    MULTI_THREAD_TEST(test_temporal_walk(false, DeadEndSelfLoop, mtcfg));
+}
+
+TEST(TemporalWalk, NUMA)
+{
+    NUMA_TEST(test_temporal_walk(false, DeadEndStop, mtcfg));
+}
+
+/**
+ * Do terminating walks, and check that the walk lengths follow the geometric
+ * distribution, cut at walk_len and at the dead ends in the stop mode, and that
+ * the steps are uniform along the edges.
+ */
+void test_terminating_walk(bool as_undirected, DeadEndMode mode, bool node2vec, MultiThreadConfig mtcfg)
+{
+    const real_t termination_prob = 0.2;
+    std::vector<Edge> edges;
+    if (node2vec) {
+        // Both directions of the edges are given, without self-loops
+        gen_undirected_graph(200, 2000, edges);
+    } else if (as_undirected) {
+        gen_graph(200, 2000, edges);
+    } else {
+        gen_dead_end_graph(180, 20, 2000, edges);
+    }
+    write_text_graph(test_graph_path, edges);
+
+    uint64_t mem_quota = 0;
+    unsigned walk_len = 20;
+    // The second-order check of node2vec needs enough samples per (prev, cur) edge
+    auto walker_num_func = [node2vec] (vertex_id_t vertex_num, edge_id_t edge_num) {
+        return (uint64_t) edge_num * (node2vec ? 200 : 20);
+    };
+    GraphMocker graph(mtcfg);
+    make_graph(test_graph_path, TextGraphFormat, as_undirected, walker_num_func, walk_len, mtcfg, mem_quota, node2vec, graph);
+
+    FMobSolver solver(&graph, mtcfg);
+    solver.set_dead_end_mode(mode);
+    solver.set_termination_prob(termination_prob);
+    if (node2vec) {
+        solver.set_node2vec(2, 0.5);
+    }
+    uint64_t walker_num = walker_num_func(graph.v_num, graph.e_num);
+    std::vector<vertex_id_t> walks((size_t) walk_len * walker_num);
+    solver.prepare(walker_num, walk_len, mem_quota);
+    auto* temp_walks = solver.alloc_output_array();
+    uint64_t terminated_walker_num = 0;
+    while (solver.has_next_walk()) {
+        walker_id_t epoch_walker_num;
+        solver.walk(temp_walks, epoch_walker_num);
+        memcpy(walks.data() + terminated_walker_num * walk_len, temp_walks, epoch_walker_num * sizeof(vertex_id_t) * walk_len);
+        terminated_walker_num += epoch_walker_num;
+    }
+    solver.dealloc_output_array(temp_walks);
+    ASSERT_EQ(terminated_walker_num, walker_num);
+
+    std::vector<Edge> graph_edges;
+    graph.get_edges_with_id(graph_edges);
+    std::set<std::pair<vertex_id_t, vertex_id_t> > edge_set;
+    std::vector<std::vector<double> > trans_mat(graph.v_num, std::vector<double>(graph.v_num, 0.0));
+    for (auto &e : graph_edges) {
+        edge_set.insert(std::make_pair(e.src, e.dst));
+        trans_mat[e.src][e.dst] += 1;
+    }
+    std::vector<std::vector<double> > real_trans_mat(graph.v_num, std::vector<double>(graph.v_num, 0.0));
+    // The number of walks of at least l_i + 1 vertices
+    std::vector<uint64_t> walk_len_counts(walk_len, 0);
+    for (uint64_t w_i = 0; w_i < walker_num; w_i++) {
+        vertex_id_t *walk = walks.data() + w_i * walk_len;
+        ASSERT_LT(walk[0], graph.v_num);
+        unsigned len = 1;
+        while (len < walk_len && walk[len] != WalkEndVertex) {
+            vertex_id_t prev = walk[len - 1];
+            vertex_id_t cur = walk[len];
+            ASSERT_LT(cur, graph.v_num);
+            if (prev < graph.dead_end_begin) {
+                ASSERT_TRUE(edge_set.find(std::make_pair(prev, cur)) != edge_set.end());
+                real_trans_mat[prev][cur] += 1;
+            } else {
+                ASSERT_NE(mode, DeadEndStop);
+                if (mode == DeadEndSelfLoop) {
+                    ASSERT_EQ(cur, prev);
+                }
+            }
+            len++;
+        }
+        for (unsigned l_i = len; l_i < walk_len; l_i++) {
+            ASSERT_EQ(walk[l_i], WalkEndVertex);
+        }
+        if (len < walk_len && mode == DeadEndStop && walk[len - 1] >= graph.dead_end_begin) {
+            // Stopped at a dead end instead of terminated
+            continue;
+        }
+        for (unsigned l_i = 0; l_i < len; l_i++) {
+            walk_len_counts[l_i]++;
+        }
+    }
+    if (mode != DeadEndStop || !graph.has_dead_end()) {
+        for (unsigned l_i = 0; l_i < walk_len; l_i++) {
+            double expected = std::pow(1 - termination_prob, l_i);
+            EXPECT_NEAR((double) walk_len_counts[l_i] / walker_num, expected, 0.01);
+        }
+    }
+    if (!node2vec) {
+        mat_normalization(trans_mat);
+        mat_normalization(real_trans_mat);
+        cmp_trans_matrix(real_trans_mat, trans_mat);
+    } else {
+        // The previous vertices must follow the walkers through the compaction,
+        // otherwise the second-order transitions lose the p/q bias.
+        std::vector<std::vector<double> > n2v_trans_mat(graph_edges.size(), std::vector<double>(graph.v_num, 0.0));
+        get_node2vec_trans_matrix(graph.v_num, graph_edges.data(), graph_edges.size(), 2, 0.5, n2v_trans_mat);
+        std::map<std::pair<vertex_id_t, vertex_id_t>, edge_id_t> edge_ids;
+        for (edge_id_t e_i = 0; e_i < graph_edges.size(); e_i++) {
+            edge_ids[std::make_pair(graph_edges[e_i].src, graph_edges[e_i].dst)] = e_i;
+        }
+        std::vector<std::vector<double> > real_n2v_trans_mat(graph_edges.size(), std::vector<double>(graph.v_num, 0.0));
+        for (uint64_t w_i = 0; w_i < walker_num; w_i++) {
+            vertex_id_t *walk = walks.data() + w_i * walk_len;
+            for (unsigned p_i = 0; p_i + 2 < walk_len && walk[p_i + 2] != WalkEndVertex; p_i++) {
+                real_n2v_trans_mat[edge_ids[std::make_pair(walk[p_i], walk[p_i + 1])]][walk[p_i + 2]] += 1;
+            }
+        }
+        mat_normalization(real_n2v_trans_mat);
+        cmp_trans_matrix(real_n2v_trans_mat, n2v_trans_mat, 10.0);
+    }
+    rm_test_graph_file();
+}
+
+TEST(TerminatingWalk, SingleThread)
+{
+    SINGLE_THREAD_TEST(test_terminating_walk(true, DeadEndStop, false, mtcfg));
+}
+
+TEST(TerminatingWalk, MultiThreadStop)
+{
+    MULTI_THREAD_TEST(test_terminating_walk(false, DeadEndStop, false, mtcfg));
+}
+
+TEST(TerminatingWalk, MultiThreadRestart)
+{
+    MULTI_THREAD_TEST(test_terminating_walk(false, DeadEndRestart, false, mtcfg));
+}
+
+TEST(TerminatingWalk, MultiThreadNode2vec)
+{
+    MULTI_THREAD_TEST(test_terminating_walk(false, DeadEndStop, true, mtcfg));
+}
+
+TEST(TerminatingWalk, NUMA)
+{
+    NUMA_TEST(test_terminating_walk(false, DeadEndSelfLoop, false, mtcfg));
+}
+
+TEST(DeadEnd, SingleThreadStop)
+{
+    SINGLE_THREAD_TEST(test_dead_end_walk(DeadEndStop, mtcfg));
+}
+
+TEST(DeadEnd, MultiThreadStop)
+{
+    MULTI_THREAD_TEST(test_dead_end_walk(DeadEndStop, mtcfg));
+}
+
+TEST(DeadEnd, SingleThreadRestart)
+{
+    SINGLE_THREAD_TEST(test_dead_end_walk(DeadEndRestart, mtcfg));
+}
+
+TEST(DeadEnd, MultiThreadRestart)
+{
+    MULTI_THREAD_TEST(test_dead_end_walk(DeadEndRestart, mtcfg));
+}
+
+TEST(DeadEnd, SingleThreadSelfLoop)
+{
+    SINGLE_THREAD_TEST(test_dead_end_walk(DeadEndSelfLoop, mtcfg));
+}
 
 TEST(FMobSolver, SingleThread)
 {
@@ -83,6 +871,71 @@ TEST(FMobSolver, NUMA)
     NUMA_TEST(test_task("FMobSolver", mtcfg));
 }
 
+TEST(FMobSolver, SingleThreadDirected)
+{
+    SINGLE_THREAD_TEST(test_task("FMobSolver", mtcfg, false));
+}
+
+TEST(FMobSolver, MultiThreadDirected)
+{
+    MULTI_THREAD_TEST(test_task("FMobSolver", mtcfg, false));
+}
+
+TEST(WalkConsumer, SingleThread)
+{
+    SINGLE_THREAD_TEST(test_walk_consumer(mtcfg));
+}
+
+TEST(WalkConsumer, MultiThread)
+{
+    MULTI_THREAD_TEST(test_walk_consumer(mtcfg));
+}
+
+TEST(WalkConsumer, NUMA)
+{
+    NUMA_TEST(test_walk_consumer(mtcfg));
+}
+
+TEST(WalkOutput, Binary)
+{
+    MULTI_THREAD_TEST(test_walk_output(BinaryWalkOutputFormat, false, mtcfg));
+}
+
+TEST(WalkOutput, Text)
+{
+    MULTI_THREAD_TEST(test_walk_output(TextWalkOutputFormat, false, mtcfg));
+}
+
+TEST(WalkOutput, Corpus)
+{
+    MULTI_THREAD_TEST(test_walk_output(CorpusWalkOutputFormat, false, mtcfg));
+}
+
+TEST(WalkOutput, SingleThreadCorpus)
+{
+    SINGLE_THREAD_TEST(test_walk_output(CorpusWalkOutputFormat, false, mtcfg));
+}
+
+TEST(WalkOutput, Archive)
+{
+    MULTI_THREAD_TEST(test_walk_output(ArchiveWalkOutputFormat, false, mtcfg));
+}
+
+TEST(WalkOutput, SingleThreadArchive)
+{
+    SINGLE_THREAD_TEST(test_walk_output(ArchiveWalkOutputFormat, false, mtcfg));
+}
+
+TEST(WalkOutput, DirectIO)
+{
+    SINGLE_THREAD_TEST(test_walk_output(BinaryWalkOutputFormat, true, mtcfg));
+}
+
+TEST(WalkOutput, NUMA)
+{
+    NUMA_TEST(test_walk_output(TextWalkOutputFormat, false, mtcfg));
+}
+
 GTEST_API_ int main(int argc, char *argv[])
 {
     init_glog(argv, google::FATAL);
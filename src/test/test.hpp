@@ -31,6 +31,23 @@ void rm_test_graph_info_file()
     std::remove(get_info_graph_path(test_graph_path).c_str());
 }
 
+const char *test_vertex_type_path = "./.flashmobtest.types.txt";
+
+// Write the types of the vertex names [0, vertex_num) given by get_type
+template<typename F>
+void write_test_vertex_types(vertex_id_t vertex_num, F get_type)
+{
+    std::ofstream fout(test_vertex_type_path);
+    for (vertex_id_t v_i = 0; v_i < vertex_num; v_i++) {
+        fout << v_i << " " << (int) get_type(v_i) << "\n";
+    }
+}
+
+void rm_test_vertex_type_file()
+{
+    std::remove(test_vertex_type_path);
+}
+
 // Randomly generate a graph
 void gen_graph(vertex_id_t vertex_num, edge_id_t edge_num, std::vector<Edge> &edges) {
     assert(vertex_num <= edge_num);
@@ -49,6 +66,16 @@ void gen_graph(vertex_id_t vertex_num, edge_id_t edge_num, std::vector<Edge> &ed
     }
 }
 
+// Randomly generate a directed graph, where the last dead_end_num vertices
+// only have in-edges.
+void gen_dead_end_graph(vertex_id_t vertex_num, vertex_id_t dead_end_num, edge_id_t edge_num, std::vector<Edge> &edges) {
+    gen_graph(vertex_num, edge_num, edges);
+    MTRandGen rd;
+    for (vertex_id_t d_i = 0; d_i < dead_end_num; d_i++) {
+        edges.push_back(Edge(rd.gen(vertex_num), vertex_num + d_i));
+    }
+}
+
 // Randomly generate an undirected graph. No duplicate edge will be produced.
 void gen_undirected_graph(vertex_id_t vertex_num, edge_id_t edge_num, std::vector<Edge> &edges) {
     assert(vertex_num <= edge_num * 2 && edge_num % 2 == 0);
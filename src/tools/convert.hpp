@@ -0,0 +1,321 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <strings.h>
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <omp.h>
+
+#include "type.hpp"
+#include "log.hpp"
+#include "io.hpp"
+#include "timer.hpp"
+#include "parallel.hpp"
+
+/**
+ * The shared pipeline of the graph conversion tools:
+ * 1. Read the input shards with all the OpenMP threads, with one of the
+ *    parsers in io.hpp and here (see read_text_shards).
+ * 2. Relabel the vertices to dense IDs in the order of their names, with a
+ *    concurrent bitmap over the names and its rank.
+ * 3. Write the edges to the output file, where each thread writes its own
+ *    range with pwrite.
+ * Without relabeling, stream_binary_edges() and stream_binary_shards() convert
+ * the text and binary shards in one pass without holding the edges.
+ */
+
+/**
+ * The parser of adjacency lists, where each line is
+ * "src degree dst_0 dst_1 ... dst_{degree - 1}".
+ */
+struct AdjacencyListParser {
+    const char* skip_header(const char* begin, const char* end) const {
+        return begin;
+    }
+
+    template<typename F>
+    edge_id_t foreach_edge(const char* p, const char* end, F func) const {
+        edge_id_t e_num = 0;
+        while (p < end) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* line_end = (nl == nullptr ? end : nl);
+            vertex_id_t src, degree, dst;
+            const char* q = nullptr;
+            if (*p != '#' && (q = parse_text_uint(p, line_end, src)) != nullptr && (q = parse_text_uint(q, line_end, degree)) != nullptr) {
+                for (vertex_id_t d_i = 0; d_i < degree; d_i++) {
+                    q = parse_text_uint(q, line_end, dst);
+                    CHECK(q != nullptr) << "Expect " << degree << " neighbors of vertex " << src << " on the same line";
+                    func(src, dst);
+                }
+                e_num += degree;
+            }
+            p = line_end + 1;
+        }
+        return e_num;
+    }
+};
+
+/**
+ * The parser of Matrix Market coordinate files. The comments starting with
+ * '%' and the size line are skipped, and each entry "row col [value]" becomes
+ * an edge with 0-based vertex IDs.
+ * The banner "%%MatrixMarket matrix coordinate <field> <symmetry>" is read:
+ * symmetric, skew-symmetric and hermitian files store only one triangle, so
+ * each of their off-diagonal entries becomes the edges of both directions.
+ */
+struct MatrixMarketParser {
+    // Set by skip_header from the banners, which must agree between the shards
+    mutable bool has_banner;
+    mutable bool symmetric;
+
+    MatrixMarketParser() : has_banner(false), symmetric(false) {}
+
+    void parse_banner(const char* begin, const char* end) const {
+        std::istringstream ss(std::string(begin, end));
+        std::string banner, object, format, field, symmetry;
+        ss >> banner >> object >> format >> field >> symmetry;
+        auto to_lower = [] (std::string &str) {
+            std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+        };
+        to_lower(format);
+        to_lower(symmetry);
+        CHECK(format == "coordinate") << "Only Matrix Market coordinate files are supported, not " << format;
+        bool banner_symmetric = false;
+        if (symmetry == "general") {
+            banner_symmetric = false;
+        } else if (symmetry == "symmetric" || symmetry == "skew-symmetric" || symmetry == "hermitian") {
+            banner_symmetric = true;
+        } else {
+            LOG(FATAL) << "Unknown Matrix Market symmetry: " << symmetry;
+        }
+        CHECK(!has_banner || symmetric == banner_symmetric) << "The Matrix Market shards have different symmetries";
+        has_banner = true;
+        symmetric = banner_symmetric;
+    }
+
+    const char* skip_header(const char* begin, const char* end) const {
+        const char* p = begin;
+        const std::string banner_prefix = "%%MatrixMarket";
+        if ((size_t) (end - begin) >= banner_prefix.size() && strncasecmp(begin, banner_prefix.c_str(), banner_prefix.size()) == 0) {
+            const char* nl = static_cast<const char*>(memchr(begin, '\n', end - begin));
+            parse_banner(begin, nl == nullptr ? end : nl);
+        }
+        bool size_line = false;
+        while (p < end && !size_line) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* line_end = (nl == nullptr ? end : nl);
+            vertex_id_t val;
+            size_line = (*p != '%' && parse_text_uint(p, line_end, val) != nullptr);
+            p = (nl == nullptr ? end : nl + 1);
+        }
+        return p;
+    }
+
+    template<typename F>
+    edge_id_t foreach_edge(const char* p, const char* end, F func) const {
+        edge_id_t e_num = 0;
+        foreach_text_edge(p, end, [&] (vertex_id_t row, vertex_id_t col) {
+            CHECK(row != 0 && col != 0) << "Matrix Market indices are 1-based";
+            func(row - 1, col - 1);
+            e_num++;
+            if (symmetric && row != col) {
+                func(col - 1, row - 1);
+                e_num++;
+            }
+        });
+        return e_num;
+    }
+};
+
+/**
+ * Relabel the vertices of the edges to [0, v_num) in the order of their names,
+ * and return v_num. E is Edge, WeightedEdge or TemporalEdge.
+ */
+template<typename E>
+vertex_id_t relabel_edges(std::vector<E> &edges) {
+    Timer timer;
+    vertex_id_t max_name = 0;
+    #pragma omp parallel for reduction (max: max_name)
+    for (size_t e_i = 0; e_i < edges.size(); e_i++) {
+        max_name = std::max(max_name, std::max(edges[e_i].src, edges[e_i].dst));
+    }
+    ConcurrentBitmap names;
+    names.resize((size_t) max_name + 1);
+    #pragma omp parallel for
+    for (size_t e_i = 0; e_i < edges.size(); e_i++) {
+        names.set(edges[e_i].src);
+        names.set(edges[e_i].dst);
+    }
+    std::vector<size_t> word_ranks;
+    names.get_word_ranks(word_ranks);
+    #pragma omp parallel for
+    for (size_t e_i = 0; e_i < edges.size(); e_i++) {
+        edges[e_i].src = names.rank(word_ranks, edges[e_i].src);
+        edges[e_i].dst = names.rank(word_ranks, edges[e_i].dst);
+    }
+    vertex_id_t v_num = word_ranks.back();
+    LOG(INFO) << "Relabeled " << v_num << " vertices in " << timer.duration() << " seconds";
+    return v_num;
+}
+
+void write_graph_info(const char* fname, std::stringstream &ss) {
+    std::string info_path = get_info_graph_path(std::string(fname));
+    FILE *info_f = fopen(info_path.c_str(), "w");
+    CHECK(info_f != NULL);
+    fprintf(info_f, "%s", ss.str().c_str());
+    fclose(info_f);
+}
+
+// Write the edges as a binary graph with all the OpenMP threads
+template<typename E>
+void write_binary_edges(const char* fname, const std::vector<E> &edges) {
+    Timer timer;
+
+    int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0) << "Cannot create " << fname;
+    CHECK(ftruncate(fd, sizeof(E) * edges.size()) == 0);
+    #pragma omp parallel
+    {
+        size_t range = (edges.size() + omp_get_num_threads() - 1) / omp_get_num_threads();
+        size_t begin = std::min(edges.size(), range * omp_get_thread_num());
+        size_t end = std::min(edges.size(), begin + range);
+        pwrite_all(fd, (const char*) (edges.data() + begin), sizeof(E) * (end - begin), sizeof(E) * begin);
+    }
+    close(fd);
+    LOG(INFO) << "Wrote " << fname << " in " << timer.duration() << " seconds";
+}
+
+// Write the edges as a binary graph, as well as the info file with the content of ss
+template<typename E>
+void write_binary_edges(const char* fname, const std::vector<E> &edges, std::stringstream &ss) {
+    write_graph_info(fname, ss);
+    write_binary_edges(fname, edges);
+}
+
+/**
+ * Write the edges as a text graph with all the OpenMP threads, headed by the
+ * content of ss. Each thread formats its range of edges to text in pieces,
+ * and writes them at the offset given by the prefix sum of the text sizes.
+ */
+void write_text_edges(const char* fname, const std::vector<Edge> &edges, std::stringstream &ss) {
+    Timer timer;
+    std::string header = ss.str();
+    int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0) << "Cannot create " << fname;
+    pwrite_all(fd, header.data(), header.size(), 0);
+
+    const size_t piece_edge_num = 1 << 16;
+    const size_t max_edge_text_size = 2 * (std::numeric_limits<vertex_id_t>::digits10 + 2);
+    size_t piece_num = (edges.size() + piece_edge_num - 1) / piece_edge_num;
+    std::vector<size_t> piece_size(piece_num);
+    #pragma omp parallel for
+    for (size_t p_i = 0; p_i < piece_num; p_i++) {
+        size_t size = 0;
+        size_t end = std::min(edges.size(), (p_i + 1) * piece_edge_num);
+        for (size_t e_i = p_i * piece_edge_num; e_i < end; e_i++) {
+            size += text_uint_size(edges[e_i].src) + text_uint_size(edges[e_i].dst) + 2;
+        }
+        piece_size[p_i] = size;
+    }
+    std::vector<size_t> piece_offset(piece_num + 1);
+    parallel_prefix_sum(piece_size.data(), piece_offset.data(), piece_num);
+
+    #pragma omp parallel
+    {
+        std::vector<char> text(piece_edge_num * max_edge_text_size);
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t p_i = 0; p_i < piece_num; p_i++) {
+            char* p = text.data();
+            size_t end = std::min(edges.size(), (p_i + 1) * piece_edge_num);
+            for (size_t e_i = p_i * piece_edge_num; e_i < end; e_i++) {
+                p = format_text_uint(p, edges[e_i].src);
+                *p++ = ' ';
+                p = format_text_uint(p, edges[e_i].dst);
+                *p++ = '\n';
+            }
+            pwrite_all(fd, text.data(), p - text.data(), header.size() + piece_offset[p_i]);
+        }
+    }
+    close(fd);
+    LOG(INFO) << "Wrote " << fname << " in " << timer.duration() << " seconds";
+}
+
+/**
+ * Convert the shards to a binary graph in one pass, without relabeling and
+ * without holding the edges. Each thread parses a chunk into its own buffer,
+ * reserves the range for it at the end of the output file, and writes it
+ * there, so the edges are not kept in the input order.
+ * Return the edge number. E is Edge, WeightedEdge or TemporalEdge.
+ */
+template<typename E = Edge, typename P>
+edge_id_t stream_binary_edges(const std::vector<std::string> &paths, const P &parser, const char* fname) {
+    Timer timer;
+    std::vector<std::unique_ptr<MappedFile> > files;
+    std::vector<TextChunk> chunks;
+    map_text_shards(paths, parser, files, chunks);
+
+    int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0) << "Cannot create " << fname;
+    edge_id_t e_num = 0;
+    #pragma omp parallel
+    {
+        std::vector<E> edges;
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t c_i = 0; c_i < chunks.size(); c_i++) {
+            edges.clear();
+            parser.foreach_edge(chunks[c_i].begin, chunks[c_i].end, EdgeAppender<E>(&edges));
+            edge_id_t begin = __sync_fetch_and_add(&e_num, (edge_id_t) edges.size());
+            pwrite_all(fd, (const char*) edges.data(), sizeof(E) * edges.size(), sizeof(E) * begin);
+        }
+    }
+    close(fd);
+    LOG(INFO) << "Converted " << e_num << " edges from " << paths.size() << " files to " << fname << " in " << timer.duration() << " seconds";
+    return e_num;
+}
+
+/**
+ * Concatenate the binary shards to a binary graph, without holding the edges.
+ * The shards are mapped and copied in pieces of piece_size bytes by all the
+ * threads, so the edges are kept in the input order.
+ * Return the edge number. E is Edge, WeightedEdge or TemporalEdge.
+ */
+template<typename E = Edge>
+edge_id_t stream_binary_shards(const std::vector<std::string> &paths, const char* fname, size_t piece_size = 64ul << 20) {
+    Timer timer;
+    piece_size = std::max(piece_size / sizeof(E), (size_t) 1) * sizeof(E);
+    std::vector<std::unique_ptr<MappedFile> > files;
+    // File and offset in the file of each piece
+    std::vector<std::pair<size_t, size_t> > pieces;
+    std::vector<size_t> piece_dst;
+    size_t total_size = 0;
+    for (auto &path : paths) {
+        files.emplace_back(new MappedFile(path.c_str()));
+        size_t size = files.back()->size / sizeof(E) * sizeof(E);
+        for (size_t offset = 0; offset < size; offset += piece_size) {
+            pieces.push_back(std::make_pair(files.size() - 1, offset));
+            piece_dst.push_back(total_size + offset);
+        }
+        total_size += size;
+    }
+
+    int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0) << "Cannot create " << fname;
+    CHECK(ftruncate(fd, total_size) == 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t p_i = 0; p_i < pieces.size(); p_i++) {
+        auto &file = files[pieces[p_i].first];
+        size_t offset = pieces[p_i].second;
+        size_t size = std::min(piece_size, file->size / sizeof(E) * sizeof(E) - offset);
+        pwrite_all(fd, file->data + offset, size, piece_dst[p_i]);
+    }
+    close(fd);
+    edge_id_t e_num = total_size / sizeof(E);
+    LOG(INFO) << "Converted " << e_num << " edges from " << paths.size() << " files to " << fname << " in " << timer.duration() << " seconds";
+    return e_num;
+}
@@ -0,0 +1,163 @@
+#include <assert.h>
+
+#include <sstream>
+
+#include "option.hpp"
+#include "log.hpp"
+#include "io.hpp"
+#include "convert.hpp"
+
+enum InputGraphFormat {
+    SnapInputFormat,
+    AdjacencyInputFormat,
+    MatrixMarketInputFormat,
+    BinaryInputFormat
+};
+
+class FMobConvertOptionHelper : public OptionParser
+{
+private:
+    args::ValueFlagList<std::string> input_paths_flag;
+    args::ValueFlag<std::string> input_format_flag;
+    args::ValueFlag<std::string> output_path_flag;
+    args::Flag relabel_flag;
+    args::Flag weighted_flag;
+    args::Flag temporal_flag;
+public:
+    std::vector<std::string> input_paths;
+    InputGraphFormat input_format;
+    std::string output_path;
+    bool relabel;
+    bool weighted;
+    bool temporal;
+    FMobConvertOptionHelper():
+        input_paths_flag(parser, "input", "input file, directory or glob of shards, which could be repeated", {'i'}),
+        input_format_flag(parser, "in-format", "input format: snap | adj | mtx | binary", {"in-format"}),
+        output_path_flag(parser, "output", "binary graph output path", {'o'}),
+        relabel_flag(parser, "relabel", "[optional] relabel the vertices to dense IDs, with all the edges in memory", {"relabel"}),
+        weighted_flag(parser, "weighted", "[optional] convert a weighted graph, whose snap lines are \"src dst weight\"", {"weighted"}),
+        temporal_flag(parser, "temporal", "[optional] convert a temporal graph, whose snap lines are \"src dst time\"", {"temporal"})
+    {}
+    virtual void parse(int argc, char **argv)
+    {
+        OptionParser::parse(argc, argv);
+
+        CHECK(input_paths_flag);
+        for (const auto &path : args::get(input_paths_flag)) {
+            std::vector<std::string> shards;
+            get_graph_shard_paths(path.c_str(), shards);
+            input_paths.insert(input_paths.end(), shards.begin(), shards.end());
+        }
+        LOG(INFO) << "Input files: " << input_paths.size();
+
+        std::string input_format_str = input_format_flag ? args::get(input_format_flag) : std::string("snap");
+        if (input_format_str == "snap") {
+            input_format = SnapInputFormat;
+        } else if (input_format_str == "adj") {
+            input_format = AdjacencyInputFormat;
+        } else if (input_format_str == "mtx") {
+            input_format = MatrixMarketInputFormat;
+        } else if (input_format_str == "binary") {
+            input_format = BinaryInputFormat;
+        } else {
+            LOG(FATAL) << "Unknown input format: " << input_format_str;
+        }
+        LOG(INFO) << "Input format: " << input_format_str;
+
+        CHECK(output_path_flag);
+        output_path = args::get(output_path_flag);
+        LOG(INFO) << "Output: " << output_path;
+
+        relabel = relabel_flag ? true : false;
+        weighted = weighted_flag ? true : false;
+        CHECK(!weighted || input_format == SnapInputFormat || input_format == BinaryInputFormat) << "Weighted graphs are only read from snap or binary inputs";
+        temporal = temporal_flag ? true : false;
+        CHECK(!temporal || input_format == SnapInputFormat || input_format == BinaryInputFormat) << "Temporal graphs are only read from snap or binary inputs";
+        CHECK(!(weighted && temporal)) << "A graph is either weighted or temporal";
+    }
+};
+
+/**
+ * Without relabeling, the text shards are streamed to the output in one pass.
+ * Otherwise, all the edges are read into memory, relabeled, and written.
+ * E is Edge, WeightedEdge or TemporalEdge.
+ */
+template<typename E, typename P>
+edge_id_t convert_text_shards(const FMobConvertOptionHelper &opt, const P &parser, vertex_id_t &v_num) {
+    if (!opt.relabel) {
+        return stream_binary_edges<E>(opt.input_paths, parser, opt.output_path.c_str());
+    }
+    std::vector<E> edges;
+    read_text_shards(opt.input_paths, parser, edges);
+    v_num = relabel_edges(edges);
+    write_binary_edges(opt.output_path.c_str(), edges);
+    return edges.size();
+}
+
+/**
+ * The same as convert_text_shards, for binary shards.
+ */
+template<typename E>
+edge_id_t convert_binary_shards(const FMobConvertOptionHelper &opt, vertex_id_t &v_num) {
+    if (!opt.relabel) {
+        return stream_binary_shards<E>(opt.input_paths, opt.output_path.c_str());
+    }
+    std::vector<E> edges;
+    read_binary_graph(opt.input_paths, edges);
+    v_num = relabel_edges(edges);
+    write_binary_edges(opt.output_path.c_str(), edges);
+    return edges.size();
+}
+
+void fmob_convert(const FMobConvertOptionHelper &opt) {
+    edge_id_t e_num = 0;
+    vertex_id_t v_num = 0;
+    if (opt.input_format == BinaryInputFormat) {
+        if (opt.weighted) {
+            e_num = convert_binary_shards<WeightedEdge>(opt, v_num);
+        } else if (opt.temporal) {
+            e_num = convert_binary_shards<TemporalEdge>(opt, v_num);
+        } else {
+            e_num = convert_binary_shards<Edge>(opt, v_num);
+        }
+    } else if (opt.input_format == AdjacencyInputFormat) {
+        e_num = convert_text_shards<Edge>(opt, AdjacencyListParser(), v_num);
+    } else if (opt.input_format == MatrixMarketInputFormat) {
+        e_num = convert_text_shards<Edge>(opt, MatrixMarketParser(), v_num);
+    } else if (opt.weighted) {
+        e_num = convert_text_shards<WeightedEdge>(opt, WeightedEdgeListParser(), v_num);
+    } else if (opt.temporal) {
+        e_num = convert_text_shards<TemporalEdge>(opt, TemporalEdgeListParser(), v_num);
+    } else {
+        e_num = convert_text_shards<Edge>(opt, EdgeListParser(), v_num);
+    }
+
+    std::stringstream ss;
+    ss << "# Converted from:";
+    for (auto &path : opt.input_paths) {
+        ss << " " << path;
+    }
+    ss << std::endl;
+    if (opt.relabel) {
+        ss << "# vertex number: " << v_num << std::endl;
+    }
+    ss << "# edges: " << e_num << std::endl;
+    if (opt.weighted) {
+        ss << "# weighted" << std::endl;
+    }
+    if (opt.temporal) {
+        ss << "# temporal" << std::endl;
+    }
+    write_graph_info(opt.output_path.c_str(), ss);
+}
+
+int main(int argc, char** argv)
+{
+    init_glog(argv, google::INFO);
+
+    FMobConvertOptionHelper opt;
+    opt.parse(argc, argv);
+
+    fmob_convert(opt);
+    return 0;
+}
@@ -1,11 +1,11 @@
 #include <assert.h>
 
 #include <sstream>
-#include <map>
 
 #include "option.hpp"
 #include "log.hpp"
 #include "io.hpp"
+#include "convert.hpp"
 
 class FormatKnKOptionHelper : public OptionParser
 {
@@ -36,24 +36,13 @@ public:
 void format_knk(std::string input_path, std::string output_path) {
     std::vector<Edge> edges;
     read_text_graph(input_path.c_str(), edges);
+    vertex_id_t v_num = relabel_edges(edges);
 
-    std::map<vertex_id_t, vertex_id_t> name2id;
-    auto get_vertex_id = [&] (vertex_id_t name) {
-        if (name2id.find(name) == name2id.end()) {
-            vertex_id_t id = name2id.size();
-            name2id[name] = id;
-        }
-        return name2id[name];
-    };
-    for (auto &e : edges) {
-        e.src = get_vertex_id(e.src);
-        e.dst = get_vertex_id(e.dst);
-    }
     std::stringstream ss;
     ss << "# Converted from: " << input_path << std::endl;
-    ss << "# vertex number: " << name2id.size() << std::endl;
+    ss << "# vertex number: " << v_num << std::endl;
     ss << "# edegs: " << edges.size() << std::endl;
-    write_binary_graph(output_path.c_str(), edges, ss);
+    write_binary_edges(output_path.c_str(), edges, ss);
 }
 
 int main(int argc, char** argv)
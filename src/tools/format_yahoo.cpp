@@ -1,10 +1,9 @@
 #include <sstream>
-#include <fstream>
-#include <map>
 
 #include "option.hpp"
 #include "log.hpp"
 #include "io.hpp"
+#include "convert.hpp"
 
 class FormatYahooOptionHelper : public OptionParser
 {
@@ -46,19 +45,7 @@ public:
 
 void convert(std::vector<std::string> input_paths, std::string binary_output_path, std::string text_output_path) {
     std::vector<Edge> edges;
-    for (auto path : input_paths) {
-        FILE *f = fopen(path.c_str(), "r");
-        CHECK(f != NULL);
-        vertex_id_t src, degree;
-        while (fscanf(f, "%u %u", &src, &degree) == 2) {
-            vertex_id_t dst;
-            for (vertex_id_t e_i = 0; e_i < degree; e_i++) {
-                CHECK(1 == fscanf(f, "%u", &dst));
-                edges.push_back(Edge(src, dst));
-            }
-        }
-        fclose(f);
-    }
+    read_text_shards(input_paths, AdjacencyListParser(), edges);
 
     std::stringstream ss;
     ss << "# Converted from:";
@@ -72,12 +59,12 @@ void convert(std::vector<std::string> input_paths, std::string binary_output_pat
     if (binary_output_path.size() != 0) {
         std::stringstream oss;
         oss << output_str;
-        write_binary_graph(binary_output_path.c_str(), edges, oss);
+        write_binary_edges(binary_output_path.c_str(), edges, oss);
     }
     if (text_output_path.size() != 0) {
         std::stringstream oss;
         oss << output_str;
-        write_text_graph(text_output_path.c_str(), edges, oss);
+        write_text_edges(text_output_path.c_str(), edges, oss);
     }
 }
 
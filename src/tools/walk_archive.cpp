@@ -0,0 +1,100 @@
+#include <assert.h>
+
+#include <fstream>
+#include <vector>
+
+#include "option.hpp"
+#include "log.hpp"
+#include "../core/archive.hpp"
+
+class WalkArchiveOptionHelper : public OptionParser
+{
+private:
+    args::ValueFlag<std::string> input_path_flag;
+    args::ValueFlag<std::string> output_path_flag;
+    args::ValueFlag<uint64_t> walker_flag;
+    args::ValueFlag<vertex_id_t> vertex_flag;
+    args::Flag names_flag;
+public:
+    std::string input_path;
+    std::string output_path;
+    bool has_walker;
+    uint64_t walker;
+    bool has_vertex;
+    vertex_id_t vertex;
+    bool names;
+    WalkArchiveOptionHelper():
+        input_path_flag(parser, "input", "walk archive path", {'i'}),
+        output_path_flag(parser, "output", "text output path", {'o'}),
+        walker_flag(parser, "walker", "[optional] only decode the walker", {"walker"}),
+        vertex_flag(parser, "vertex", "[optional] only decode the walkers starting from the vertex, given by its original ID in the input graph", {"vertex"}),
+        names_flag(parser, "names", "[optional] write the original vertex names instead of vertex IDs", {"names"})
+    {}
+    virtual void parse(int argc, char **argv)
+    {
+        OptionParser::parse(argc, argv);
+
+        assert(input_path_flag);
+        input_path = args::get(input_path_flag);
+        LOG(INFO) << "input: " << input_path;
+
+        assert(output_path_flag);
+        output_path = args::get(output_path_flag);
+        LOG(INFO) << "output: " << output_path;
+
+        has_walker = walker_flag ? true : false;
+        walker = has_walker ? args::get(walker_flag) : 0;
+        has_vertex = vertex_flag ? true : false;
+        vertex = has_vertex ? args::get(vertex_flag) : 0;
+        CHECK(!(has_walker && has_vertex)) << "Only one of --walker and --vertex could be used";
+        names = names_flag ? true : false;
+    }
+};
+
+void decode_walk_archive(const WalkArchiveOptionHelper &opt) {
+    WalkArchiveReader reader(opt.input_path.c_str());
+    int walk_len = reader.get_walk_len();
+    LOG(INFO) << "walkers: " << reader.get_walker_num() << ", walk length: " << walk_len << ", blocks: " << reader.footer.block_num;
+
+    std::vector<vertex_id_t> paths;
+    if (opt.has_walker) {
+        paths.resize(walk_len);
+        reader.read_walker(opt.walker, paths.data());
+    } else if (opt.has_vertex) {
+        // The archive stores the relabeled vertices
+        vertex_id_t vertex;
+        CHECK(reader.find_vertex(opt.vertex, vertex)) << "No vertex " << opt.vertex << " in the walk archive";
+        reader.read_start_vertex(vertex, paths);
+    } else {
+        paths.resize(reader.get_walker_num() * walk_len);
+        reader.read_all(paths.data());
+    }
+    LOG(INFO) << "decoded walkers: " << paths.size() / walk_len;
+
+    const vertex_id_t* id2name = nullptr;
+    if (opt.names) {
+        CHECK(reader.id2name != nullptr) << "The walk archive has no vertex names";
+        id2name = reader.id2name;
+    }
+    std::ofstream fout(opt.output_path);
+    CHECK(fout.is_open()) << "Cannot create " << opt.output_path;
+    for (size_t offset = 0; offset < paths.size(); offset += walk_len) {
+        // The paths stopped at dead ends are padded with WalkEndVertex
+        for (int l_i = 0; l_i < walk_len && paths[offset + l_i] != WalkEndVertex; l_i++) {
+            vertex_id_t v = paths[offset + l_i];
+            fout << (l_i == 0 ? "" : " ") << (id2name == nullptr ? v : id2name[v]);
+        }
+        fout << '\n';
+    }
+}
+
+int main(int argc, char** argv)
+{
+    init_glog(argv, google::INFO);
+
+    WalkArchiveOptionHelper opt;
+    opt.parse(argc, argv);
+
+    decode_walk_archive(opt);
+    return 0;
+}
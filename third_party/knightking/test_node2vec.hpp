@@ -116,7 +116,7 @@ void check_node2vec_random_walk(vertex_id_t v_num, Edge *edges, edge_id_t e_num,
         {
             if (adj_mat[path[p_i]][path[p_i + 1]] == false)
             {
-                printf("fault %u %u\n", path[p_i], path[p_i + 1]);
+                printf("fault %llu %llu\n", (unsigned long long) path[p_i], (unsigned long long) path[p_i + 1]);
             }
             ASSERT_TRUE(adj_mat[path[p_i]][path[p_i + 1]]);
         }